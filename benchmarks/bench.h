@@ -0,0 +1,61 @@
+#pragma once
+
+// core
+#include "core/config/config.h"
+#include "core/jobs/job_system.h"
+
+#include "window/window.h"
+#include "graphics/renderer.h"
+#include "graphics/gpu_scene.h"
+
+// std
+#include <chrono>
+#include <memory>
+
+// Wall time since construction
+class BenchTimer {
+public:
+
+	BenchTimer() : m_start{ std::chrono::steady_clock::now() } {}
+
+	double elapsed_ms() const { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count(); }
+
+	double elapsed_seconds() const { return elapsed_ms() / 1000.0; }
+
+private:
+
+	std::chrono::steady_clock::time_point m_start;
+};
+
+// What Engine owns below its resources, built from the bench config. Benchmarks that want a
+// clean device, e.g. an empty pipeline cache, construct one per measurement.
+struct BenchRenderer {
+
+	BenchRenderer(Config& config) : BenchRenderer(config, config.get_job_workers()) {}
+
+	// job_workers counts the main thread, 0 uses every hardware thread
+	BenchRenderer(Config& config, uint32_t job_workers)
+		: job_system{ job_workers }
+		, window{ config }
+		, renderer{ config, window, job_system }
+	{
+	}
+
+	// constructed first so the main thread becomes job worker 0
+	JobSystem job_system;
+	Window window;
+	Renderer renderer;
+};
+
+// Engine's cube grid test scene, uploaded, with a camera looking at it
+std::unique_ptr<GpuScene> create_bench_scene(const Config& config, Renderer& renderer, uint32_t instance_count, glm::mat4& view_projection);
+
+void bench_pipeline_compile(Config& config);
+void bench_upload(Config& config);
+void bench_jobs(Config& config);
+void bench_recording(Config& config);
+void bench_gpu_driven(Config& config);
+void bench_mesh(Config& config);
+void bench_logger(Config& config);
+void bench_headless(Config& config);
+void bench_gpu_profiler(Config& config);
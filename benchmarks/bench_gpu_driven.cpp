@@ -0,0 +1,113 @@
+#include "bench.h"
+
+// core
+#include "core/profile/profiler.h"
+
+// lib
+#include <fmt/core.h>
+
+// std
+#include <algorithm>
+
+namespace {
+
+constexpr uint32_t INSTANCE_COUNT = 100000;
+
+constexpr uint32_t WARMUP_FRAMES = 10;
+constexpr uint32_t MEASURED_FRAMES = 100;
+
+}
+
+void bench_gpu_driven(Config& config)
+{
+	BenchRenderer bench{ config };
+	Renderer& renderer = bench.renderer;
+
+	glm::mat4 view_projection{ 1.0f };
+	std::unique_ptr<GpuScene> scene = create_bench_scene(config, renderer, INSTANCE_COUNT, view_projection);
+	uint32_t slice_size = config.get_draws_per_slice();
+
+	// GPU zones are only recorded while the profiler is enabled
+	bool profiler_enabled = Profiler::is_enabled();
+	Profiler::get().set_enabled(true);
+
+	fmt::print("{} instances, {} draws per slice when recorded on the CPU\n", INSTANCE_COUNT, slice_size);
+	fmt::print("{:<10} {:>12} {:>12} {:>12}\n", "mode", "cpu ms", "record ms", "gpu ms");
+
+	for (bool indirect : { false, true })
+	{
+		if (indirect && !renderer.get_device().is_gpu_driven_supported())
+		{
+			fmt::print("{:<10} skipped, not supported by the device\n", "indirect");
+			continue;
+		}
+
+		RenderGraph& graph = renderer.get_render_graph();
+		graph.clear_passes();
+		if (indirect)
+		{
+			graph.add_pass("cull")
+				.set_side_effects()
+				.set_execute([&](VkCommandBuffer cmd) {
+					scene->cull(cmd, view_projection);
+				});
+
+			graph.add_pass("main")
+				.write(renderer.get_backbuffer(), ACCESS_COLOR_ATTACHMENT_WRITE)
+				.set_execute([&](VkCommandBuffer cmd) {
+					renderer.begin_main_pass(cmd);
+					scene->draw_indirect(cmd, view_projection);
+					renderer.end_main_pass(cmd);
+				});
+		}
+		else
+		{
+			graph.add_pass("main")
+				.write(renderer.get_backbuffer(), ACCESS_COLOR_ATTACHMENT_WRITE)
+				.set_execute([&](VkCommandBuffer cmd) {
+					renderer.begin_main_pass(cmd, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+					renderer.record_parallel(cmd, scene->get_instance_count(), slice_size, [&](VkCommandBuffer secondary, uint32_t begin, uint32_t end) {
+						scene->draw_direct(secondary, view_projection, begin, end);
+					});
+					renderer.end_main_pass(cmd);
+				});
+		}
+		renderer.compile_render_graph();
+
+		double cpu_sum_ms = 0.0;
+		double record_sum_ms = 0.0;
+		double gpu_sum_ms = 0.0;
+		uint32_t measured = 0;
+		for (uint32_t frame = 0; frame < WARMUP_FRAMES + MEASURED_FRAMES; frame++)
+		{
+			VkCommandBuffer cmd = renderer.begin_frame();
+			if (cmd == VK_NULL_HANDLE)
+			{
+				continue;
+			}
+
+			// waiting for the frame slot is GPU time, only recording and submission count
+			BenchTimer timer;
+			BenchTimer record_timer;
+			renderer.execute_render_graph(cmd);
+			double record_ms = record_timer.elapsed_ms();
+			renderer.end_frame();
+			double cpu_ms = timer.elapsed_ms();
+
+			if (frame >= WARMUP_FRAMES)
+			{
+				cpu_sum_ms += cpu_ms;
+				record_sum_ms += record_ms;
+				// published frames in flight late, the warmup covers the ones of the other mode
+				gpu_sum_ms += renderer.get_gpu_profiler().get_frame_stats().gpu_ms;
+				measured++;
+			}
+		}
+		renderer.wait_idle();
+
+		measured = std::max(1u, measured);
+		fmt::print("{:<10} {:>12.3f} {:>12.3f} {:>12.3f}\n", indirect ? "indirect" : "direct", cpu_sum_ms / measured, record_sum_ms / measured, gpu_sum_ms / measured);
+	}
+
+	Profiler::get().set_enabled(profiler_enabled);
+}
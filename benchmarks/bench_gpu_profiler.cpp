@@ -0,0 +1,105 @@
+#include "bench.h"
+
+// core
+#include "core/profile/profiler.h"
+
+// lib
+#include <fmt/core.h>
+
+// std
+#include <map>
+#include <string>
+
+namespace {
+
+constexpr uint32_t INSTANCE_COUNT = 10000;
+
+constexpr uint32_t WARMUP_FRAMES = 10;
+constexpr uint32_t MEASURED_FRAMES = 200;
+
+}
+
+void bench_gpu_profiler(Config& config)
+{
+	BenchRenderer bench{ config };
+	Renderer& renderer = bench.renderer;
+
+	glm::mat4 view_projection{ 1.0f };
+	std::unique_ptr<GpuScene> scene = create_bench_scene(config, renderer, INSTANCE_COUNT, view_projection);
+	uint32_t slice_size = config.get_draws_per_slice();
+
+	RenderGraph& graph = renderer.get_render_graph();
+	graph.clear_passes();
+	graph.add_pass("main")
+		.write(renderer.get_backbuffer(), ACCESS_COLOR_ATTACHMENT_WRITE)
+		.set_execute([&](VkCommandBuffer cmd) {
+			renderer.begin_main_pass(cmd, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+			renderer.record_parallel(cmd, scene->get_instance_count(), slice_size, [&](VkCommandBuffer secondary, uint32_t begin, uint32_t end) {
+				scene->draw_direct(secondary, view_projection, begin, end);
+			});
+			renderer.end_main_pass(cmd);
+		});
+	renderer.compile_render_graph();
+
+	bool profiler_enabled = Profiler::is_enabled();
+
+	fmt::print("{} instances, queries are only recorded while the profiler is enabled\n", INSTANCE_COUNT);
+	fmt::print("{:<10} {:>12} {:>12}\n", "profiler", "ms/frame", "gpu ms");
+
+	double frame_ms[2] = {};
+	// GPU ms per zone summed over the measured frames
+	std::map<std::string, double> zone_ms;
+	for (bool enabled : { false, true })
+	{
+		Profiler::get().set_enabled(enabled);
+
+		double gpu_sum_ms = 0.0;
+		BenchTimer timer;
+		for (uint32_t frame = 0; frame < WARMUP_FRAMES + MEASURED_FRAMES; frame++)
+		{
+			if (frame == WARMUP_FRAMES)
+			{
+				renderer.wait_idle();
+				timer = BenchTimer{};
+			}
+
+			VkCommandBuffer cmd = renderer.begin_frame();
+			if (cmd == VK_NULL_HANDLE)
+			{
+				continue;
+			}
+			renderer.execute_render_graph(cmd);
+			renderer.end_frame();
+
+			// published frames in flight late, the warmup covers frames of the other mode
+			if (enabled && frame >= WARMUP_FRAMES)
+			{
+				const GpuFrameStats& stats = renderer.get_gpu_profiler().get_frame_stats();
+				gpu_sum_ms += stats.gpu_ms;
+				for (const GpuZoneStats& zone : stats.zones)
+				{
+					zone_ms[zone.name] += zone.gpu_ms;
+				}
+			}
+		}
+		renderer.wait_idle();
+		frame_ms[enabled] = timer.elapsed_ms() / MEASURED_FRAMES;
+
+		if (enabled)
+		{
+			fmt::print("{:<10} {:>12.3f} {:>12.3f}\n", "enabled", frame_ms[enabled], gpu_sum_ms / MEASURED_FRAMES);
+		}
+		else
+		{
+			fmt::print("{:<10} {:>12.3f} {:>12}\n", "disabled", frame_ms[enabled], "-");
+		}
+	}
+
+	fmt::print("timing overhead {:.3f} ms/frame\n", frame_ms[1] - frame_ms[0]);
+	for (const auto& [name, ms] : zone_ms)
+	{
+		fmt::print("  zone {:<20} {:>10.3f} ms\n", name, ms / MEASURED_FRAMES);
+	}
+
+	Profiler::get().set_enabled(profiler_enabled);
+}
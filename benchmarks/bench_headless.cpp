@@ -0,0 +1,106 @@
+#include "bench.h"
+
+#include "utils.h"
+
+// lib
+#include <fmt/core.h>
+
+// std
+#include <algorithm>
+
+namespace {
+
+constexpr uint32_t INSTANCE_COUNTS[] = { 1000, 10000, 100000 };
+
+constexpr uint32_t WARMUP_FRAMES = 10;
+constexpr uint32_t MEASURED_FRAMES = 100;
+
+}
+
+void bench_headless(Config& config)
+{
+	BenchRenderer bench{ config };
+	Renderer& renderer = bench.renderer;
+
+	// the path Engine takes for the test scene
+	bool indirect = config.is_gpu_driven_enabled() && renderer.get_device().is_gpu_driven_supported();
+	uint32_t slice_size = config.get_draws_per_slice();
+
+	VkExtent2D extent = { static_cast<uint32_t>(config.get_window_width()), static_cast<uint32_t>(config.get_window_height()) };
+	fmt::print("{}x{} offscreen, {} draws, wall time including the GPU\n", extent.width, extent.height, indirect ? "indirect" : "CPU recorded");
+	fmt::print("{:>10} {:>10} {:>12} {:>10}\n", "instances", "readback", "ms/frame", "fps");
+
+	for (uint32_t instance_count : INSTANCE_COUNTS)
+	{
+		glm::mat4 view_projection{ 1.0f };
+		std::unique_ptr<GpuScene> scene = create_bench_scene(config, renderer, instance_count, view_projection);
+
+		RenderGraph& graph = renderer.get_render_graph();
+		graph.clear_passes();
+		if (indirect)
+		{
+			graph.add_pass("cull")
+				.set_side_effects()
+				.set_execute([&](VkCommandBuffer cmd) {
+					scene->cull(cmd, view_projection);
+				});
+
+			graph.add_pass("main")
+				.write(renderer.get_backbuffer(), ACCESS_COLOR_ATTACHMENT_WRITE)
+				.set_execute([&](VkCommandBuffer cmd) {
+					renderer.begin_main_pass(cmd);
+					scene->draw_indirect(cmd, view_projection);
+					renderer.end_main_pass(cmd);
+				});
+		}
+		else
+		{
+			graph.add_pass("main")
+				.write(renderer.get_backbuffer(), ACCESS_COLOR_ATTACHMENT_WRITE)
+				.set_execute([&](VkCommandBuffer cmd) {
+					renderer.begin_main_pass(cmd, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+					renderer.record_parallel(cmd, scene->get_instance_count(), slice_size, [&](VkCommandBuffer secondary, uint32_t begin, uint32_t end) {
+						scene->draw_direct(secondary, view_projection, begin, end);
+					});
+					renderer.end_main_pass(cmd);
+				});
+		}
+		renderer.compile_render_graph();
+
+		// every frame read back and hashed, as the headless smoke run does
+		for (bool readback : { false, true })
+		{
+			uint64_t checksum = 0;
+			BenchTimer timer;
+			for (uint32_t frame = 0; frame < WARMUP_FRAMES + MEASURED_FRAMES; frame++)
+			{
+				if (frame == WARMUP_FRAMES)
+				{
+					renderer.wait_idle();
+					timer = BenchTimer{};
+				}
+
+				VkCommandBuffer cmd = renderer.begin_frame();
+				if (cmd == VK_NULL_HANDLE)
+				{
+					continue;
+				}
+				renderer.execute_render_graph(cmd);
+				if (readback)
+				{
+					renderer.read_back_frame([&checksum](ReadbackImage&& image) {
+						checksum ^= hash_bytes(image.pixels.data(), image.pixels.size());
+					});
+				}
+				renderer.end_frame();
+			}
+			renderer.flush_readbacks();
+			double ms = timer.elapsed_ms() / MEASURED_FRAMES;
+
+			fmt::print("{:>10} {:>10} {:>12.3f} {:>10.1f}\n", instance_count, readback ? "memory" : "none", ms, 1000.0 / ms);
+		}
+
+		renderer.wait_idle();
+		graph.clear_passes();
+	}
+}
@@ -0,0 +1,105 @@
+#include "bench.h"
+
+// lib
+#include <fmt/core.h>
+
+// std
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t WAVE_COUNT = 256;
+constexpr uint32_t JOBS_PER_WAVE = 4096;
+
+constexpr uint32_t ROOT_JOBS = 64;
+constexpr uint32_t CHILD_JOBS = 1024;
+
+// roughly a hundred nanoseconds of work, so scheduling overhead dominates
+void do_work(uint32_t seed)
+{
+	uint32_t value = seed;
+	for (uint32_t i = 0; i < 64; i++)
+	{
+		value = value * 1664525u + 1013904223u;
+	}
+	volatile uint32_t sink = value;
+	(void)sink;
+}
+
+void report(const char* scenario, uint32_t workers, uint64_t jobs, double ms, const JobSystemStats& before, const JobSystemStats& after)
+{
+	uint64_t steals = after.steals - before.steals;
+	uint64_t failed = after.failed_steals - before.failed_steals;
+	uint64_t attempts = steals + failed;
+	fmt::print("{:<8} {:>8} {:>10} {:>10.2f} {:>10.2f} {:>10} {:>10.1f}% {:>10}\n", scenario, workers, jobs, ms,
+		jobs / ms / 1000.0, steals, attempts > 0 ? 100.0 * failed / attempts : 0.0, after.pool_overflows - before.pool_overflows);
+}
+
+// the main thread submits everything, the other workers only steal
+void run_flat(JobSystem& job_system)
+{
+	for (uint32_t wave = 0; wave < WAVE_COUNT; wave++)
+	{
+		JobCounter counter{ 0 };
+		for (uint32_t i = 0; i < JOBS_PER_WAVE; i++)
+		{
+			job_system.run([i]() { do_work(i); }, &counter);
+		}
+		job_system.wait_for(counter);
+	}
+}
+
+// root jobs fan out on the worker that picked them up, stealing spreads the children
+void run_spawn(JobSystem& job_system)
+{
+	JobCounter counter{ 0 };
+	for (uint32_t root = 0; root < ROOT_JOBS; root++)
+	{
+		job_system.run([&job_system, root]() {
+			JobCounter children{ 0 };
+			for (uint32_t i = 0; i < CHILD_JOBS; i++)
+			{
+				job_system.run([root, i]() { do_work(root * CHILD_JOBS + i); }, &children);
+			}
+			job_system.wait_for(children);
+		}, &counter);
+	}
+	job_system.wait_for(counter);
+}
+
+}
+
+void bench_jobs(Config&)
+{
+	uint32_t max_workers = std::max(1u, std::thread::hardware_concurrency());
+
+	std::vector<uint32_t> worker_counts;
+	for (uint32_t workers = 1; workers < max_workers; workers *= 2)
+	{
+		worker_counts.push_back(workers);
+	}
+	worker_counts.push_back(max_workers);
+
+	fmt::print("{:<8} {:>8} {:>10} {:>10} {:>10} {:>10} {:>11} {:>10}\n", "scenario", "workers", "jobs", "ms", "Mjobs/s", "steals", "contended", "overflows");
+
+	for (uint32_t workers : worker_counts)
+	{
+		JobSystem job_system{ workers };
+
+		JobSystemStats before = job_system.get_stats();
+		BenchTimer flat_timer;
+		run_flat(job_system);
+		double flat_ms = flat_timer.elapsed_ms();
+		JobSystemStats after = job_system.get_stats();
+		report("flat", workers, uint64_t{ WAVE_COUNT } * JOBS_PER_WAVE, flat_ms, before, after);
+
+		before = after;
+		BenchTimer spawn_timer;
+		run_spawn(job_system);
+		double spawn_ms = spawn_timer.elapsed_ms();
+		after = job_system.get_stats();
+		report("spawn", workers, uint64_t{ ROOT_JOBS } * (CHILD_JOBS + 1), spawn_ms, before, after);
+	}
+}
@@ -0,0 +1,99 @@
+#include "bench.h"
+
+// core
+#include "core/log.h"
+
+// lib
+#include <fmt/core.h>
+
+// std
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t BURST_COUNT = 64;
+// fits a thread's LogRing, so no record is dropped and no warning waits
+constexpr uint32_t RECORDS_PER_BURST = 1024;
+
+constexpr const char* SYNC_LOG_FILE = "bench_logger_sync.log";
+
+// The j* macros before the asynchronous Logger, formatted and written on the calling thread
+#define bench_sync_info(file, ...) do { \
+	fmt::print(file, "\033[1;38;2;128;128;128m[INFO] "); \
+	fmt::print(file, __VA_ARGS__); \
+	fmt::print(file, "\n\033[0m"); \
+} while (0)
+
+// Average ns per call on the logging threads. Bursts are timed on their own, the logger thread
+// drains between them.
+template<typename F>
+double run(uint32_t thread_count, F&& log)
+{
+	std::vector<double> burst_ms(thread_count);
+	for (uint32_t burst = 0; burst < BURST_COUNT; burst++)
+	{
+		std::vector<std::thread> threads;
+		for (uint32_t t = 0; t < thread_count; t++)
+		{
+			threads.emplace_back([&, t]() {
+				BenchTimer timer;
+				for (uint32_t i = 0; i < RECORDS_PER_BURST; i++)
+				{
+					log(burst * RECORDS_PER_BURST + i, t);
+				}
+				burst_ms[t] += timer.elapsed_ms();
+			});
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		Logger::get().flush();
+	}
+
+	double total_ms = 0.0;
+	for (double ms : burst_ms)
+	{
+		total_ms += ms;
+	}
+	return total_ms * 1e6 / (double{ BURST_COUNT } * RECORDS_PER_BURST * thread_count);
+}
+
+}
+
+void bench_logger(Config&)
+{
+	uint32_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+
+	std::vector<uint32_t> thread_counts;
+	for (uint32_t threads = 1; threads < max_threads; threads *= 2)
+	{
+		thread_counts.push_back(threads);
+	}
+	thread_counts.push_back(max_threads);
+
+	std::FILE* sync_file = std::fopen(SYNC_LOG_FILE, "w");
+	if (!sync_file)
+	{
+		throw std::runtime_error(fmt::format("bench logger: could not open {}", SYNC_LOG_FILE));
+	}
+
+	fmt::print("{:>8} {:>14} {:>14} {:>10}\n", "threads", "Logger ns", "sync ns", "speedup");
+
+	for (uint32_t threads : thread_counts)
+	{
+		double async_ns = run(threads, [](uint32_t frame, uint32_t thread) {
+			jinfo("frame {} recorded {} draws in {:.3f} ms on {}", frame, thread * 16, frame * 0.001, "bench");
+		});
+		double sync_ns = run(threads, [sync_file](uint32_t frame, uint32_t thread) {
+			bench_sync_info(sync_file, "frame {} recorded {} draws in {:.3f} ms on {}", frame, thread * 16, frame * 0.001, "bench");
+		});
+		fmt::print("{:>8} {:>14.1f} {:>14.1f} {:>9.1f}x\n", threads, async_ns, sync_ns, sync_ns / async_ns);
+	}
+
+	std::fclose(sync_file);
+	std::remove(SYNC_LOG_FILE);
+}
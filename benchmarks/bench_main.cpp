@@ -0,0 +1,95 @@
+// Opt-in benchmarks, configure with -DLUCIDA_BUILD_BENCHMARKS=ON and run from the build directory:
+//
+//   LucidaBench [name|all] [--config bench.json]
+//
+// Benchmarks that need a device render headless with the settings of bench.json, validation
+// layers and the pipeline cache file are off. To measure lavapipe point the loader at its ICD
+// with VK_DRIVER_FILES (VK_ICD_FILENAMES on older loaders) and set MESA_SHADER_CACHE_DISABLE=true
+// so compiles are not served from mesa's own disk cache.
+
+#include "bench.h"
+
+// core
+#include "core/log.h"
+
+// lib
+#include <fmt/core.h>
+
+// std
+#include <exception>
+#include <string>
+#include <string_view>
+
+namespace {
+
+struct Benchmark {
+	const char* name;
+	const char* description;
+	void (*run)(Config& config);
+};
+
+constexpr Benchmark BENCHMARKS[] = {
+	{ "pipeline_compile", "pipeline compile time from 1 to every hardware thread", bench_pipeline_compile },
+	{ "upload", "staging ring throughput into a device local buffer", bench_upload },
+	{ "jobs", "job throughput and steal contention from 1 to every hardware thread", bench_jobs },
+	{ "recording", "parallel command recording over job workers and draw counts", bench_recording },
+	{ "gpu_driven", "CPU recorded draws against culled indirect draws at 100k instances", bench_gpu_driven },
+	{ "mesh", "load time and vertex shader invocations of a raw against a cooked mesh", bench_mesh },
+	{ "logger", "cost per call of the asynchronous Logger against formatting and writing in place", bench_logger },
+	{ "headless", "offscreen frame throughput with and without readback, e.g. on lavapipe", bench_headless },
+	{ "gpu_profiler", "frame time with GPU timestamp and statistics queries off and on, GPU ms per zone", bench_gpu_profiler },
+};
+
+}
+
+int main(int argc, char** argv)
+{
+	std::string name = "all";
+	std::string config_path = "bench.json";
+	for (int i = 1; i < argc; i++)
+	{
+		std::string_view arg = argv[i];
+		if (arg == "--config" && i + 1 < argc)
+		{
+			config_path = argv[++i];
+		}
+		else
+		{
+			name = arg;
+		}
+	}
+
+	try {
+		Config config{ config_path };
+
+		bool found = false;
+		for (const Benchmark& benchmark : BENCHMARKS)
+		{
+			if (name != "all" && name != benchmark.name)
+			{
+				continue;
+			}
+
+			found = true;
+			fmt::print("== {}: {}\n", benchmark.name, benchmark.description);
+			benchmark.run(config);
+		}
+
+		if (!found)
+		{
+			fmt::print("unknown benchmark {}, available:\n", name);
+			for (const Benchmark& benchmark : BENCHMARKS)
+			{
+				fmt::print("  {:<20} {}\n", benchmark.name, benchmark.description);
+			}
+			return 1;
+		}
+	}
+	catch (std::exception& e)
+	{
+		jerr("exception: {}", e.what());
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,314 @@
+#include "bench.h"
+
+// core
+#include "core/profile/profiler.h"
+
+#include "graphics/buffer.h"
+#include "graphics/mesh_file.h"
+#include "graphics/mesh_loader.h"
+#include "graphics/pipeline.h"
+#include "graphics/shader.h"
+#include "tools/mesh_optimizer.h"
+
+// lib
+#include <fmt/core.h>
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// quads per side of the test grid, 263k vertices and 524k triangles
+constexpr uint32_t GRID_SIZE = 512;
+constexpr uint32_t CACHE_SIZE = 16;
+constexpr uint32_t LOAD_RUNS = 5;
+constexpr uint32_t STATISTICS_FRAMES = 8;
+
+constexpr const char* RAW_PATH = "bench_mesh.raw";
+constexpr const char* COOKED_PATH = "bench_mesh.lmesh";
+
+// What the mesh costs uncooked, float attributes and 32 bit indices
+struct RawVertex {
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec4 color;
+	glm::vec2 uv;
+};
+
+struct RawMesh {
+	std::vector<RawVertex> vertices;
+	std::vector<uint32_t> indices;
+};
+
+// Triangles are shuffled, exporters rarely write them in an order the vertex cache likes
+RawMesh generate_mesh()
+{
+	RawMesh mesh;
+	uint32_t side = GRID_SIZE + 1;
+	mesh.vertices.reserve(side * side);
+	for (uint32_t y = 0; y < side; y++)
+	{
+		for (uint32_t x = 0; x < side; x++)
+		{
+			glm::vec2 uv = { static_cast<float>(x) / GRID_SIZE, static_cast<float>(y) / GRID_SIZE };
+			mesh.vertices.push_back({ { uv.x * 1.8f - 0.9f, uv.y * 1.8f - 0.9f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { uv.x, uv.y, 1.0f, 1.0f }, uv });
+		}
+	}
+
+	std::vector<uint32_t> quads(GRID_SIZE * GRID_SIZE * 2);
+	for (uint32_t i = 0; i < quads.size(); i++)
+	{
+		quads[i] = i;
+	}
+	std::shuffle(quads.begin(), quads.end(), std::mt19937{ 1 });
+
+	mesh.indices.reserve(quads.size() * 3);
+	for (uint32_t triangle : quads)
+	{
+		uint32_t quad = triangle / 2;
+		uint32_t corner = (quad / GRID_SIZE) * side + quad % GRID_SIZE;
+		if (triangle % 2 == 0)
+		{
+			mesh.indices.insert(mesh.indices.end(), { corner, corner + 1, corner + side + 1 });
+		}
+		else
+		{
+			mesh.indices.insert(mesh.indices.end(), { corner, corner + side + 1, corner + side });
+		}
+	}
+	return mesh;
+}
+
+void write_raw(const std::string& filename, const RawMesh& mesh)
+{
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	uint32_t counts[2] = { static_cast<uint32_t>(mesh.vertices.size()), static_cast<uint32_t>(mesh.indices.size()) };
+	file.write(reinterpret_cast<const char*>(counts), sizeof(counts));
+	file.write(reinterpret_cast<const char*>(mesh.vertices.data()), mesh.vertices.size() * sizeof(RawVertex));
+	file.write(reinterpret_cast<const char*>(mesh.indices.data()), mesh.indices.size() * sizeof(uint32_t));
+	if (!file)
+	{
+		throw std::runtime_error("failed to write " + filename);
+	}
+}
+
+RawMesh read_raw(const std::string& filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	uint32_t counts[2] = {};
+	file.read(reinterpret_cast<char*>(counts), sizeof(counts));
+
+	RawMesh mesh;
+	mesh.vertices.resize(counts[0]);
+	mesh.indices.resize(counts[1]);
+	file.read(reinterpret_cast<char*>(mesh.vertices.data()), mesh.vertices.size() * sizeof(RawVertex));
+	file.read(reinterpret_cast<char*>(mesh.indices.data()), mesh.indices.size() * sizeof(uint32_t));
+	if (!file)
+	{
+		throw std::runtime_error("failed to read " + filename);
+	}
+	return mesh;
+}
+
+struct GpuMesh {
+	Buffer vertices;
+	Buffer indices;
+	uint32_t index_count;
+};
+
+Buffer create_vertex_buffer(Device& device, VkDeviceSize size)
+{
+	return Buffer{ device, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, MemoryUsage::DeviceLocal };
+}
+
+Buffer create_index_buffer(Device& device, VkDeviceSize size)
+{
+	return Buffer{ device, size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, MemoryUsage::DeviceLocal };
+}
+
+// read the file and upload it as is
+GpuMesh load_raw(Renderer& renderer)
+{
+	RawMesh mesh = read_raw(RAW_PATH);
+	Device& device = renderer.get_device();
+	Uploader& uploader = renderer.get_uploader();
+
+	GpuMesh gpu_mesh{
+		create_vertex_buffer(device, mesh.vertices.size() * sizeof(RawVertex)),
+		create_index_buffer(device, mesh.indices.size() * sizeof(uint32_t)),
+		static_cast<uint32_t>(mesh.indices.size())
+	};
+
+	// in pieces the staging ring can hold
+	VkDeviceSize chunk = uploader.get_capacity() / 4;
+	auto upload = [&](Buffer& dst, const void* data, VkDeviceSize size) {
+		for (VkDeviceSize offset = 0; offset < size; offset += chunk)
+		{
+			uploader.upload_buffer(dst, static_cast<const std::byte*>(data) + offset, std::min(chunk, size - offset), offset);
+		}
+	};
+	upload(gpu_mesh.vertices, mesh.vertices.data(), mesh.vertices.size() * sizeof(RawVertex));
+	upload(gpu_mesh.indices, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+	uploader.wait(uploader.flush());
+	return gpu_mesh;
+}
+
+// map the file and stream it, the runtime path of cooked meshes
+GpuMesh load_cooked(Renderer& renderer)
+{
+	MeshFile mesh{ COOKED_PATH };
+	Device& device = renderer.get_device();
+
+	GpuMesh gpu_mesh{
+		create_vertex_buffer(device, mesh.get_vertex_count() * sizeof(CompactVertex)),
+		create_index_buffer(device, mesh.get_index_count() * sizeof(uint32_t)),
+		mesh.get_index_count()
+	};
+	renderer.get_uploader().wait(stream_mesh(renderer.get_uploader(), mesh, gpu_mesh.vertices, 0, gpu_mesh.indices, 0));
+	return gpu_mesh;
+}
+
+template<typename F>
+double time_load(F&& load)
+{
+	double best_ms = 0.0;
+	for (uint32_t run = 0; run < LOAD_RUNS; run++)
+	{
+		BenchTimer timer;
+		GpuMesh mesh = load();
+		double ms = timer.elapsed_ms();
+		best_ms = run == 0 ? ms : std::min(best_ms, ms);
+	}
+	return best_ms;
+}
+
+Pipeline create_pipeline(Renderer& renderer, const Shader& vert, const Shader& frag, uint32_t stride, VkFormat position_format)
+{
+	VkVertexInputBindingDescription binding = { 0, stride, VK_VERTEX_INPUT_RATE_VERTEX };
+	VkVertexInputAttributeDescription attribute = { 0, 0, position_format, 0 };
+
+	std::vector<PipelineBuilder> builders;
+	builders.push_back(renderer.create_pipeline_builder()
+		.add_shader_stage(vert, VK_SHADER_STAGE_VERTEX_BIT)
+		.add_shader_stage(frag, VK_SHADER_STAGE_FRAGMENT_BIT)
+		.set_vertex_input({ &binding, 1 }, { &attribute, 1 })
+		.set_dynamic_states(VK_DYNAMIC_STATE_VIEWPORT)
+		.set_dynamic_states(VK_DYNAMIC_STATE_SCISSOR)
+		.add_color_blend_attachment());
+	return std::move(renderer.get_pipeline_compiler().compile_batch(std::move(builders))[0]);
+}
+
+const GpuZoneStats* find_zone(const GpuFrameStats& stats, const char* name)
+{
+	for (const GpuZoneStats& zone : stats.zones)
+	{
+		if (zone.name && std::strcmp(zone.name, name) == 0)
+		{
+			return &zone;
+		}
+	}
+	return nullptr;
+}
+
+}
+
+void bench_mesh(Config& config)
+{
+	RawMesh raw = generate_mesh();
+	write_raw(RAW_PATH, raw);
+
+	std::vector<glm::vec3> positions(raw.vertices.size());
+	std::vector<glm::vec3> normals(raw.vertices.size());
+	std::vector<glm::vec4> colors(raw.vertices.size());
+	std::vector<glm::vec2> uvs(raw.vertices.size());
+	for (size_t i = 0; i < raw.vertices.size(); i++)
+	{
+		positions[i] = raw.vertices[i].position;
+		normals[i] = raw.vertices[i].normal;
+		colors[i] = raw.vertices[i].color;
+		uvs[i] = raw.vertices[i].uv;
+	}
+	CookedMesh cooked = cook_mesh(positions, normals, colors, uvs, raw.indices, CACHE_SIZE);
+	MeshFile::write(COOKED_PATH, cooked);
+
+	uint32_t triangle_count = static_cast<uint32_t>(raw.indices.size() / 3);
+	VertexCacheStats raw_cache = analyze_vertex_cache(raw.indices, static_cast<uint32_t>(raw.vertices.size()), CACHE_SIZE);
+	VertexCacheStats cooked_cache = analyze_vertex_cache(cooked.indices, static_cast<uint32_t>(cooked.vertices.size()), CACHE_SIZE);
+
+	BenchRenderer bench{ config };
+	Renderer& renderer = bench.renderer;
+
+	// the files stay in the page cache between runs, so this is decode and upload rather than disk time
+	double raw_ms = time_load([&]() { return load_raw(renderer); });
+	double cooked_ms = time_load([&]() { return load_cooked(renderer); });
+
+	GpuMesh raw_mesh = load_raw(renderer);
+	GpuMesh cooked_mesh = load_cooked(renderer);
+
+	Shader vert{ renderer.get_device(), "shaders/spv/bench_mesh.vert.spv" };
+	Shader frag{ renderer.get_device(), "shaders/spv/test.frag.spv" };
+	Pipeline raw_pipeline = create_pipeline(renderer, vert, frag, sizeof(RawVertex), VK_FORMAT_R32G32B32_SFLOAT);
+	Pipeline cooked_pipeline = create_pipeline(renderer, vert, frag, sizeof(CompactVertex), CompactVertex::Layout::ATTRIBUTES[0].format);
+
+	// one pass per mesh, so each gets a GPU zone with its own pipeline statistics
+	auto add_draw_pass = [&](const char* name, GpuMesh& mesh, Pipeline& pipeline) {
+		renderer.get_render_graph().add_pass(name)
+			.write(renderer.get_backbuffer(), ACCESS_COLOR_ATTACHMENT_WRITE)
+			.set_execute([&](VkCommandBuffer cmd) {
+				renderer.begin_main_pass(cmd);
+				pipeline.bind(cmd);
+				VkBuffer vertex_buffer = mesh.vertices.get_handle();
+				VkDeviceSize offset = 0;
+				vkCmdBindVertexBuffers(cmd, 0, 1, &vertex_buffer, &offset);
+				vkCmdBindIndexBuffer(cmd, mesh.indices.get_handle(), 0, VK_INDEX_TYPE_UINT32);
+				vkCmdDrawIndexed(cmd, mesh.index_count, 1, 0, 0, 0);
+				renderer.end_main_pass(cmd);
+			});
+	};
+	add_draw_pass("raw mesh", raw_mesh, raw_pipeline);
+	add_draw_pass("cooked mesh", cooked_mesh, cooked_pipeline);
+	renderer.compile_render_graph();
+
+	// GPU zones are only recorded while the profiler is enabled, results arrive frames in flight late
+	bool profiler_enabled = Profiler::is_enabled();
+	Profiler::get().set_enabled(true);
+	for (uint32_t frame = 0; frame < STATISTICS_FRAMES; frame++)
+	{
+		if (VkCommandBuffer cmd = renderer.begin_frame())
+		{
+			renderer.execute_render_graph(cmd);
+			renderer.end_frame();
+		}
+	}
+	renderer.wait_idle();
+	Profiler::get().set_enabled(profiler_enabled);
+
+	const GpuFrameStats& gpu_stats = renderer.get_gpu_profiler().get_frame_stats();
+	auto vs_per_triangle = [&](const char* name) -> std::string {
+		const GpuZoneStats* zone = find_zone(gpu_stats, name);
+		if (!zone || !zone->has_statistics)
+		{
+			return "n/a";
+		}
+		// statistics[1] is vertex shader invocations
+		return fmt::format("{:.3f}", static_cast<double>(zone->statistics[1]) / triangle_count);
+	};
+
+	uint64_t raw_bytes = std::filesystem::file_size(RAW_PATH);
+	uint64_t cooked_bytes = std::filesystem::file_size(COOKED_PATH);
+
+	fmt::print("{}x{} grid, {} vertices, {} triangles, best of {} loads\n", GRID_SIZE, GRID_SIZE, raw.vertices.size(), triangle_count, LOAD_RUNS);
+	fmt::print("{:<8} {:>10} {:>10} {:>12} {:>14}\n", "mesh", "MB", "load ms", "ACMR fifo16", "VS/triangle");
+	fmt::print("{:<8} {:>10.2f} {:>10.2f} {:>12.3f} {:>14}\n", "raw", raw_bytes / 1e6, raw_ms, raw_cache.acmr, vs_per_triangle("raw mesh"));
+	fmt::print("{:<8} {:>10.2f} {:>10.2f} {:>12.3f} {:>14}\n", "cooked", cooked_bytes / 1e6, cooked_ms, cooked_cache.acmr, vs_per_triangle("cooked mesh"));
+
+	std::filesystem::remove(RAW_PATH);
+	std::filesystem::remove(COOKED_PATH);
+}
@@ -0,0 +1,102 @@
+#include "bench.h"
+
+#include "graphics/shader.h"
+#include "graphics/pipeline_compiler.h"
+
+// lib
+#include <fmt/core.h>
+
+// std
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t PIPELINE_COUNT = 256;
+
+constexpr VkPrimitiveTopology TOPOLOGIES[] = {
+	VK_PRIMITIVE_TOPOLOGY_LINE_LIST,
+	VK_PRIMITIVE_TOPOLOGY_LINE_STRIP,
+	VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+	VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
+	VK_PRIMITIVE_TOPOLOGY_TRIANGLE_FAN,
+};
+
+constexpr VkDynamicState OPTIONAL_DYNAMIC_STATES[] = {
+	VK_DYNAMIC_STATE_LINE_WIDTH,
+	VK_DYNAMIC_STATE_DEPTH_BIAS,
+	VK_DYNAMIC_STATE_BLEND_CONSTANTS,
+	VK_DYNAMIC_STATE_DEPTH_BOUNDS,
+	VK_DYNAMIC_STATE_STENCIL_COMPARE_MASK,
+	VK_DYNAMIC_STATE_STENCIL_WRITE_MASK,
+	VK_DYNAMIC_STATE_STENCIL_REFERENCE,
+};
+
+// Every index below 640 is a distinct pipeline so none of them is a pipeline cache hit
+std::vector<PipelineBuilder> create_builders(Renderer& renderer, const Shader& vert, const Shader& frag)
+{
+	std::vector<PipelineBuilder> builders;
+	builders.reserve(PIPELINE_COUNT);
+	for (uint32_t i = 0; i < PIPELINE_COUNT; i++)
+	{
+		PipelineBuilder builder = renderer.create_pipeline_builder()
+			.add_shader_stage(vert, VK_SHADER_STAGE_VERTEX_BIT)
+			.add_shader_stage(frag, VK_SHADER_STAGE_FRAGMENT_BIT)
+			.set_input_assembly(TOPOLOGIES[i % std::size(TOPOLOGIES)])
+			.set_dynamic_states(VK_DYNAMIC_STATE_VIEWPORT)
+			.set_dynamic_states(VK_DYNAMIC_STATE_SCISSOR)
+			.add_color_blend_attachment();
+
+		uint32_t mask = i / static_cast<uint32_t>(std::size(TOPOLOGIES));
+		for (uint32_t bit = 0; bit < std::size(OPTIONAL_DYNAMIC_STATES); bit++)
+		{
+			if (mask & (1u << bit))
+			{
+				builder.set_dynamic_states(OPTIONAL_DYNAMIC_STATES[bit]);
+			}
+		}
+		builders.push_back(std::move(builder));
+	}
+	return builders;
+}
+
+}
+
+void bench_pipeline_compile(Config& config)
+{
+	uint32_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+
+	std::vector<uint32_t> thread_counts;
+	for (uint32_t threads = 1; threads < max_threads; threads *= 2)
+	{
+		thread_counts.push_back(threads);
+	}
+	thread_counts.push_back(max_threads);
+
+	fmt::print("{:>8} {:>12} {:>14} {:>9}\n", "threads", "total ms", "pipelines/s", "speedup");
+
+	double single_thread_ms = 0.0;
+	for (uint32_t threads : thread_counts)
+	{
+		// a new device per run starts from an empty pipeline cache
+		BenchRenderer bench{ config };
+		Renderer& renderer = bench.renderer;
+
+		Shader vert{ renderer.get_device(), "shaders/spv/test.vert.spv" };
+		Shader frag{ renderer.get_device(), "shaders/spv/test.frag.spv" };
+		std::vector<PipelineBuilder> builders = create_builders(renderer, vert, frag);
+
+		PipelineCompiler compiler{ renderer.get_device(), threads };
+
+		BenchTimer timer;
+		std::vector<Pipeline> pipelines = compiler.compile_batch(std::move(builders));
+		double ms = timer.elapsed_ms();
+
+		if (threads == 1)
+		{
+			single_thread_ms = ms;
+		}
+		fmt::print("{:>8} {:>12.2f} {:>14.0f} {:>8.2f}x\n", threads, ms, pipelines.size() * 1000.0 / ms, single_thread_ms / ms);
+	}
+}
@@ -0,0 +1,107 @@
+#include "bench.h"
+
+#include "graphics/shader.h"
+#include "graphics/pipeline.h"
+
+// lib
+#include <fmt/core.h>
+
+// std
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t DRAW_COUNTS[] = { 1000, 10000, 100000 };
+
+constexpr uint32_t WARMUP_FRAMES = 5;
+constexpr uint32_t MEASURED_FRAMES = 50;
+
+}
+
+void bench_recording(Config& config)
+{
+	uint32_t max_workers = std::max(1u, std::thread::hardware_concurrency());
+
+	std::vector<uint32_t> worker_counts;
+	for (uint32_t workers = 1; workers < max_workers; workers *= 2)
+	{
+		worker_counts.push_back(workers);
+	}
+	worker_counts.push_back(max_workers);
+
+	uint32_t slice_size = config.get_draws_per_slice();
+	fmt::print("{} draws per slice, {} frames per measurement\n", slice_size, MEASURED_FRAMES);
+	fmt::print("{:>8} {:>8} {:>12} {:>12} {:>10}\n", "workers", "draws", "record ms", "draws/ms", "speedup");
+
+	// record ms of one worker per draw count
+	std::vector<double> baseline(std::size(DRAW_COUNTS), 0.0);
+
+	for (uint32_t workers : worker_counts)
+	{
+		BenchRenderer bench{ config, workers };
+		Renderer& renderer = bench.renderer;
+
+		Shader vert{ renderer.get_device(), "shaders/spv/test.vert.spv" };
+		Shader frag{ renderer.get_device(), "shaders/spv/test.frag.spv" };
+		std::vector<PipelineBuilder> builders;
+		builders.push_back(renderer.create_pipeline_builder()
+			.add_shader_stage(vert, VK_SHADER_STAGE_VERTEX_BIT)
+			.add_shader_stage(frag, VK_SHADER_STAGE_FRAGMENT_BIT)
+			.set_dynamic_states(VK_DYNAMIC_STATE_VIEWPORT)
+			.set_dynamic_states(VK_DYNAMIC_STATE_SCISSOR)
+			.add_color_blend_attachment());
+		std::vector<Pipeline> pipelines = renderer.get_pipeline_compiler().compile_batch(std::move(builders));
+
+		// the same pass Engine records without a test scene
+		uint32_t draw_count = 0;
+		renderer.get_render_graph().add_pass("main")
+			.write(renderer.get_backbuffer(), ACCESS_COLOR_ATTACHMENT_WRITE)
+			.set_execute([&](VkCommandBuffer cmd) {
+				renderer.begin_main_pass(cmd, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+				renderer.record_parallel(cmd, draw_count, slice_size, [&](VkCommandBuffer secondary, uint32_t begin, uint32_t end) {
+					pipelines[0].bind(secondary);
+					for (uint32_t draw = begin; draw < end; draw++)
+					{
+						vkCmdDraw(secondary, 3, 1, 0, draw);
+					}
+				});
+				renderer.end_main_pass(cmd);
+			});
+		renderer.compile_render_graph();
+
+		for (size_t i = 0; i < std::size(DRAW_COUNTS); i++)
+		{
+			draw_count = DRAW_COUNTS[i];
+
+			double record_sum_ms = 0.0;
+			uint32_t measured = 0;
+			for (uint32_t frame = 0; frame < WARMUP_FRAMES + MEASURED_FRAMES; frame++)
+			{
+				VkCommandBuffer cmd = renderer.begin_frame();
+				if (cmd == VK_NULL_HANDLE)
+				{
+					continue;
+				}
+				renderer.execute_render_graph(cmd);
+				renderer.end_frame();
+
+				if (frame >= WARMUP_FRAMES)
+				{
+					record_sum_ms += renderer.get_frame_stats().record_ms;
+					measured++;
+				}
+			}
+
+			double record_ms = record_sum_ms / std::max(1u, measured);
+			if (workers == 1)
+			{
+				baseline[i] = record_ms;
+			}
+			fmt::print("{:>8} {:>8} {:>12.3f} {:>12.0f} {:>9.2f}x\n", workers, draw_count, record_ms, draw_count / record_ms, baseline[i] / record_ms);
+		}
+
+		renderer.wait_idle();
+	}
+}
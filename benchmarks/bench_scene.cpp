@@ -0,0 +1,50 @@
+#include "bench.h"
+
+// lib
+#include <glm/gtc/matrix_transform.hpp>
+
+// std
+#include <cmath>
+
+std::unique_ptr<GpuScene> create_bench_scene(const Config& config, Renderer& renderer, uint32_t instance_count, glm::mat4& view_projection)
+{
+	const Vertex cube_vertices[] = {
+		{ { -0.5f, -0.5f, -0.5f }, { 0.0f, 0.0f, 0.0f } },
+		{ {  0.5f, -0.5f, -0.5f }, { 1.0f, 0.0f, 0.0f } },
+		{ {  0.5f,  0.5f, -0.5f }, { 1.0f, 1.0f, 0.0f } },
+		{ { -0.5f,  0.5f, -0.5f }, { 0.0f, 1.0f, 0.0f } },
+		{ { -0.5f, -0.5f,  0.5f }, { 0.0f, 0.0f, 1.0f } },
+		{ {  0.5f, -0.5f,  0.5f }, { 1.0f, 0.0f, 1.0f } },
+		{ {  0.5f,  0.5f,  0.5f }, { 1.0f, 1.0f, 1.0f } },
+		{ { -0.5f,  0.5f,  0.5f }, { 0.0f, 1.0f, 1.0f } },
+	};
+	const uint32_t cube_indices[] = {
+		0, 2, 1, 0, 3, 2,
+		4, 5, 6, 4, 6, 7,
+		0, 1, 5, 0, 5, 4,
+		3, 7, 6, 3, 6, 2,
+		0, 4, 7, 0, 7, 3,
+		1, 2, 6, 1, 6, 5,
+	};
+
+	auto scene = std::make_unique<GpuScene>(renderer, instance_count, static_cast<uint32_t>(std::size(cube_vertices)), static_cast<uint32_t>(std::size(cube_indices)));
+	MeshHandle cube = scene->add_mesh(cube_vertices, cube_indices);
+
+	// the grid of Engine::create_test_scene, the camera sees roughly half of it
+	uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(instance_count))));
+	for (uint32_t i = 0; i < instance_count; i++)
+	{
+		glm::vec3 position = { static_cast<float>(i % side) * 2.0f, 0.0f, static_cast<float>(i / side) * 2.0f };
+		scene->add_instance(cube, glm::translate(glm::mat4{ 1.0f }, position));
+	}
+	scene->upload();
+
+	float extent = static_cast<float>(side) * 2.0f;
+	float aspect = static_cast<float>(config.get_window_width()) / static_cast<float>(config.get_window_height());
+	glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(60.0f), aspect, 0.1f, extent * 2.0f);
+	projection[1][1] *= -1.0f;
+	glm::mat4 view = glm::lookAtRH(glm::vec3{ extent * 0.5f, extent * 0.25f, -extent * 0.1f }, glm::vec3{ extent * 0.5f, 0.0f, extent * 0.5f }, glm::vec3{ 0.0f, 1.0f, 0.0f });
+	view_projection = projection * view;
+
+	return scene;
+}
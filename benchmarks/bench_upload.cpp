@@ -0,0 +1,77 @@
+#include "bench.h"
+
+#include "graphics/buffer.h"
+#include "graphics/uploader.h"
+
+// lib
+#include <fmt/core.h>
+
+// std
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace {
+
+constexpr VkDeviceSize TOTAL_BYTES = VkDeviceSize{ 512 } << 20;
+
+constexpr VkDeviceSize CHUNK_SIZES[] = {
+	VkDeviceSize{ 4 } << 10,
+	VkDeviceSize{ 64 } << 10,
+	VkDeviceSize{ 1 } << 20,
+	VkDeviceSize{ 16 } << 20,
+};
+
+// copies per flush, roughly what a streaming frame batches
+constexpr uint32_t CHUNKS_PER_FLUSH = 16;
+
+}
+
+void bench_upload(Config& config)
+{
+	BenchRenderer bench{ config };
+	Device& device = bench.renderer.get_device();
+	Uploader& uploader = bench.renderer.get_uploader();
+
+	VkDeviceSize max_chunk = std::min(CHUNK_SIZES[std::size(CHUNK_SIZES) - 1], uploader.get_capacity());
+	std::vector<std::byte> source(max_chunk);
+	for (size_t i = 0; i < source.size(); i++)
+	{
+		source[i] = static_cast<std::byte>(i * 31);
+	}
+
+	// chunks wrap around the destination, only the transfer rate matters
+	Buffer destination{ device, max_chunk * CHUNKS_PER_FLUSH, VK_BUFFER_USAGE_TRANSFER_DST_BIT, MemoryUsage::DeviceLocal };
+
+	fmt::print("staging ring {} MB, {} MB per run\n", uploader.get_capacity() >> 20, TOTAL_BYTES >> 20);
+	fmt::print("{:>10} {:>8} {:>12} {:>10}\n", "chunk KB", "chunks", "total ms", "MB/s");
+
+	for (VkDeviceSize chunk : CHUNK_SIZES)
+	{
+		if (chunk > uploader.get_capacity())
+		{
+			fmt::print("{:>10} skipped, larger than the staging ring\n", chunk >> 10);
+			continue;
+		}
+
+		uint64_t chunk_count = TOTAL_BYTES / chunk;
+
+		// staging copies, command recording, submission and the transfer itself
+		BenchTimer timer;
+		UploadTicket ticket = 0;
+		for (uint64_t i = 0; i < chunk_count; i++)
+		{
+			uploader.upload_buffer(destination, source.data(), chunk, (i % CHUNKS_PER_FLUSH) * chunk);
+			if (i % CHUNKS_PER_FLUSH == CHUNKS_PER_FLUSH - 1)
+			{
+				ticket = uploader.flush();
+			}
+		}
+		ticket = uploader.flush();
+		uploader.wait(ticket);
+		double ms = timer.elapsed_ms();
+
+		double megabytes = static_cast<double>(chunk_count * chunk) / (1024.0 * 1024.0);
+		fmt::print("{:>10} {:>8} {:>12.2f} {:>10.0f}\n", chunk >> 10, chunk_count, ms, megabytes * 1000.0 / ms);
+	}
+}
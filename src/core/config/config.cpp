@@ -4,32 +4,358 @@
 #include "core/log.h"
 
 // std
+#include <algorithm>
 #include <fstream>
+#include <stdexcept>
+
+namespace {
+
+// Reads and type checks values by JSON pointer, errors name the offending key
+class SettingsReader {
+public:
+
+	SettingsReader(const json& root, const std::string& source)
+		: m_root{root}
+		, m_source{source}
+	{
+	}
+
+	const json& at(const std::string& path) const
+	{
+		json::json_pointer pointer{ path };
+		if (!m_root.contains(pointer))
+		{
+			fail(path, "is missing");
+		}
+		return m_root.at(pointer);
+	}
+
+	bool read_bool(const std::string& path) const
+	{
+		const json& value = at(path);
+		if (!value.is_boolean())
+		{
+			fail(path, "must be true or false");
+		}
+		return value.get<bool>();
+	}
+
+	uint32_t read_uint(const std::string& path, uint32_t min = 0, uint32_t max = UINT32_MAX) const
+	{
+		const json& value = at(path);
+		if (!value.is_number_unsigned() || value.get<uint64_t>() < min || value.get<uint64_t>() > max)
+		{
+			fail(path, fmt::format("must be an integer in [{}, {}]", min, max));
+		}
+		return value.get<uint32_t>();
+	}
+
+	std::string read_string(const std::string& path) const
+	{
+		const json& value = at(path);
+		if (!value.is_string())
+		{
+			fail(path, "must be a string");
+		}
+		return value.get<std::string>();
+	}
+
+	std::string read_enum(const std::string& path, const std::vector<std::string>& allowed) const
+	{
+		std::string value = read_string(path);
+		if (std::find(allowed.begin(), allowed.end(), value) == allowed.end())
+		{
+			std::string names;
+			for (const auto& name : allowed)
+			{
+				names += names.empty() ? name : ", " + name;
+			}
+			fail(path, "must be one of " + names);
+		}
+		return value;
+	}
+
+	std::vector<std::string> read_strings(const std::string& path) const
+	{
+		const json& value = at(path);
+		if (!value.is_array() || !std::all_of(value.begin(), value.end(), [](const json& item) { return item.is_string(); }))
+		{
+			fail(path, "must be an array of strings");
+		}
+		return value.get<std::vector<std::string>>();
+	}
+
+	Version read_version(const std::string& path) const
+	{
+		const json& value = at(path);
+		if (!value.is_array() || value.size() != 3 || !std::all_of(value.begin(), value.end(), [](const json& item) { return item.is_number_unsigned(); }))
+		{
+			fail(path, "must be [major, minor, patch]");
+		}
+		return { value[0].get<uint32_t>(), value[1].get<uint32_t>(), value[2].get<uint32_t>() };
+	}
+
+private:
+
+	[[noreturn]] void fail(const std::string& path, const std::string& message) const
+	{
+		throw std::runtime_error(fmt::format("{}: {} {}", m_source, path.substr(1), message));
+	}
+
+	const json& m_root;
+	const std::string& m_source;
+};
+
+// Keys the defaults don't know are most likely typos
+void warn_unknown_keys(const json& user, const json& defaults, const std::string& path)
+{
+	for (auto it = user.begin(); it != user.end(); ++it)
+	{
+		std::string key = path.empty() ? it.key() : path + "." + it.key();
+		if (!defaults.contains(it.key()))
+		{
+			jwarn("config: unknown key {}", key);
+		}
+		else if (it.value().is_object() && defaults[it.key()].is_object())
+		{
+			warn_unknown_keys(it.value(), defaults[it.key()], key);
+		}
+	}
+}
+
+}
 
 Config::Config(const std::string& path)
+	: m_path{path}
+	, m_current{ std::make_shared<const Settings>(load(path, false)) }
 {
-	std::ifstream file(path);
+	if (m_current->config.hot_reload)
+	{
+		m_watcher = std::make_unique<FileWatcher>(m_path, [this]() { reload(); });
+		jinfo("config: watching {} for changes", m_path);
+	}
+}
+
+Config::~Config()
+{
+	// the watcher thread calls back into this object, stop it before anything else goes
+	m_watcher.reset();
+}
 
+Settings Config::load(const std::string& path, bool require_file)
+{
+	json config = default_config();
+
+	std::ifstream file(path);
 	if (!file.is_open())
 	{
+		if (require_file)
+		{
+			throw std::runtime_error(path + ": could not be opened");
+		}
 		jerr("failed to load user config");
 		jwarn("using default config");
-		default_config();
+	}
+	else
+	{
+		json user = json::parse(file, nullptr, false);
+		if (user.is_discarded() || !user.is_object())
+		{
+			throw std::runtime_error(path + ": not a valid JSON object");
+		}
+
+		// keys missing from the file keep their default
+		warn_unknown_keys(user, config, "");
+		config.merge_patch(user);
+	}
+
+	return parse_settings(config, path);
+}
+
+void Config::reload()
+{
+	// a half written or mistyped file must not take down a running session
+	try
+	{
+		auto settings = std::make_shared<const Settings>(load(m_path, true));
+
+		std::lock_guard lock{ m_pending_mutex };
+		m_pending = std::move(settings);
+	}
+	catch (const std::exception& e)
+	{
+		jerr("config reload failed, keeping the current settings: {}", e.what());
+	}
+}
+
+void Config::poll()
+{
+	std::shared_ptr<const Settings> pending;
+	{
+		std::lock_guard lock{ m_pending_mutex };
+		pending = std::move(m_pending);
+	}
+	if (!pending)
+	{
+		return;
+	}
+
+	ConfigSections changed = diff(*m_current, *pending);
+	if (changed == 0)
+	{
 		return;
 	}
 
-	m_config = json::parse(file);
-	file.close();
+	// previous stays alive until every subscriber has seen both
+	std::shared_ptr<const Settings> previous = std::move(m_current);
+	m_current = std::move(pending);
+	jinfo("config: reloaded {}, changed sections {:#x}", m_path, changed);
+
+	for (const auto& subscriber : m_subscribers)
+	{
+		if (subscriber.sections & changed)
+		{
+			subscriber.callback(*previous, *m_current, changed);
+		}
+	}
+
+	if (!m_current->config.hot_reload)
+	{
+		jinfo("config: hot reload disabled, no longer watching {}", m_path);
+		m_watcher.reset();
+	}
+}
+
+ConfigSubscription Config::subscribe(ConfigSections sections, ConfigCallback callback)
+{
+	ConfigSubscription id = m_next_subscription++;
+	m_subscribers.push_back({ id, sections, std::move(callback) });
+	return id;
+}
+
+void Config::unsubscribe(ConfigSubscription subscription)
+{
+	std::erase_if(m_subscribers, [subscription](const Subscriber& subscriber) { return subscriber.id == subscription; });
+}
+
+ConfigSections Config::diff(const Settings& previous, const Settings& current)
+{
+	const RendererSettings& a = previous.renderer;
+	const RendererSettings& b = current.renderer;
+
+	ConfigSections changed = 0;
+	if (previous.lucida != current.lucida || previous.app != current.app)
+	{
+		changed |= CONFIG_SECTION_APP;
+	}
+	if (previous.config != current.config)
+	{
+		changed |= CONFIG_SECTION_CONFIG;
+	}
+	if (a.vulkan != b.vulkan || a.pipeline_cache != b.pipeline_cache || a.pipeline_threads != b.pipeline_threads
+		|| a.staging_size_mb != b.staging_size_mb || a.dynamic_rendering != b.dynamic_rendering || a.bindless != b.bindless)
+	{
+		changed |= CONFIG_SECTION_RENDERER;
+	}
+	if (a.present_policy != b.present_policy)
+	{
+		changed |= CONFIG_SECTION_PRESENT;
+	}
+	if (a.frames_in_flight != b.frames_in_flight)
+	{
+		changed |= CONFIG_SECTION_FRAMES_IN_FLIGHT;
+	}
+	if (a.recording != b.recording)
+	{
+		changed |= CONFIG_SECTION_RECORDING;
+	}
+	if (previous.scene != current.scene)
+	{
+		changed |= CONFIG_SECTION_SCENE;
+	}
+	if (previous.jobs != current.jobs)
+	{
+		changed |= CONFIG_SECTION_JOBS;
+	}
+	if (previous.window != current.window)
+	{
+		changed |= CONFIG_SECTION_WINDOW;
+	}
+	if (previous.headless != current.headless)
+	{
+		changed |= CONFIG_SECTION_HEADLESS;
+	}
+	if (previous.profiler != current.profiler)
+	{
+		changed |= CONFIG_SECTION_PROFILER;
+	}
+	return changed;
+}
+
+Settings Config::parse_settings(const json& config, const std::string& source)
+{
+	SettingsReader reader{ config, source };
+	Settings settings;
+
+	settings.lucida = reader.read_version("/lucida/version");
+
+	settings.config.hot_reload = reader.read_bool("/config/hot_reload");
+
+	settings.app.name = reader.read_string("/app/name");
+	settings.app.version = reader.read_version("/app/version");
+
+	RendererSettings& renderer = settings.renderer;
+	renderer.vulkan.version = reader.read_version("/renderer/vulkan/version");
+	renderer.vulkan.layers = reader.read_strings("/renderer/vulkan/layers");
+	renderer.vulkan.extensions = reader.read_strings("/renderer/vulkan/extensions");
+	renderer.pipeline_cache = reader.read_string("/renderer/pipeline_cache");
+	renderer.pipeline_threads = reader.read_uint("/renderer/pipeline_threads");
+	renderer.frames_in_flight = reader.read_uint("/renderer/frames_in_flight", 1, 8);
+	renderer.present_policy = reader.read_enum("/renderer/present/policy", { "low_latency", "throughput", "power_saving" });
+	renderer.staging_size_mb = reader.read_uint("/renderer/staging_size_mb", 1, 4096);
+	renderer.dynamic_rendering = reader.read_bool("/renderer/dynamic_rendering");
+	renderer.bindless.sampled_images = reader.read_uint("/renderer/bindless/sampled_images", 1);
+	renderer.bindless.samplers = reader.read_uint("/renderer/bindless/samplers", 1);
+	renderer.bindless.storage_buffers = reader.read_uint("/renderer/bindless/storage_buffers", 1);
+	renderer.recording.draws_per_slice = reader.read_uint("/renderer/recording/draws_per_slice", 1);
+	renderer.recording.test_draws = reader.read_uint("/renderer/recording/test_draws");
+
+	settings.scene.test_instances = reader.read_uint("/scene/test_instances");
+	settings.scene.gpu_driven = reader.read_bool("/scene/gpu_driven");
+
+	settings.jobs.workers = reader.read_uint("/jobs/workers");
+
+	settings.window.title = reader.read_string("/window/title");
+	settings.window.width = static_cast<int>(reader.read_uint("/window/width", 1, 16384));
+	settings.window.height = static_cast<int>(reader.read_uint("/window/height", 1, 16384));
+	settings.window.fullscreen = reader.read_bool("/window/fullscreen");
+	settings.window.resizable = reader.read_bool("/window/resizable");
+
+	settings.headless.enabled = reader.read_bool("/headless/enabled");
+	settings.headless.frames = reader.read_uint("/headless/frames", 1);
+	settings.headless.readback = reader.read_enum("/headless/readback", { "none", "memory", "png" });
+	settings.headless.readback_interval = reader.read_uint("/headless/readback_interval", 1);
+	settings.headless.output = reader.read_string("/headless/output");
+
+	settings.profiler.enabled = reader.read_bool("/profiler/enabled");
+	settings.profiler.output = reader.read_string("/profiler/output");
+	settings.profiler.max_events = reader.read_uint("/profiler/max_events", 1);
+
+	return settings;
 }
 
-void Config::default_config()
+json Config::default_config()
 {
-	m_config = json::parse( R"(
+	return json::parse( R"(
 	  {
 		"lucida": {
 			"version": [0,0,1]
 		},
 
+		"config": {
+			"hot_reload": false
+		},
+
 		"app": {
 			"name": "Lucida Application",
 			"version": [0,0,1]
@@ -37,18 +363,58 @@ void Config::default_config()
 
 		"renderer": {
 			"vulkan": {
-				"version": [1,0,0],
+				"version": [1,3,0],
 				"layers": [],
 				"extensions": []
+			},
+			"pipeline_cache": "pipeline_cache.bin",
+			"pipeline_threads": 0,
+			"frames_in_flight": 2,
+			"present": {
+				"policy": "throughput"
+			},
+			"staging_size_mb": 64,
+			"dynamic_rendering": true,
+			"bindless": {
+				"sampled_images": 16384,
+				"samplers": 128,
+				"storage_buffers": 16384
+			},
+			"recording": {
+				"draws_per_slice": 512,
+				"test_draws": 1
 			}
 		},
 
+		"scene": {
+			"test_instances": 0,
+			"gpu_driven": true
+		},
+
+		"jobs": {
+			"workers": 0
+		},
+
 		"window": {
 			"title": "Lucida Application",
 			"width": 640,
 			"height": 480,
 			"fullscreen": false,
 			"resizable": true
+		},
+
+		"headless": {
+			"enabled": false,
+			"frames": 300,
+			"readback": "none",
+			"readback_interval": 60,
+			"output": "frame"
+		},
+
+		"profiler": {
+			"enabled": false,
+			"output": "lucida_trace.json",
+			"max_events": 4000000
 		}
 	  }
 	)");
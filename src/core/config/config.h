@@ -1,40 +1,150 @@
 #pragma once
 
+#include "settings.h"
+#include "file_watcher.h"
+
 // lib
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
 
 // std
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
+// Parts of Settings a reload can change, subscribers ask for the ones they apply
+using ConfigSections = uint32_t;
+
+inline constexpr ConfigSections CONFIG_SECTION_APP = 1 << 0;
+inline constexpr ConfigSections CONFIG_SECTION_CONFIG = 1 << 1;
+// device, bindless and pipeline settings, only picked up by a new renderer
+inline constexpr ConfigSections CONFIG_SECTION_RENDERER = 1 << 2;
+inline constexpr ConfigSections CONFIG_SECTION_PRESENT = 1 << 3;
+inline constexpr ConfigSections CONFIG_SECTION_FRAMES_IN_FLIGHT = 1 << 4;
+inline constexpr ConfigSections CONFIG_SECTION_RECORDING = 1 << 5;
+inline constexpr ConfigSections CONFIG_SECTION_SCENE = 1 << 6;
+inline constexpr ConfigSections CONFIG_SECTION_JOBS = 1 << 7;
+inline constexpr ConfigSections CONFIG_SECTION_WINDOW = 1 << 8;
+inline constexpr ConfigSections CONFIG_SECTION_HEADLESS = 1 << 9;
+inline constexpr ConfigSections CONFIG_SECTION_PROFILER = 1 << 10;
+inline constexpr ConfigSections CONFIG_SECTION_ALL = ~ConfigSections{ 0 };
+
+using ConfigSubscription = uint32_t;
+
+// Called on the main thread by Config::poll with the settings before and after a reload
+using ConfigCallback = std::function<void(const Settings& previous, const Settings& current, ConfigSections changed)>;
+
+// Parses lucida.json into Settings. Keys missing from the file keep their defaults,
+// wrongly typed or out of range values throw with the key path. Getters are plain reads.
+//
+// With config.hot_reload the file is watched and re-parsed on a background thread. A reload
+// that fails to parse is logged and dropped. A good one is handed to the main thread as an
+// immutable Settings, which poll swaps in before it notifies the subscribers of the changed
+// sections.
 class Config {
 public:
 
 	Config(const std::string& path);
 
+	~Config();
+
+	Config(const Config&) = delete;
+	Config& operator=(const Config&) = delete;
+	Config(Config&&) = delete;
+	Config& operator=(Config&&) = delete;
+
+	// Settings of the main thread, only replaced by poll so references stay valid until then
+	const Settings& get_settings() const { return *m_current; }
+
+	// Applies a finished reload and notifies subscribers, call from the main thread
+	void poll();
+
+	// Main thread only, the callback runs for reloads that change any of sections
+	ConfigSubscription subscribe(ConfigSections sections, ConfigCallback callback);
+	void unsubscribe(ConfigSubscription subscription);
+
+	// Sections that differ between two settings
+	static ConfigSections diff(const Settings& previous, const Settings& current);
+
+	// CONFIG
+	bool is_hot_reload_enabled() const { return m_current->config.hot_reload; }
+
 	// APP
-	std::string get_app_name() { return m_config["app"]["name"]; }
-	std::vector<int> get_app_version() { return m_config["app"]["version"].get<std::vector<int>>(); }
+	const std::string& get_app_name() const { return m_current->app.name; }
+	const Version& get_app_version() const { return m_current->app.version; }
 
 	// ENGINE
-	std::vector<int> get_lucida_version() { return m_config["lucida"]["version"].get<std::vector<int>>(); }
+	const Version& get_lucida_version() const { return m_current->lucida; }
 
 	// RENDERER
-	std::vector<std::string> get_layers() { return m_config["renderer"]["vulkan"]["layers"].get<std::vector<std::string>>(); }
-	std::vector<std::string> get_extensions() { return m_config["renderer"]["vulkan"]["extensions"].get<std::vector<std::string>>(); }
-	std::vector<int> get_api_version() { return m_config["renderer"]["vulkan"]["version"].get<std::vector<int>>(); }
+	const std::vector<std::string>& get_layers() const { return m_current->renderer.vulkan.layers; }
+	const std::vector<std::string>& get_extensions() const { return m_current->renderer.vulkan.extensions; }
+	const Version& get_api_version() const { return m_current->renderer.vulkan.version; }
+	const std::string& get_pipeline_cache_path() const { return m_current->renderer.pipeline_cache; }
+	uint32_t get_pipeline_threads() const { return m_current->renderer.pipeline_threads; }
+	uint32_t get_frames_in_flight() const { return m_current->renderer.frames_in_flight; }
+	const std::string& get_present_policy() const { return m_current->renderer.present_policy; }
+	uint32_t get_staging_size_mb() const { return m_current->renderer.staging_size_mb; }
+	bool is_dynamic_rendering_enabled() const { return m_current->renderer.dynamic_rendering; }
+	uint32_t get_bindless_sampled_images() const { return m_current->renderer.bindless.sampled_images; }
+	uint32_t get_bindless_samplers() const { return m_current->renderer.bindless.samplers; }
+	uint32_t get_bindless_storage_buffers() const { return m_current->renderer.bindless.storage_buffers; }
+	uint32_t get_draws_per_slice() const { return m_current->renderer.recording.draws_per_slice; }
+	uint32_t get_test_draw_count() const { return m_current->renderer.recording.test_draws; }
+
+	// SCENE
+	uint32_t get_test_instance_count() const { return m_current->scene.test_instances; }
+	bool is_gpu_driven_enabled() const { return m_current->scene.gpu_driven; }
+
+	// JOBS
+	uint32_t get_job_workers() const { return m_current->jobs.workers; }
 
 	// WINDOW
-	std::string get_window_title() { return m_config["window"]["title"]; }
-	int get_window_width() { return m_config["window"]["width"]; }
-	int get_window_height() { return m_config["window"]["height"]; }
-	bool is_window_resizable() { return m_config["window"]["resizable"]; }
-	bool is_window_fullscreen() { return m_config["window"]["fullscreen"]; }
+	const std::string& get_window_title() const { return m_current->window.title; }
+	int get_window_width() const { return m_current->window.width; }
+	int get_window_height() const { return m_current->window.height; }
+	bool is_window_resizable() const { return m_current->window.resizable; }
+	bool is_window_fullscreen() const { return m_current->window.fullscreen; }
+
+	// HEADLESS
+	bool is_headless_enabled() const { return m_current->headless.enabled; }
+	uint32_t get_headless_frames() const { return m_current->headless.frames; }
+	const std::string& get_headless_readback() const { return m_current->headless.readback; }
+	uint32_t get_headless_readback_interval() const { return m_current->headless.readback_interval; }
+	const std::string& get_headless_output() const { return m_current->headless.output; }
+
+	// PROFILER
+	bool is_profiler_enabled() const { return m_current->profiler.enabled; }
+	const std::string& get_profiler_output() const { return m_current->profiler.output; }
+	uint32_t get_profiler_max_events() const { return m_current->profiler.max_events; }
 
 private:
 
-	void default_config();
+	struct Subscriber {
+		ConfigSubscription id;
+		ConfigSections sections;
+		ConfigCallback callback;
+	};
+
+	static json default_config();
+	static Settings load(const std::string& path, bool require_file);
+	static Settings parse_settings(const json& config, const std::string& source);
+
+	// runs on the watcher thread
+	void reload();
+
+	std::string m_path;
+
+	// owned by the main thread
+	std::shared_ptr<const Settings> m_current;
+	std::vector<Subscriber> m_subscribers;
+	ConfigSubscription m_next_subscription = 1;
+
+	// parsed by the watcher, waiting for the next poll
+	std::mutex m_pending_mutex;
+	std::shared_ptr<const Settings> m_pending;
 
-	json m_config;
-};
\ No newline at end of file
+	std::unique_ptr<FileWatcher> m_watcher;
+};
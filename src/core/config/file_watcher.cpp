@@ -0,0 +1,112 @@
+#include "file_watcher.h"
+
+// core
+#include "core/log.h"
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+FileWatcher::FileWatcher(const std::filesystem::path& path, std::function<void()> on_change)
+	: m_path{path}
+	, m_on_change{std::move(on_change)}
+{
+	jinfo("file watcher constructor");
+
+#if defined(__linux__)
+	std::filesystem::path directory = m_path.has_parent_path() ? m_path.parent_path() : std::filesystem::path{ "." };
+
+	m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_inotify >= 0 && inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+	{
+		close(m_inotify);
+		m_inotify = -1;
+	}
+	if (m_inotify < 0)
+	{
+		jwarn("inotify unavailable for {}, polling instead", directory.string());
+	}
+#endif
+
+	m_thread = std::thread{ &FileWatcher::watch, this };
+}
+
+FileWatcher::~FileWatcher()
+{
+	jinfo("file watcher destructor");
+
+	m_stop.store(true, std::memory_order_relaxed);
+	m_thread.join();
+
+#if defined(__linux__)
+	if (m_inotify >= 0)
+	{
+		close(m_inotify);
+	}
+#endif
+}
+
+void FileWatcher::watch()
+{
+#if defined(__linux__)
+	if (m_inotify >= 0)
+	{
+		std::string name = m_path.filename().string();
+		alignas(inotify_event) char buffer[4096];
+		bool changed = false;
+
+		while (!m_stop.load(std::memory_order_relaxed))
+		{
+			// once the file was touched only wait for the writes to settle, then report
+			pollfd fd = { .fd = m_inotify, .events = POLLIN };
+			int timeout = static_cast<int>(changed ? SETTLE_TIME.count() : POLL_INTERVAL.count());
+			int ready = poll(&fd, 1, timeout);
+			if (ready < 0 && errno != EINTR)
+			{
+				jerr("file watcher: poll failed, {} is no longer watched", m_path.string());
+				return;
+			}
+			if (ready <= 0)
+			{
+				if (changed)
+				{
+					changed = false;
+					m_on_change();
+				}
+				continue;
+			}
+
+			ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+			for (ssize_t offset = 0; offset < length;)
+			{
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+				if (event->len > 0 && name == event->name)
+				{
+					changed = true;
+				}
+				offset += sizeof(inotify_event) + event->len;
+			}
+		}
+		return;
+	}
+#endif
+
+	std::error_code error;
+	std::filesystem::file_time_type last_write = std::filesystem::last_write_time(m_path, error);
+
+	while (!m_stop.load(std::memory_order_relaxed))
+	{
+		std::this_thread::sleep_for(POLL_INTERVAL);
+
+		std::filesystem::file_time_type write_time = std::filesystem::last_write_time(m_path, error);
+		if (!error && write_time != last_write)
+		{
+			last_write = write_time;
+			std::this_thread::sleep_for(SETTLE_TIME);
+			m_on_change();
+		}
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <thread>
+
+// Calls on_change from a background thread after the watched file was rewritten. Linux watches
+// the parent directory with inotify, so editors that save through a rename are seen as well,
+// other platforms poll the modification time. Bursts of writes are reported once.
+class FileWatcher {
+public:
+
+	// Checked this often for the stop request, and for changes when polling
+	static constexpr std::chrono::milliseconds POLL_INTERVAL{ 250 };
+
+	// Writes closer together than this are reported as one change
+	static constexpr std::chrono::milliseconds SETTLE_TIME{ 50 };
+
+	FileWatcher(const std::filesystem::path& path, std::function<void()> on_change);
+
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+	FileWatcher(FileWatcher&&) = delete;
+	FileWatcher& operator=(FileWatcher&&) = delete;
+
+private:
+
+	void watch();
+
+	std::filesystem::path m_path;
+	std::function<void()> m_on_change;
+
+	std::atomic<bool> m_stop{ false };
+	std::thread m_thread;
+
+	// inotify instance, -1 when polling
+	int m_inotify = -1;
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Typed view of lucida.json, filled and validated by Config on load and on every reload.
+// Compared section by section to find what a reload changed.
+
+struct Version {
+	uint32_t major = 0;
+	uint32_t minor = 0;
+	uint32_t patch = 0;
+
+	bool operator==(const Version&) const = default;
+};
+
+struct AppSettings {
+	std::string name;
+	Version version;
+
+	bool operator==(const AppSettings&) const = default;
+};
+
+struct VulkanSettings {
+	Version version;
+	std::vector<std::string> layers;
+	std::vector<std::string> extensions;
+
+	bool operator==(const VulkanSettings&) const = default;
+};
+
+struct BindlessSettings {
+	uint32_t sampled_images = 0;
+	uint32_t samplers = 0;
+	uint32_t storage_buffers = 0;
+
+	bool operator==(const BindlessSettings&) const = default;
+};
+
+struct RecordingSettings {
+	uint32_t draws_per_slice = 0;
+	uint32_t test_draws = 0;
+
+	bool operator==(const RecordingSettings&) const = default;
+};
+
+struct RendererSettings {
+	VulkanSettings vulkan;
+	std::string pipeline_cache;
+	uint32_t pipeline_threads = 0;
+	uint32_t frames_in_flight = 0;
+	std::string present_policy;
+	uint32_t staging_size_mb = 0;
+	bool dynamic_rendering = false;
+	BindlessSettings bindless;
+	RecordingSettings recording;
+
+	bool operator==(const RendererSettings&) const = default;
+};
+
+struct SceneSettings {
+	uint32_t test_instances = 0;
+	bool gpu_driven = false;
+
+	bool operator==(const SceneSettings&) const = default;
+};
+
+struct JobSettings {
+	uint32_t workers = 0;
+
+	bool operator==(const JobSettings&) const = default;
+};
+
+struct WindowSettings {
+	std::string title;
+	int width = 0;
+	int height = 0;
+	bool fullscreen = false;
+	bool resizable = false;
+
+	bool operator==(const WindowSettings&) const = default;
+};
+
+// Renders into offscreen images instead of a window, see Renderer::read_back_frame
+struct HeadlessSettings {
+	bool enabled = false;
+	// frames rendered before the engine exits
+	uint32_t frames = 0;
+	// none, memory or png
+	std::string readback;
+	uint32_t readback_interval = 1;
+	// png path prefix, the frame number and extension are appended
+	std::string output;
+
+	bool operator==(const HeadlessSettings&) const = default;
+};
+
+struct ProfilerSettings {
+	bool enabled = false;
+	// Chrome trace JSON written when the engine shuts down
+	std::string output;
+	uint32_t max_events = 0;
+
+	bool operator==(const ProfilerSettings&) const = default;
+};
+
+struct ConfigSettings {
+	bool hot_reload = false;
+
+	bool operator==(const ConfigSettings&) const = default;
+};
+
+struct Settings {
+	Version lucida;
+	ConfigSettings config;
+	AppSettings app;
+	RendererSettings renderer;
+	SceneSettings scene;
+	JobSettings jobs;
+	WindowSettings window;
+	HeadlessSettings headless;
+	ProfilerSettings profiler;
+
+	bool operator==(const Settings&) const = default;
+};
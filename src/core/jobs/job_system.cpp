@@ -0,0 +1,323 @@
+#include "job_system.h"
+
+// core
+#include "core/log.h"
+#include "core/profile/profiler.h"
+
+// std
+#include <algorithm>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+thread_local uint32_t t_worker_index = JobSystem::EXTERNAL_THREAD;
+
+inline void cpu_relax()
+{
+#if defined(_MSC_VER)
+	YieldProcessor();
+#elif defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#else
+	std::this_thread::yield();
+#endif
+}
+
+// Spins before a worker gives up and sleeps
+constexpr uint32_t IDLE_SPIN_COUNT = 256;
+
+}
+
+JobSystem::JobSystem(uint32_t worker_count)
+	: m_start{ std::chrono::steady_clock::now() }
+{
+	jinfo("job system constructor");
+
+	if (worker_count == 0)
+	{
+		worker_count = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	m_workers.reserve(worker_count);
+	for (uint32_t i = 0; i < worker_count; i++)
+	{
+		m_workers.push_back(std::make_unique<Worker>());
+	}
+
+	// the constructing thread is worker 0 and stays unpinned, it also drives the window and renderer
+	t_worker_index = 0;
+	Profiler::get().set_thread_name("main");
+
+	uint32_t core_count = std::max(1u, std::thread::hardware_concurrency());
+	m_threads.reserve(worker_count - 1);
+	for (uint32_t i = 1; i < worker_count; i++)
+	{
+		m_threads.emplace_back(&JobSystem::worker_loop, this, i);
+		pin_thread(m_threads.back(), i % core_count);
+	}
+
+	jdebug("job system workers: {}", worker_count);
+}
+
+JobSystem::~JobSystem()
+{
+	jinfo("job system destructor");
+
+	{
+		std::lock_guard lock{ m_sleep_mutex };
+		m_running.store(false);
+	}
+	m_wake.notify_all();
+
+	for (auto& thread : m_threads)
+	{
+		thread.join();
+	}
+
+	log_stats();
+
+	t_worker_index = EXTERNAL_THREAD;
+}
+
+uint32_t JobSystem::get_worker_index()
+{
+	return t_worker_index;
+}
+
+void JobSystem::wait_for(const JobCounter& counter)
+{
+	uint32_t index = t_worker_index;
+	while (counter.load(std::memory_order_acquire) != 0)
+	{
+		if (Job* job = find_job(index))
+		{
+			execute(job);
+		}
+		else
+		{
+			cpu_relax();
+		}
+	}
+}
+
+JobSystemStats JobSystem::get_stats() const
+{
+	JobSystemStats stats;
+	for (const auto& worker : m_workers)
+	{
+		stats.executed += worker->executed.load(std::memory_order_relaxed);
+		stats.steals += worker->steals.load(std::memory_order_relaxed);
+		stats.failed_steals += worker->failed_steals.load(std::memory_order_relaxed);
+		stats.pool_overflows += worker->pool_overflows.load(std::memory_order_relaxed);
+	}
+	return stats;
+}
+
+void JobSystem::log_stats() const
+{
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		const Worker& worker = *m_workers[i];
+		uint64_t executed = worker.executed.load(std::memory_order_relaxed);
+		uint64_t steals = worker.steals.load(std::memory_order_relaxed);
+		uint64_t failed = worker.failed_steals.load(std::memory_order_relaxed);
+		uint64_t overflows = worker.pool_overflows.load(std::memory_order_relaxed);
+		jinfo("job worker {}: {} jobs, {} steals, {} contended steals, {} pool overflows", i, executed, steals, failed, overflows);
+	}
+	uint64_t total = get_stats().executed;
+	jinfo("job system: {} jobs in {:.2f} s ({:.0f} jobs/s)", total, seconds, seconds > 0.0 ? total / seconds : 0.0);
+}
+
+Job* JobSystem::allocate_job()
+{
+	uint32_t index = t_worker_index;
+	if (index == EXTERNAL_THREAD)
+	{
+		Job* job = new Job{};
+		job->heap_allocated = true;
+		return job;
+	}
+
+	Worker& worker = *m_workers[index];
+	Job* job = &worker.jobs[worker.next_job++ & (JOB_POOL_SIZE - 1)];
+
+	// the slot's previous job is still queued or running, only when more than the pool is in flight
+	if (job->live.load(std::memory_order_acquire))
+	{
+		worker.pool_overflows.fetch_add(1, std::memory_order_relaxed);
+		job = new Job{};
+		job->heap_allocated = true;
+		return job;
+	}
+
+	job->heap_allocated = false;
+	job->live.store(true, std::memory_order_relaxed);
+	return job;
+}
+
+void JobSystem::submit(Job* job)
+{
+	uint32_t index = t_worker_index;
+	if (index == EXTERNAL_THREAD || !m_workers[index]->queue.push(job))
+	{
+		std::lock_guard lock{ m_external_mutex };
+		m_external_jobs.push_back(job);
+		m_external_count.fetch_add(1, std::memory_order_release);
+	}
+
+	m_queued.fetch_add(1, std::memory_order_seq_cst);
+	if (m_sleeping.load(std::memory_order_seq_cst) != 0)
+	{
+		std::lock_guard lock{ m_sleep_mutex };
+		m_wake.notify_one();
+	}
+}
+
+Job* JobSystem::find_job(uint32_t index)
+{
+	uint32_t worker_count = static_cast<uint32_t>(m_workers.size());
+
+	if (index != EXTERNAL_THREAD)
+	{
+		if (Job* job = m_workers[index]->queue.pop())
+		{
+			return job;
+		}
+	}
+
+	// steal round robin starting after ourselves so thieves spread over victims
+	uint32_t start = index == EXTERNAL_THREAD ? 0 : index + 1;
+	for (uint32_t i = 0; i < worker_count; i++)
+	{
+		uint32_t victim = (start + i) % worker_count;
+		if (victim == index)
+		{
+			continue;
+		}
+
+		WorkStealingQueue<Job, QUEUE_CAPACITY>& queue = m_workers[victim]->queue;
+		if (queue.empty())
+		{
+			continue;
+		}
+
+		if (Job* job = queue.steal())
+		{
+			if (index != EXTERNAL_THREAD)
+			{
+				m_workers[index]->steals.fetch_add(1, std::memory_order_relaxed);
+			}
+			return job;
+		}
+
+		if (index != EXTERNAL_THREAD)
+		{
+			m_workers[index]->failed_steals.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	if (m_external_count.load(std::memory_order_acquire) != 0)
+	{
+		std::lock_guard lock{ m_external_mutex };
+		if (!m_external_jobs.empty())
+		{
+			Job* job = m_external_jobs.front();
+			m_external_jobs.pop_front();
+			m_external_count.fetch_sub(1, std::memory_order_relaxed);
+			return job;
+		}
+	}
+
+	return nullptr;
+}
+
+void JobSystem::execute(Job* job)
+{
+	m_queued.fetch_sub(1, std::memory_order_relaxed);
+
+	JobCounter* counter = job->counter;
+	bool heap_allocated = job->heap_allocated;
+
+	job->invoke(job);
+
+	// the owner may hand the slot out again from here on
+	if (heap_allocated)
+	{
+		delete job;
+	}
+	else
+	{
+		job->live.store(false, std::memory_order_release);
+	}
+
+	if (counter)
+	{
+		counter->fetch_sub(1, std::memory_order_release);
+	}
+
+	uint32_t index = t_worker_index;
+	if (index != EXTERNAL_THREAD)
+	{
+		m_workers[index]->executed.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void JobSystem::worker_loop(uint32_t index)
+{
+	t_worker_index = index;
+	Profiler::get().set_thread_name(fmt::format("job worker {}", index));
+
+	uint32_t idle = 0;
+	while (m_running.load(std::memory_order_relaxed))
+	{
+		if (Job* job = find_job(index))
+		{
+			execute(job);
+			idle = 0;
+			continue;
+		}
+
+		if (++idle < IDLE_SPIN_COUNT)
+		{
+			cpu_relax();
+			continue;
+		}
+
+		std::unique_lock lock{ m_sleep_mutex };
+		m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+		m_wake.wait(lock, [this]() {
+			return !m_running.load(std::memory_order_relaxed) || m_queued.load(std::memory_order_seq_cst) != 0;
+		});
+		m_sleeping.fetch_sub(1, std::memory_order_relaxed);
+		idle = 0;
+	}
+}
+
+void JobSystem::pin_thread(std::thread& thread, uint32_t core)
+{
+#if defined(_WIN32)
+	if (core < sizeof(DWORD_PTR) * 8)
+	{
+		SetThreadAffinityMask(thread.native_handle(), DWORD_PTR{ 1 } << core);
+	}
+#elif defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(core, &set);
+	if (pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &set) != 0)
+	{
+		jwarn("failed to pin job worker to core {}", core);
+	}
+#else
+	(void)thread;
+	(void)core;
+#endif
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "work_stealing_queue.h"
+
+// std
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Jobs add one to the counter they were submitted with and subtract one when they finish
+using JobCounter = std::atomic<uint32_t>;
+
+// One cache line per job, the callable is stored inline so submitting never allocates
+struct alignas(64) Job {
+	static constexpr size_t STORAGE_SIZE = 64 - sizeof(void*) * 3;
+
+	void (*invoke)(Job* job) = nullptr;
+	JobCounter* counter = nullptr;
+	bool heap_allocated = false;
+	// pool slot handed out and not executed yet, the owner skips it when the ring wraps
+	std::atomic<bool> live{ false };
+	alignas(8) std::byte storage[STORAGE_SIZE];
+};
+
+static_assert(sizeof(Job) == 64);
+
+// Totals over every worker since the job system started
+struct JobSystemStats {
+	uint64_t executed = 0;
+	uint64_t steals = 0;
+	// steal attempts that lost the race for a non empty deque
+	uint64_t failed_steals = 0;
+	uint64_t pool_overflows = 0;
+};
+
+// Fixed pool of workers pinned to cores, each owning a Chase-Lev deque. Idle workers steal
+// from the others. The constructing thread is worker 0, it runs jobs while it waits.
+class JobSystem {
+public:
+
+	static constexpr size_t QUEUE_CAPACITY = 4096;
+
+	// Ring of jobs owned by each worker. When the ring wraps onto a job still in flight the
+	// submission is heap allocated instead, so any number of jobs may be in flight.
+	static constexpr size_t JOB_POOL_SIZE = 4096;
+
+	static constexpr uint32_t EXTERNAL_THREAD = UINT32_MAX;
+
+	// worker_count counts the calling thread, 0 uses every hardware thread
+	JobSystem(uint32_t worker_count);
+
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+	JobSystem(JobSystem&&) = delete;
+	JobSystem& operator=(JobSystem&&) = delete;
+
+	template<typename F>
+	void run(F&& function, JobCounter* counter = nullptr);
+
+	// Calls function(begin, end) over [0, count) in slices of at most batch_size,
+	// every slice gets its own copy of function
+	template<typename F>
+	void parallel_for(uint32_t count, uint32_t batch_size, F&& function, JobCounter& counter);
+
+	// Executes queued jobs until the counter reaches zero
+	void wait_for(const JobCounter& counter);
+
+	uint32_t get_worker_count() const { return static_cast<uint32_t>(m_workers.size()); }
+
+	// Index of the calling worker thread, EXTERNAL_THREAD for threads outside the pool
+	static uint32_t get_worker_index();
+
+	JobSystemStats get_stats() const;
+
+	void log_stats() const;
+
+private:
+
+	struct alignas(64) Worker {
+		WorkStealingQueue<Job, QUEUE_CAPACITY> queue;
+		std::unique_ptr<Job[]> jobs{ new Job[JOB_POOL_SIZE] };
+		size_t next_job = 0;
+
+		std::atomic<uint64_t> executed{ 0 };
+		std::atomic<uint64_t> steals{ 0 };
+		std::atomic<uint64_t> failed_steals{ 0 };
+		// submissions that found their pool slot still live
+		std::atomic<uint64_t> pool_overflows{ 0 };
+	};
+
+	Job* allocate_job();
+
+	void submit(Job* job);
+
+	Job* find_job(uint32_t index);
+
+	void execute(Job* job);
+
+	void worker_loop(uint32_t index);
+
+	void pin_thread(std::thread& thread, uint32_t core);
+
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	std::vector<std::thread> m_threads;
+	std::atomic<bool> m_running{ true };
+
+	// Submissions from threads outside the pool and overflow of full deques
+	std::mutex m_external_mutex;
+	std::deque<Job*> m_external_jobs;
+	std::atomic<uint32_t> m_external_count{ 0 };
+
+	// Queued job count lets idle workers sleep instead of spinning
+	std::atomic<uint32_t> m_queued{ 0 };
+	std::atomic<uint32_t> m_sleeping{ 0 };
+	std::mutex m_sleep_mutex;
+	std::condition_variable m_wake;
+
+	std::chrono::steady_clock::time_point m_start;
+};
+
+template<typename F>
+void JobSystem::run(F&& function, JobCounter* counter)
+{
+	using Function = std::decay_t<F>;
+	static_assert(sizeof(Function) <= Job::STORAGE_SIZE, "job function too large, capture by reference or pointer");
+	static_assert(alignof(Function) <= 8, "job function over aligned");
+
+	Job* job = allocate_job();
+	new (job->storage) Function(std::forward<F>(function));
+	job->invoke = [](Job* self) {
+		Function* callable = std::launder(reinterpret_cast<Function*>(self->storage));
+		(*callable)();
+		callable->~Function();
+	};
+	job->counter = counter;
+
+	if (counter)
+	{
+		counter->fetch_add(1, std::memory_order_relaxed);
+	}
+
+	submit(job);
+}
+
+template<typename F>
+void JobSystem::parallel_for(uint32_t count, uint32_t batch_size, F&& function, JobCounter& counter)
+{
+	batch_size = batch_size == 0 ? 1 : batch_size;
+	for (uint32_t begin = 0; begin < count; begin += batch_size)
+	{
+		uint32_t end = begin + batch_size < count ? begin + batch_size : count;
+		run([function, begin, end]() { function(begin, end); }, &counter);
+	}
+}
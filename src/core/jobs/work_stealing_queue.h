@@ -0,0 +1,94 @@
+#pragma once
+
+// std
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Chase-Lev work stealing deque (Le et al., "Correct and Efficient Work-Stealing for Weak
+// Memory Models"). The owning thread pushes and pops at the bottom, any other thread steals
+// from the top. Holds pointers, nullptr means empty or a lost race.
+template<typename T, size_t Capacity>
+class WorkStealingQueue {
+
+	static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+	static constexpr int64_t MASK = static_cast<int64_t>(Capacity) - 1;
+
+public:
+
+	// Owner only, returns false when full
+	bool push(T* item)
+	{
+		int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+		int64_t top = m_top.load(std::memory_order_acquire);
+		if (bottom - top >= static_cast<int64_t>(Capacity))
+		{
+			return false;
+		}
+
+		m_buffer[bottom & MASK].store(item, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// Owner only, takes the most recently pushed item
+	T* pop()
+	{
+		int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+		m_bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = m_top.load(std::memory_order_relaxed);
+
+		if (top > bottom)
+		{
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		T* item = m_buffer[bottom & MASK].load(std::memory_order_relaxed);
+		if (top == bottom)
+		{
+			// last item, race the thieves for it
+			if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				item = nullptr;
+			}
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return item;
+	}
+
+	// Any thread, takes the oldest item
+	T* steal()
+	{
+		int64_t top = m_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+		if (top >= bottom)
+		{
+			return nullptr;
+		}
+
+		T* item = m_buffer[top & MASK].load(std::memory_order_relaxed);
+		if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			return nullptr;
+		}
+		return item;
+	}
+
+	bool empty() const
+	{
+		return m_bottom.load(std::memory_order_relaxed) <= m_top.load(std::memory_order_relaxed);
+	}
+
+private:
+
+	// top and bottom live on separate cache lines, thieves hammer one and the owner the other
+	alignas(64) std::atomic<int64_t> m_top{ 0 };
+	alignas(64) std::atomic<int64_t> m_bottom{ 0 };
+	alignas(64) std::array<std::atomic<T*>, Capacity> m_buffer{};
+};
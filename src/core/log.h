@@ -1,52 +1,48 @@
 #pragma once
 
+#include "log/logger.h"
+
 // lib
 #include <fmt/core.h>
 #include <vulkan/vulkan.h>
 #include <vulkan/vk_enum_string_helper.h>
 
+// std
+#include <stdexcept>
+
+// Error result of a Vulkan call, thrown by VK_CHECK. Callers that can recover, such as the
+// engine on VK_ERROR_DEVICE_LOST, catch it and inspect get_result.
+class VulkanError : public std::runtime_error {
+public:
+
+	VulkanError(VkResult result, const char* call)
+		: std::runtime_error{ fmt::format("{} returned {}", call, string_VkResult(result)) }
+		, m_result{result}
+	{
+	}
+
+	VkResult get_result() const { return m_result; }
+
+private:
+
+	VkResult m_result;
+};
+
+// Negative results are errors and throw, positive ones like VK_SUBOPTIMAL_KHR or VK_INCOMPLETE
+// are successes and pass. Not for destructors, a lost device makes every wait fail.
 #define VK_CHECK(x)																								\
 	do																											\
 	{																											\
 		VkResult err = x;																						\
-		if (err)																								\
+		if (err < 0)																							\
 		{																										\
-		   fmt::println("\033[38;2;255;128;128;4;5m Detected Vulkan error: {}\033[0m", string_VkResult(err));	\
-			abort();																							\
+			throw VulkanError{ err, #x };																		\
 		}																										\
 	} while (0)
 
-#ifdef DEBUG
-
-#define jinfo(...) do { \
-    fmt::print("\033[1;38;2;128;128;128m[INFO] "); \
-    fmt::println(__VA_ARGS__); \
-    fmt::print("\033[0m"); \
-} while (0)
-
-#define jdebug(...) do { \
-    fmt::print("\033[1;38;2;128;255;128m[DEBUG] "); \
-    fmt::println(__VA_ARGS__); \
-    fmt::print("\033[0m"); \
-} while (0)
-
-#define jwarn(...) do { \
-    fmt::print("\033[1;2;38;2;255;255;128m[WARN] "); \
-    fmt::println(__VA_ARGS__); \
-    fmt::print("\033[0m"); \
-} while (0)
-
-#define jerr(...) do { \
-    fmt::print("\033[1;2;38;2;255;128;128m[ERR] "); \
-    fmt::println(__VA_ARGS__); \
-    fmt::print("\033[0m"); \
-} while (0)
-
-#else
-
-#define jinfo(...)
-#define jdebug(...)
-#define jwarn(...) 
-#define jerr(...)
-
-#endif
\ No newline at end of file
+// Records go through the asynchronous Logger in every build and end up in Logger::LOG_FILE,
+// DEBUG builds also echo them to the console. jdebug is filtered at runtime in release builds.
+#define jinfo(...) Logger::get().write(LogLevel::Info, __VA_ARGS__)
+#define jdebug(...) Logger::get().write(LogLevel::Debug, __VA_ARGS__)
+#define jwarn(...) Logger::get().write(LogLevel::Warn, __VA_ARGS__)
+#define jerr(...) Logger::get().write(LogLevel::Error, __VA_ARGS__)
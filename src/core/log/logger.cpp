@@ -0,0 +1,234 @@
+#include "logger.h"
+
+// std
+#include <algorithm>
+
+namespace {
+
+// Registered on the first log call of a thread, closes the ring when the thread exits
+struct ThreadRing {
+	std::shared_ptr<LogRing> ring;
+
+	~ThreadRing()
+	{
+		if (ring)
+		{
+			ring->close();
+		}
+	}
+};
+
+thread_local ThreadRing t_ring;
+
+const char* get_level_name(LogLevel level)
+{
+	switch (level)
+	{
+	case LogLevel::Debug: return "DEBUG";
+	case LogLevel::Info: return "INFO";
+	case LogLevel::Warn: return "WARN";
+	case LogLevel::Error: return "ERR";
+	}
+	return "?";
+}
+
+#ifdef DEBUG
+const char* get_level_color(LogLevel level)
+{
+	switch (level)
+	{
+	case LogLevel::Debug: return "\033[1;38;2;128;255;128m";
+	case LogLevel::Info: return "\033[1;38;2;128;128;128m";
+	case LogLevel::Warn: return "\033[1;2;38;2;255;255;128m";
+	case LogLevel::Error: return "\033[1;2;38;2;255;128;128m";
+	}
+	return "";
+}
+#endif
+
+int64_t now()
+{
+	return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+}
+
+LogRing::LogRing(uint32_t id)
+	: m_id{id}
+{
+}
+
+std::byte* LogRing::reserve(uint32_t size)
+{
+	uint64_t head = m_head.load(std::memory_order_relaxed);
+	uint32_t offset = static_cast<uint32_t>(head % CAPACITY);
+
+	// records never wrap, the end of the ring is skipped when one does not fit
+	uint32_t padding = CAPACITY - offset < size ? CAPACITY - offset : 0;
+	uint64_t end = head + padding + size;
+
+	if (end - m_cached_tail > CAPACITY)
+	{
+		m_cached_tail = m_tail.load(std::memory_order_acquire);
+		if (end - m_cached_tail > CAPACITY)
+		{
+			return nullptr;
+		}
+	}
+
+	// the consumer skips tails too short for a header on its own
+	if (padding >= sizeof(LogRecordHeader))
+	{
+		LogRecordHeader header = {
+			.size = padding,
+			.level = LogLevel::Debug,
+			.format_size = 0,
+			.format_data = nullptr,
+			.format = nullptr,
+			.timestamp = 0
+		};
+		std::memcpy(m_data.get() + offset, &header, sizeof(header));
+	}
+
+	m_reserved_head = end;
+	return m_data.get() + (head + padding) % CAPACITY;
+}
+
+void LogRing::commit()
+{
+	m_head.store(m_reserved_head, std::memory_order_release);
+}
+
+Logger& Logger::get()
+{
+	static Logger logger;
+	return logger;
+}
+
+Logger::Logger()
+	: m_start{ now() }
+{
+	m_file.open(LOG_FILE, std::ios::trunc);
+	m_thread = std::thread{ &Logger::run, this };
+}
+
+Logger::~Logger()
+{
+	{
+		std::lock_guard lock{ m_wake_mutex };
+		m_stop = true;
+	}
+	m_wake.notify_one();
+	m_thread.join();
+
+	// nothing makes room anymore, a warning logged from here on must not wait for it
+	m_running.store(false, std::memory_order_release);
+
+	std::lock_guard lock{ m_drain_mutex };
+	drain();
+
+	std::string summary = fmt::format("log: {} records written, {} dropped\n", m_records, m_dropped.load(std::memory_order_relaxed));
+	m_file.write(summary.data(), summary.size());
+}
+
+void Logger::flush()
+{
+	std::lock_guard lock{ m_drain_mutex };
+	drain();
+}
+
+LogRing& Logger::get_thread_ring()
+{
+	if (!t_ring.ring)
+	{
+		std::lock_guard lock{ m_rings_mutex };
+		t_ring.ring = std::make_shared<LogRing>(m_next_ring_id++);
+		m_rings.push_back(t_ring.ring);
+	}
+	return *t_ring.ring;
+}
+
+void Logger::run()
+{
+	std::unique_lock wake_lock{ m_wake_mutex };
+	while (!m_stop)
+	{
+		wake_lock.unlock();
+		{
+			std::lock_guard lock{ m_drain_mutex };
+			drain();
+		}
+		wake_lock.lock();
+
+		// producers never signal, a short sleep keeps their path free of syscalls
+		m_wake.wait_for(wake_lock, DRAIN_INTERVAL, [this]() { return m_stop; });
+	}
+}
+
+void Logger::drain()
+{
+	{
+		std::lock_guard lock{ m_rings_mutex };
+		m_drain_rings = m_rings;
+	}
+
+	for (const auto& ring : m_drain_rings)
+	{
+		// read before consuming, so nothing committed ahead of the close is left behind
+		bool closed = ring->is_closed();
+
+		ring->consume([&](const LogRecordHeader& header, const std::byte* arguments) {
+			std::string_view format{ header.format_data, header.format_size };
+			m_buffer.clear();
+			try
+			{
+				header.format(format, arguments, m_buffer);
+			}
+			catch (const fmt::format_error& e)
+			{
+				m_buffer.clear();
+				fmt::format_to(fmt::appender(m_buffer), "{} [format error: {}]", format, e.what());
+			}
+			m_lines.push_back({ header.timestamp, header.level, ring->get_id(), fmt::to_string(m_buffer) });
+		});
+
+		if (closed)
+		{
+			std::lock_guard lock{ m_rings_mutex };
+			std::erase(m_rings, ring);
+		}
+	}
+	m_drain_rings.clear();
+
+	uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+	if (dropped != m_reported_dropped)
+	{
+		m_lines.push_back({ now(), LogLevel::Warn, UINT32_MAX, fmt::format("log: {} records dropped, a thread filled its ring", dropped - m_reported_dropped) });
+		m_reported_dropped = dropped;
+	}
+
+	if (m_lines.empty())
+	{
+		return;
+	}
+
+	std::stable_sort(m_lines.begin(), m_lines.end(), [](const Line& a, const Line& b) { return a.timestamp < b.timestamp; });
+
+	for (const auto& line : m_lines)
+	{
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::duration{ line.timestamp - m_start }).count();
+
+		m_buffer.clear();
+		fmt::format_to(fmt::appender(m_buffer), "[{:12.6f}] [{:<5}] [{:>2}] {}\n",
+			seconds, get_level_name(line.level), line.thread == UINT32_MAX ? -1 : static_cast<int64_t>(line.thread), line.text);
+		m_file.write(m_buffer.data(), m_buffer.size());
+
+#ifdef DEBUG
+		fmt::print("{}[{}] {}\033[0m\n", get_level_color(line.level), get_level_name(line.level), line.text);
+#endif
+	}
+	m_file.flush();
+
+	m_records += m_lines.size();
+	m_lines.clear();
+}
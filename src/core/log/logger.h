@@ -0,0 +1,351 @@
+#pragma once
+
+// lib
+#include <fmt/format.h>
+
+// std
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+enum class LogLevel : uint8_t {
+	Debug,
+	Info,
+	Warn,
+	Error
+};
+
+// Formats the arguments of a record, instantiated per argument list at the call site
+using LogFormatFunction = void (*)(std::string_view format, const std::byte* arguments, fmt::memory_buffer& out);
+
+// Fixed part of a record in a LogRing, the encoded arguments follow it.
+// A null format marks padding up to the end of the ring.
+struct LogRecordHeader {
+	uint32_t size;
+	LogLevel level;
+	uint32_t format_size;
+	const char* format_data;
+	LogFormatFunction format;
+	int64_t timestamp;
+};
+
+// Single producer, single consumer byte ring. The owning thread writes records, the
+// logger thread reads them, neither ever takes a lock.
+class LogRing {
+public:
+
+	static constexpr uint32_t CAPACITY = 256 * 1024;
+	static constexpr uint32_t ALIGNMENT = alignof(LogRecordHeader);
+
+	LogRing(uint32_t id);
+
+	LogRing(const LogRing&) = delete;
+	LogRing& operator=(const LogRing&) = delete;
+	LogRing(LogRing&&) = delete;
+	LogRing& operator=(LogRing&&) = delete;
+
+	// Producer: space for a record of size bytes, nullptr when the ring is full
+	std::byte* reserve(uint32_t size);
+	// Producer: makes the reserved record visible to the consumer
+	void commit();
+	// Producer: the owning thread has exited, the consumer releases the ring once it is empty
+	void close() { m_closed.store(true, std::memory_order_release); }
+
+	// Consumer: calls read(header, arguments) for every committed record, then frees their space
+	template<typename F>
+	uint32_t consume(F&& read);
+
+	bool is_closed() const { return m_closed.load(std::memory_order_acquire); }
+	uint32_t get_id() const { return m_id; }
+
+private:
+
+	std::unique_ptr<std::byte[]> m_data{ new std::byte[CAPACITY] };
+	uint32_t m_id;
+
+	// monotonic positions, the ring offset is position % CAPACITY
+	alignas(64) std::atomic<uint64_t> m_head{ 0 };
+	uint64_t m_reserved_head = 0;
+	uint64_t m_cached_tail = 0;
+
+	alignas(64) std::atomic<uint64_t> m_tail{ 0 };
+
+	std::atomic<bool> m_closed{ false };
+};
+
+namespace detail {
+
+// Numbers and non string pointers travel by value, strings by content
+template<typename T>
+inline constexpr bool IS_LOG_VALUE = (std::is_arithmetic_v<T> || std::is_pointer_v<T>)
+	&& !std::is_same_v<std::remove_cv_t<std::remove_pointer_t<T>>, char>;
+
+// Type the consumer formats, string_views point into the ring
+template<typename T>
+using LogDecoded = std::conditional_t<IS_LOG_VALUE<std::decay_t<T>>, std::decay_t<T>, std::string_view>;
+
+// Values and strings are copied into the record, anything else makes the caller format the line
+template<typename T>
+inline constexpr bool IS_LOG_DEFERRED = IS_LOG_VALUE<T> || std::is_convertible_v<const T&, std::string_view>;
+
+template<typename T>
+auto capture_log_argument(const T& value)
+{
+	if constexpr (IS_LOG_VALUE<T>)
+	{
+		return value;
+	}
+	else
+	{
+		return std::string_view{ value };
+	}
+}
+
+template<typename T>
+uint32_t log_argument_size(const T& value)
+{
+	if constexpr (IS_LOG_VALUE<T>)
+	{
+		return sizeof(T);
+	}
+	else
+	{
+		return static_cast<uint32_t>(sizeof(uint32_t) + value.size());
+	}
+}
+
+template<typename T>
+void write_log_argument(std::byte*& out, const T& value)
+{
+	if constexpr (IS_LOG_VALUE<T>)
+	{
+		std::memcpy(out, &value, sizeof(T));
+		out += sizeof(T);
+	}
+	else
+	{
+		uint32_t size = static_cast<uint32_t>(value.size());
+		std::memcpy(out, &size, sizeof(size));
+		std::memcpy(out + sizeof(size), value.data(), size);
+		out += sizeof(size) + size;
+	}
+}
+
+template<typename T>
+T read_log_argument(const std::byte*& in)
+{
+	if constexpr (std::is_same_v<T, std::string_view>)
+	{
+		uint32_t size;
+		std::memcpy(&size, in, sizeof(size));
+		std::string_view value{ reinterpret_cast<const char*>(in + sizeof(size)), size };
+		in += sizeof(size) + size;
+		return value;
+	}
+	else
+	{
+		T value;
+		std::memcpy(&value, in, sizeof(T));
+		in += sizeof(T);
+		return value;
+	}
+}
+
+template<typename... Args>
+void format_log_record(std::string_view format, const std::byte* arguments, fmt::memory_buffer& out)
+{
+	// braced initialization decodes left to right
+	std::tuple<LogDecoded<Args>...> values{ read_log_argument<LogDecoded<Args>>(arguments)... };
+	std::apply([&](auto&... value) {
+		fmt::vformat_to(fmt::appender(out), format, fmt::make_format_args(value...));
+	}, values);
+}
+
+}
+
+// Asynchronous log backend behind the j* macros. A call checks the level, copies its
+// arguments as a compact binary record into the calling thread's LogRing and returns,
+// formatting and file output happen on the logger thread. Records of one drain are written
+// in timestamp order. When a ring is full debug and info records are dropped and counted,
+// warnings and errors wait for room while the logger thread runs. Format strings must be
+// literals, only their address is recorded. A call with an argument that is neither a number,
+// a pointer nor a string is formatted on the calling thread, so its format spec applies to its
+// own type.
+class Logger {
+public:
+
+	static constexpr const char* LOG_FILE = "lucida.log";
+
+#ifdef DEBUG
+	static constexpr LogLevel DEFAULT_LEVEL = LogLevel::Debug;
+#else
+	static constexpr LogLevel DEFAULT_LEVEL = LogLevel::Info;
+#endif
+
+	// How long the logger thread sleeps when the rings are empty
+	static constexpr std::chrono::milliseconds DRAIN_INTERVAL{ 2 };
+
+	static Logger& get();
+
+	~Logger();
+
+	Logger(const Logger&) = delete;
+	Logger& operator=(const Logger&) = delete;
+	Logger(Logger&&) = delete;
+	Logger& operator=(Logger&&) = delete;
+
+	template<typename... Args>
+	void write(LogLevel level, fmt::format_string<Args...> format, Args&&... args);
+
+	// Blocks until every record logged so far is written
+	void flush();
+
+	void set_level(LogLevel level) { m_level.store(level, std::memory_order_relaxed); }
+	LogLevel get_level() const { return m_level.load(std::memory_order_relaxed); }
+
+private:
+
+	struct Line {
+		int64_t timestamp;
+		LogLevel level;
+		uint32_t thread;
+		std::string text;
+	};
+
+	Logger();
+
+	// Copies a record of already captured values into the calling thread's ring
+	template<typename... Values>
+	void push(LogLevel level, int64_t timestamp, fmt::string_view format, LogFormatFunction format_function, const Values&... values);
+
+	LogRing& get_thread_ring();
+	void run();
+	// Formats and writes everything committed so far, m_drain_mutex must be held
+	void drain();
+
+	std::atomic<LogLevel> m_level{ DEFAULT_LEVEL };
+	int64_t m_start;
+
+	// records lost to full rings
+	std::atomic<uint64_t> m_dropped{ 0 };
+	// cleared once the logger thread stopped draining, full rings drop every level after that
+	std::atomic<bool> m_running{ true };
+
+	std::mutex m_rings_mutex;
+	std::vector<std::shared_ptr<LogRing>> m_rings;
+	uint32_t m_next_ring_id = 0;
+
+	std::mutex m_drain_mutex;
+	std::vector<std::shared_ptr<LogRing>> m_drain_rings;
+	std::ofstream m_file;
+	std::vector<Line> m_lines;
+	fmt::memory_buffer m_buffer;
+	uint64_t m_records = 0;
+	uint64_t m_reported_dropped = 0;
+
+	std::mutex m_wake_mutex;
+	std::condition_variable m_wake;
+	bool m_stop = false;
+	std::thread m_thread;
+};
+
+template<typename F>
+uint32_t LogRing::consume(F&& read)
+{
+	uint64_t tail = m_tail.load(std::memory_order_relaxed);
+	uint64_t head = m_head.load(std::memory_order_acquire);
+
+	uint32_t count = 0;
+	while (tail < head)
+	{
+		uint32_t offset = static_cast<uint32_t>(tail % CAPACITY);
+		if (CAPACITY - offset < sizeof(LogRecordHeader))
+		{
+			tail += CAPACITY - offset;
+			continue;
+		}
+
+		LogRecordHeader header;
+		std::memcpy(&header, m_data.get() + offset, sizeof(header));
+		if (header.format)
+		{
+			read(header, m_data.get() + offset + sizeof(header));
+			count++;
+		}
+		tail += header.size;
+	}
+
+	m_tail.store(tail, std::memory_order_release);
+	return count;
+}
+
+template<typename... Args>
+void Logger::write(LogLevel level, fmt::format_string<Args...> format, Args&&... args)
+{
+	if (level < m_level.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+
+	int64_t timestamp = std::chrono::steady_clock::now().time_since_epoch().count();
+
+	if constexpr ((detail::IS_LOG_DEFERRED<std::decay_t<Args>> && ...))
+	{
+		// string views refer to the caller's arguments, which outlive this call
+		push(level, timestamp, format, &detail::format_log_record<Args...>, detail::capture_log_argument<std::decay_t<Args>>(args)...);
+	}
+	else
+	{
+		std::string text = fmt::format(format, std::forward<Args>(args)...);
+		push(level, timestamp, "{}", &detail::format_log_record<std::string_view>, std::string_view{ text });
+	}
+}
+
+template<typename... Values>
+void Logger::push(LogLevel level, int64_t timestamp, fmt::string_view format, LogFormatFunction format_function, const Values&... values)
+{
+	uint32_t size = sizeof(LogRecordHeader);
+	((size += detail::log_argument_size(values)), ...);
+	size = (size + LogRing::ALIGNMENT - 1) & ~(LogRing::ALIGNMENT - 1);
+
+	LogRing& ring = get_thread_ring();
+	std::byte* record = size <= LogRing::CAPACITY / 4 ? ring.reserve(size) : nullptr;
+	// warnings and errors wait for the logger thread to make room, everything else is dropped
+	while (!record && level >= LogLevel::Warn && size <= LogRing::CAPACITY / 4 && m_running.load(std::memory_order_acquire))
+	{
+		std::this_thread::yield();
+		record = ring.reserve(size);
+	}
+	if (!record)
+	{
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	LogRecordHeader header = {
+		.size = size,
+		.level = level,
+		.format_size = static_cast<uint32_t>(format.size()),
+		.format_data = format.data(),
+		.format = format_function,
+		.timestamp = timestamp
+	};
+	std::memcpy(record, &header, sizeof(header));
+
+	[[maybe_unused]] std::byte* out = record + sizeof(header);
+	(detail::write_log_argument(out, values), ...);
+
+	ring.commit();
+}
@@ -0,0 +1,300 @@
+#include "profiler.h"
+
+// core
+#include "core/log.h"
+
+// lib
+#include <fmt/format.h>
+
+// std
+#include <fstream>
+
+namespace {
+
+// Points at the calling thread's entry in Profiler::m_threads once it recorded anything
+thread_local ProfileThread* t_thread = nullptr;
+
+// Trace viewers expect microseconds
+double to_trace_time(int64_t timestamp, int64_t start)
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::duration{ timestamp - start }).count();
+}
+
+void append_json_string(fmt::memory_buffer& out, std::string_view text)
+{
+	out.push_back('"');
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+		{
+			out.push_back('\\');
+			out.push_back(c);
+		}
+		else if (static_cast<unsigned char>(c) < 0x20)
+		{
+			fmt::format_to(fmt::appender(out), "\\u{:04x}", static_cast<unsigned>(c));
+		}
+		else
+		{
+			out.push_back(c);
+		}
+	}
+	out.push_back('"');
+}
+
+}
+
+Profiler& Profiler::get()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+Profiler::Profiler()
+	: m_start{ now() }
+{
+}
+
+Profiler::~Profiler()
+{
+	detail::profiler_enabled.store(false, std::memory_order_relaxed);
+}
+
+void Profiler::set_enabled(bool enabled)
+{
+	if (enabled != is_enabled())
+	{
+		jinfo("profiler: {}", enabled ? "enabled" : "disabled");
+	}
+	detail::profiler_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+ProfileThread& Profiler::add_thread(std::string_view name)
+{
+	auto thread = std::make_shared<ProfileThread>();
+	thread->name = name;
+
+	std::lock_guard lock{ m_threads_mutex };
+	thread->id = m_next_thread_id++;
+	m_threads.push_back(thread);
+	return *thread;
+}
+
+ProfileThread& Profiler::get_thread()
+{
+	if (!t_thread)
+	{
+		t_thread = &add_thread({});
+	}
+	return *t_thread;
+}
+
+ProfileThread& Profiler::create_track(std::string_view name)
+{
+	return add_thread(name);
+}
+
+bool Profiler::reserve_events(uint64_t count)
+{
+	uint64_t reserved = m_reserved_events.fetch_add(count, std::memory_order_relaxed);
+	if (reserved >= m_max_events.load(std::memory_order_relaxed))
+	{
+		m_reserved_events.fetch_sub(count, std::memory_order_relaxed);
+		return false;
+	}
+	return true;
+}
+
+ProfileChunk* Profiler::add_chunk(ProfileThread& thread)
+{
+	// whole chunks are reserved, the limit is exceeded by at most one chunk per thread
+	if (!reserve_events(ProfileChunk::CAPACITY))
+	{
+		return nullptr;
+	}
+
+	auto chunk = std::make_unique<ProfileChunk>();
+	std::lock_guard lock{ thread.mutex };
+	thread.current = chunk.get();
+	thread.chunks.push_back(std::move(chunk));
+	return thread.current;
+}
+
+void Profiler::record(const char* name, int64_t start, int64_t end)
+{
+	record(get_thread(), name, start, end);
+}
+
+void Profiler::record(ProfileThread& thread, const char* name, int64_t start, int64_t end)
+{
+	ProfileChunk* chunk = thread.current;
+	uint32_t count = chunk ? chunk->count.load(std::memory_order_relaxed) : ProfileChunk::CAPACITY;
+	if (count == ProfileChunk::CAPACITY)
+	{
+		chunk = add_chunk(thread);
+		if (!chunk)
+		{
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		count = 0;
+	}
+
+	chunk->events[count] = { name, start, end };
+	chunk->count.store(count + 1, std::memory_order_release);
+}
+
+void Profiler::mark_frame(uint64_t frame)
+{
+	if (!is_enabled())
+	{
+		return;
+	}
+
+	if (!reserve_events(1))
+	{
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	std::lock_guard lock{ m_markers_mutex };
+	m_markers.push_back({ frame, now() });
+}
+
+void Profiler::record_counter(const char* name, const char* series, int64_t timestamp, double value)
+{
+	if (!is_enabled())
+	{
+		return;
+	}
+
+	if (!reserve_events(1))
+	{
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	std::lock_guard lock{ m_markers_mutex };
+	m_counters.push_back({ name, series, timestamp, value });
+}
+
+void Profiler::set_thread_name(std::string_view name)
+{
+	ProfileThread& thread = get_thread();
+	std::lock_guard lock{ thread.mutex };
+	thread.name = name;
+}
+
+const char* Profiler::intern(std::string_view name)
+{
+	// node based, the strings never move
+	std::lock_guard lock{ m_names_mutex };
+	return m_names.emplace(name).first->c_str();
+}
+
+uint64_t Profiler::get_event_count()
+{
+	std::lock_guard threads_lock{ m_threads_mutex };
+
+	uint64_t count = 0;
+	for (const auto& thread : m_threads)
+	{
+		std::lock_guard lock{ thread->mutex };
+		for (const auto& chunk : thread->chunks)
+		{
+			count += chunk->count.load(std::memory_order_acquire);
+		}
+	}
+	return count;
+}
+
+bool Profiler::write_trace(const std::string& path)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	std::ofstream file{ path, std::ios::trunc };
+	if (!file)
+	{
+		jerr("profiler: failed to open {}", path);
+		return false;
+	}
+
+	std::vector<std::shared_ptr<ProfileThread>> threads;
+	{
+		std::lock_guard lock{ m_threads_mutex };
+		threads = m_threads;
+	}
+
+	fmt::memory_buffer out;
+	uint64_t written = 0;
+	bool first = true;
+	auto begin_event = [&]() {
+		out.append(std::string_view{ first ? "\n" : ",\n" });
+		first = false;
+	};
+	auto flush = [&]() {
+		file.write(out.data(), out.size());
+		out.clear();
+	};
+
+	out.append(std::string_view{ "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" });
+
+	for (const auto& thread : threads)
+	{
+		std::lock_guard lock{ thread->mutex };
+
+		begin_event();
+		fmt::format_to(fmt::appender(out), "{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":", thread->id);
+		append_json_string(out, thread->name.empty() ? fmt::format("thread {}", thread->id) : thread->name);
+		out.append(std::string_view{ "}}" });
+
+		for (const auto& chunk : thread->chunks)
+		{
+			uint32_t count = chunk->count.load(std::memory_order_acquire);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				const ProfileEvent& event = chunk->events[i];
+				begin_event();
+				out.append(std::string_view{ "{\"name\":" });
+				append_json_string(out, event.name);
+				fmt::format_to(fmt::appender(out), ",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+					thread->id, to_trace_time(event.start, m_start), to_trace_time(event.end, event.start));
+			}
+			written += count;
+			flush();
+		}
+	}
+
+	{
+		std::lock_guard lock{ m_markers_mutex };
+		for (const auto& marker : m_markers)
+		{
+			begin_event();
+			fmt::format_to(fmt::appender(out), "{{\"name\":\"frame {}\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":{:.3f}}}",
+				marker.frame, to_trace_time(marker.timestamp, m_start));
+		}
+		for (const auto& counter : m_counters)
+		{
+			begin_event();
+			out.append(std::string_view{ "{\"name\":" });
+			append_json_string(out, counter.name);
+			fmt::format_to(fmt::appender(out), ",\"ph\":\"C\",\"pid\":1,\"ts\":{:.3f},\"args\":{{", to_trace_time(counter.timestamp, m_start));
+			append_json_string(out, counter.series);
+			fmt::format_to(fmt::appender(out), ":{}}}}}", counter.value);
+		}
+	}
+
+	out.append(std::string_view{ "\n]}\n" });
+	flush();
+
+	if (!file)
+	{
+		jerr("profiler: failed to write {}", path);
+		return false;
+	}
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	jinfo("profiler: {} zones on {} threads written to {} in {:.2f} ms, {} dropped",
+		written, threads.size(), path, elapsed.count(), m_dropped.load(std::memory_order_relaxed));
+	return true;
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+// std
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// Closed zone on one thread, times are Profiler::now() values
+struct ProfileEvent {
+	const char* name;
+	int64_t start;
+	int64_t end;
+};
+
+// Block of events of one thread. The owner writes an event and then publishes the count,
+// readers never see a partially written event.
+struct ProfileChunk {
+	static constexpr uint32_t CAPACITY = 4096;
+
+	std::array<ProfileEvent, CAPACITY> events;
+	std::atomic<uint32_t> count{ 0 };
+};
+
+// Events recorded by one thread or written to a track, kept until the trace is written
+struct ProfileThread {
+	uint32_t id;
+	std::string name;
+
+	// taken by the owner only to add a chunk, and by write_trace
+	std::mutex mutex;
+	std::vector<std::unique_ptr<ProfileChunk>> chunks;
+
+	// owner only
+	ProfileChunk* current = nullptr;
+};
+
+namespace detail {
+
+// The only thing a disabled zone reads
+inline std::atomic<bool> profiler_enabled{ false };
+
+}
+
+// CPU zone profiler behind jprofile. Zones are recorded into chunks owned by the calling
+// thread without locks and written as Chrome trace event JSON, which chrome://tracing and
+// Perfetto load. While disabled a zone costs one relaxed load and a branch on entry and a
+// branch on its own stack member on exit. Zone names must outlive the profiler, use intern for
+// names that are built at runtime.
+class Profiler {
+public:
+
+	static Profiler& get();
+
+	static bool is_enabled() { return detail::profiler_enabled.load(std::memory_order_relaxed); }
+
+	// steady clock ticks, comparable across threads
+	static int64_t now() { return std::chrono::steady_clock::now().time_since_epoch().count(); }
+
+	~Profiler();
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+	Profiler(Profiler&&) = delete;
+	Profiler& operator=(Profiler&&) = delete;
+
+	void set_enabled(bool enabled);
+
+	// Zones, frame markers and counter samples past the limit are dropped and counted, so a long
+	// session cannot run out of memory
+	void set_max_events(uint64_t max_events) { m_max_events.store(max_events, std::memory_order_relaxed); }
+
+	void record(const char* name, int64_t start, int64_t end);
+
+	// Timeline that belongs to no thread, e.g. a GPU queue, valid as long as the profiler
+	ProfileThread& create_track(std::string_view name);
+	// Zone on a track, one thread at a time per track; times are converted to now() ticks by the caller
+	void record(ProfileThread& track, const char* name, int64_t start, int64_t end);
+
+	// Sample of a named counter series, drawn as a graph under the thread tracks
+	void record_counter(const char* name, const char* series, int64_t timestamp, double value);
+
+	// Global marker at the start of a frame, drawn across every thread of the trace
+	void mark_frame(uint64_t frame);
+
+	// Label of the calling thread in the trace
+	void set_thread_name(std::string_view name);
+
+	// Stable copy of name for zones named at runtime, e.g. render graph passes
+	const char* intern(std::string_view name);
+
+	// Zones recorded so far, walks every thread
+	uint64_t get_event_count();
+
+	// Writes everything recorded so far, returns false when the file could not be written
+	bool write_trace(const std::string& path);
+
+private:
+
+	struct FrameMarker {
+		uint64_t frame;
+		int64_t timestamp;
+	};
+
+	struct CounterSample {
+		const char* name;
+		const char* series;
+		int64_t timestamp;
+		double value;
+	};
+
+	Profiler();
+
+	ProfileThread& get_thread();
+	ProfileThread& add_thread(std::string_view name);
+	// Takes count events from the max events budget, false once it is used up
+	bool reserve_events(uint64_t count);
+	// Starts a new chunk for thread, nullptr once max events are used up
+	ProfileChunk* add_chunk(ProfileThread& thread);
+
+	int64_t m_start;
+
+	std::atomic<uint64_t> m_max_events{ UINT64_MAX };
+	std::atomic<uint64_t> m_reserved_events{ 0 };
+	std::atomic<uint64_t> m_dropped{ 0 };
+
+	std::mutex m_threads_mutex;
+	std::vector<std::shared_ptr<ProfileThread>> m_threads;
+	uint32_t m_next_thread_id = 0;
+
+	std::mutex m_markers_mutex;
+	std::vector<FrameMarker> m_markers;
+	std::vector<CounterSample> m_counters;
+
+	std::mutex m_names_mutex;
+	std::unordered_set<std::string> m_names;
+};
+
+// Records the enclosing scope as a zone when the profiler is enabled at entry
+class ProfileZone {
+public:
+
+	explicit ProfileZone(const char* name)
+	{
+		if (Profiler::is_enabled())
+		{
+			m_name = name;
+			m_start = Profiler::now();
+		}
+	}
+
+	~ProfileZone()
+	{
+		if (m_name)
+		{
+			Profiler::get().record(m_name, m_start, Profiler::now());
+		}
+	}
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+	ProfileZone(ProfileZone&&) = delete;
+	ProfileZone& operator=(ProfileZone&&) = delete;
+
+private:
+
+	const char* m_name = nullptr;
+	int64_t m_start = 0;
+};
+
+#define JPROFILE_CONCAT_INNER(a, b) a##b
+#define JPROFILE_CONCAT(a, b) JPROFILE_CONCAT_INNER(a, b)
+
+// Times the rest of the enclosing scope
+#define jprofile(name) ProfileZone JPROFILE_CONCAT(profile_zone_, __LINE__){ name }
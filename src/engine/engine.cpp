@@ -2,38 +2,359 @@
 
 // core
 #include "core/log.h"
+#include "core/profile/profiler.h"
 
 #include "graphics/shader.h"
 #include "graphics/pipeline.h"
+#include "graphics/png_writer.h"
+#include "utils.h"
 
+// lib
+#include <glm/gtc/matrix_transform.hpp>
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <utility>
 
 Engine::Engine(Config& config)
 	: m_config{config}
 {
 	jinfo("engine constructor");
 
+	m_renderer.emplace(m_config, m_window, m_job_system);
+	create_resources();
+
+	m_config_subscription = m_config.subscribe(CONFIG_SECTION_ALL, [this](const Settings&, const Settings& current, ConfigSections changed) {
+		apply_config(current, changed);
+	});
+}
+
+Engine::~Engine()
+{
+	jinfo("engine destructor");
+
+	m_config.unsubscribe(m_config_subscription);
+
+	// empty when recreating it after a device loss threw
+	if (m_renderer)
+	{
+		// pipelines are destroyed before the renderer, make sure the GPU is done with them.
+		// Frames still in flight are read back before the encodes are waited for.
+		m_renderer->flush_readbacks();
+		m_renderer->get_device().get_pipeline_state_cache().log_stats();
+	}
+	m_job_system.wait_for(m_readback_jobs);
+}
+
+void Engine::create_resources()
+{
+	jprofile("create resources");
+
+	m_format_generation = m_renderer->get_format_generation();
+	create_pipelines();
+
+	uint32_t test_instances = m_config.get_test_instance_count();
+	if (test_instances > 0)
+	{
+		create_test_scene(test_instances);
+	}
+
+	if (m_scene && m_gpu_driven)
+	{
+		// buffer hazards are handled inside the scene, the pass only has to stay ahead of main
+		m_renderer->get_render_graph().add_pass("cull")
+			.set_side_effects()
+			.set_execute([this](VkCommandBuffer cmd) {
+				m_scene->cull(cmd, m_view_projection);
+			});
+
+		m_renderer->get_render_graph().add_pass("main")
+			.write(m_renderer->get_backbuffer(), ACCESS_COLOR_ATTACHMENT_WRITE)
+			.set_execute([this](VkCommandBuffer cmd) {
+				m_renderer->begin_main_pass(cmd);
+				m_scene->draw_indirect(cmd, m_view_projection);
+				m_renderer->end_main_pass(cmd);
+			});
+	}
+	else if (m_scene)
+	{
+		m_renderer->get_render_graph().add_pass("main")
+			.write(m_renderer->get_backbuffer(), ACCESS_COLOR_ATTACHMENT_WRITE)
+			.set_execute([this](VkCommandBuffer cmd) {
+				m_renderer->begin_main_pass(cmd, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+				m_renderer->record_parallel(cmd, m_scene->get_instance_count(), m_config.get_draws_per_slice(), [this](VkCommandBuffer secondary, uint32_t begin, uint32_t end) {
+					m_scene->draw_direct(secondary, m_view_projection, begin, end);
+				});
+				m_renderer->end_main_pass(cmd);
+			});
+	}
+	else
+	{
+		m_renderer->get_render_graph().add_pass("main")
+			.write(m_renderer->get_backbuffer(), ACCESS_COLOR_ATTACHMENT_WRITE)
+			.set_execute([this](VkCommandBuffer cmd) {
+				m_renderer->begin_main_pass(cmd, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+				m_renderer->record_parallel(cmd, m_config.get_test_draw_count(), m_config.get_draws_per_slice(), [this](VkCommandBuffer secondary, uint32_t begin, uint32_t end) {
+					m_pipelines[0].bind(secondary);
+					for (uint32_t draw = begin; draw < end; draw++)
+					{
+						vkCmdDraw(secondary, 3, 1, 0, draw);
+					}
+				});
+				m_renderer->end_main_pass(cmd);
+			});
+	}
+	m_renderer->compile_render_graph();
+
+	m_renderer->get_device().log_pipeline_cache_stats();
+	m_renderer->get_device().get_shader_cache().log_stats();
+}
+
+void Engine::create_pipelines()
+{
 	// create shader modules
-	Shader my_vert_shader{ m_renderer.get_device(), "shaders/spv/test.vert.spv" };
-	Shader my_frag_shader{ m_renderer.get_device(), "shaders/spv/test.frag.spv" };
+	Shader my_vert_shader{ m_renderer->get_device(), "shaders/spv/test.vert.spv" };
+	Shader my_frag_shader{ m_renderer->get_device(), "shaders/spv/test.frag.spv" };
 
-	Pipeline my_pipeline = PipelineBuilder::create(m_renderer.get_pipeline_layout(), m_renderer.get_render_pass())
-		.add_shader_stage(my_vert_shader.get_module(), VK_SHADER_STAGE_VERTEX_BIT)
-		.add_shader_stage(my_frag_shader.get_module(), VK_SHADER_STAGE_FRAGMENT_BIT)
+	std::vector<PipelineBuilder> builders;
+	builders.push_back(m_renderer->create_pipeline_builder()
+		.add_shader_stage(my_vert_shader, VK_SHADER_STAGE_VERTEX_BIT)
+		.add_shader_stage(my_frag_shader, VK_SHADER_STAGE_FRAGMENT_BIT)
 		.set_dynamic_states(VK_DYNAMIC_STATE_VIEWPORT)
 		.set_dynamic_states(VK_DYNAMIC_STATE_SCISSOR)
-		.add_color_blend_attachment()
-		.build(m_renderer.get_device());
+		.add_color_blend_attachment());
+
+	// pipelines compile in parallel into the shared pipeline cache
+	m_pipelines = m_renderer->get_pipeline_compiler().compile_batch(std::move(builders));
 }
 
-Engine::~Engine()
+void Engine::rebuild_pipelines()
 {
-	jinfo("engine destructor");
+	jprofile("rebuild pipelines");
+
+	// the frames in flight still draw with the old pipelines
+	m_renderer->wait_idle();
+
+	m_format_generation = m_renderer->get_format_generation();
+	create_pipelines();
+	if (m_scene)
+	{
+		m_scene->create_draw_pipeline();
+	}
+}
+
+void Engine::destroy_resources()
+{
+	// scene and pipelines live on the renderer's device
+	m_scene.reset();
+	m_pipelines.clear();
+}
+
+void Engine::recover_device_lost(const VulkanError& error)
+{
+	// a loss before the first frame after the last recovery will not go away by retrying
+	if (m_measure_recovery)
+	{
+		throw error;
+	}
+
+	jerr("device lost ({}), recreating the renderer", error.what());
+	m_device_lost_count++;
+	m_recovery_start = std::chrono::steady_clock::now();
+
+	m_renderer->get_device().mark_lost();
+	m_renderer->wait_idle();
+	destroy_resources();
+	m_renderer.reset();
+	std::chrono::duration<double, std::milli> teardown = std::chrono::steady_clock::now() - m_recovery_start;
+
+	m_renderer.emplace(m_config, m_window, m_job_system);
+	create_resources();
+	std::chrono::duration<double, std::milli> recreate = std::chrono::steady_clock::now() - m_recovery_start - teardown;
+
+	jinfo("device lost: torn down in {:.2f} ms, recreated in {:.2f} ms", teardown.count(), recreate.count());
+	m_measure_recovery = true;
+}
+
+void Engine::apply_config(const Settings& settings, ConfigSections changed)
+{
+	if (changed & CONFIG_SECTION_PRESENT)
+	{
+		m_renderer->set_present_policy(parse_present_policy(settings.renderer.present_policy));
+	}
+
+	if (changed & CONFIG_SECTION_FRAMES_IN_FLIGHT)
+	{
+		m_renderer->set_frames_in_flight(settings.renderer.frames_in_flight);
+	}
+
+	if (changed & CONFIG_SECTION_WINDOW)
+	{
+		m_window.apply(settings.window);
+	}
+
+	// the trace is written at exit, toggling only changes what it covers
+	if (changed & CONFIG_SECTION_PROFILER)
+	{
+		Profiler::get().set_max_events(settings.profiler.max_events);
+		Profiler::get().set_enabled(settings.profiler.enabled);
+	}
+
+	// recording settings are read every frame and need nothing here
+	if (changed & (CONFIG_SECTION_APP | CONFIG_SECTION_RENDERER | CONFIG_SECTION_SCENE | CONFIG_SECTION_JOBS | CONFIG_SECTION_HEADLESS))
+	{
+		jwarn("config: app, device, scene, job and headless changes take effect after a restart");
+	}
+}
+
+void Engine::create_test_scene(uint32_t instance_count)
+{
+	const Vertex cube_vertices[] = {
+		{ { -0.5f, -0.5f, -0.5f }, { 0.0f, 0.0f, 0.0f } },
+		{ {  0.5f, -0.5f, -0.5f }, { 1.0f, 0.0f, 0.0f } },
+		{ {  0.5f,  0.5f, -0.5f }, { 1.0f, 1.0f, 0.0f } },
+		{ { -0.5f,  0.5f, -0.5f }, { 0.0f, 1.0f, 0.0f } },
+		{ { -0.5f, -0.5f,  0.5f }, { 0.0f, 0.0f, 1.0f } },
+		{ {  0.5f, -0.5f,  0.5f }, { 1.0f, 0.0f, 1.0f } },
+		{ {  0.5f,  0.5f,  0.5f }, { 1.0f, 1.0f, 1.0f } },
+		{ { -0.5f,  0.5f,  0.5f }, { 0.0f, 1.0f, 1.0f } },
+	};
+	const uint32_t cube_indices[] = {
+		0, 2, 1, 0, 3, 2,
+		4, 5, 6, 4, 6, 7,
+		0, 1, 5, 0, 5, 4,
+		3, 7, 6, 3, 6, 2,
+		0, 4, 7, 0, 7, 3,
+		1, 2, 6, 1, 6, 5,
+	};
+
+	m_gpu_driven = m_config.is_gpu_driven_enabled() && m_renderer->get_device().is_gpu_driven_supported();
+	if (m_config.is_gpu_driven_enabled() && !m_gpu_driven)
+	{
+		jwarn("gpu driven rendering not supported, drawing the test scene directly");
+	}
+
+	m_scene.emplace(*m_renderer, instance_count, static_cast<uint32_t>(std::size(cube_vertices)), static_cast<uint32_t>(std::size(cube_indices)));
+	MeshHandle cube = m_scene->add_mesh(cube_vertices, cube_indices);
+
+	// square grid on the xz plane, the camera sees roughly half of it
+	uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(instance_count))));
+	for (uint32_t i = 0; i < instance_count; i++)
+	{
+		glm::vec3 position = { static_cast<float>(i % side) * 2.0f, 0.0f, static_cast<float>(i / side) * 2.0f };
+		m_scene->add_instance(cube, glm::translate(glm::mat4{ 1.0f }, position));
+	}
+	m_scene->upload();
+
+	float extent = static_cast<float>(side) * 2.0f;
+	float aspect = static_cast<float>(m_config.get_window_width()) / static_cast<float>(m_config.get_window_height());
+	glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(60.0f), aspect, 0.1f, extent * 2.0f);
+	projection[1][1] *= -1.0f;
+	glm::mat4 view = glm::lookAtRH(glm::vec3{ extent * 0.5f, extent * 0.25f, -extent * 0.1f }, glm::vec3{ extent * 0.5f, 0.0f, extent * 0.5f }, glm::vec3{ 0.0f, 1.0f, 0.0f });
+	m_view_projection = projection * view;
+
+	jinfo("test scene: {} instances, {}", instance_count, m_gpu_driven ? "gpu driven" : "direct");
+}
+
+void Engine::save_readback(ReadbackImage&& image)
+{
+	if (m_config.get_headless_readback() == "memory")
+	{
+		jinfo("headless: frame {} {}x{} checksum {:016x}", image.frame, image.extent.width, image.extent.height,
+			hash_bytes(image.pixels.data(), image.pixels.size()));
+		return;
+	}
+
+	// encoding and disk writes stay off the main thread, the job owns the pixels
+	std::string path = fmt::format("{}_{:05}.png", m_config.get_headless_output(), image.frame);
+	auto encode = std::make_unique<std::pair<std::string, ReadbackImage>>(std::move(path), std::move(image));
+	m_job_system.run([encode = std::move(encode)]() {
+		const auto& [path, image] = *encode;
+		try
+		{
+			write_png(path, image.extent.width, image.extent.height, image.pixels.data());
+		}
+		catch (const std::exception& e)
+		{
+			jerr("headless: {}", e.what());
+		}
+	}, &m_readback_jobs);
 }
 
 void Engine::run()
 {
-	while (!m_window.closed())
+	bool headless = m_config.is_headless_enabled();
+	uint32_t headless_frames = m_config.get_headless_frames();
+	uint32_t readback_interval = m_config.get_headless_readback_interval();
+	bool readback = headless && m_config.get_headless_readback() != "none";
+	auto start = std::chrono::steady_clock::now();
+
+	while (!m_window.closed() && !(headless && m_frames_rendered >= headless_frames))
+	{
+		if (Profiler::is_enabled())
+		{
+			Profiler::get().mark_frame(m_frames_rendered);
+		}
+		jprofile("frame");
+
+		{
+			jprofile("process events");
+			m_window.process_events();
+		}
+
+		try
+		{
+			m_config.poll();
+
+			VkCommandBuffer cmd = m_renderer->begin_frame();
+			if (cmd == VK_NULL_HANDLE)
+			{
+				continue;
+			}
+
+			// begin_frame recreates the swapchain, nothing was recorded with the old pipelines yet
+			if (m_renderer->get_format_generation() != m_format_generation)
+			{
+				rebuild_pipelines();
+			}
+
+			m_renderer->execute_render_graph(cmd);
+
+			if (readback && m_frames_rendered % readback_interval == readback_interval - 1)
+			{
+				m_renderer->read_back_frame([this](ReadbackImage&& image) {
+					save_readback(std::move(image));
+				});
+			}
+
+			m_renderer->end_frame();
+			m_frames_rendered++;
+		}
+		catch (const VulkanError& e)
+		{
+			if (e.get_result() != VK_ERROR_DEVICE_LOST)
+			{
+				throw;
+			}
+			recover_device_lost(e);
+			continue;
+		}
+
+		if (m_measure_recovery)
+		{
+			m_measure_recovery = false;
+			std::chrono::duration<double, std::milli> downtime = std::chrono::steady_clock::now() - m_recovery_start;
+			jinfo("device lost: first frame presented {:.2f} ms after the loss ({} losses this session)", downtime.count(), m_device_lost_count);
+		}
+	}
+
+	if (headless)
 	{
-		m_window.process_events();
+		// submission throughput, the GPU may still be working on the last frames in flight
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		jinfo("headless: {} frames in {:.2f} ms, {:.3f} ms/frame, {:.1f} fps", m_frames_rendered, elapsed.count(),
+			elapsed.count() / std::max<uint64_t>(1, m_frames_rendered), m_frames_rendered * 1000.0 / elapsed.count());
 	}
 }
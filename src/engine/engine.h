@@ -2,13 +2,27 @@
 
 // core
 #include "core/config/config.h"
+#include "core/jobs/job_system.h"
 
 #include "window/window.h"
 #include "graphics/renderer.h"
+#include "graphics/pipeline.h"
+#include "graphics/gpu_scene.h"
 
+// std
+#include <vector>
+#include <optional>
+#include <chrono>
+
+class VulkanError;
+
+// Owns the window, job system and renderer. A lost device is recovered by replacing the
+// renderer and everything built on it, the window and the rest of the process stay up.
+// With headless.enabled it renders a fixed number of offscreen frames and returns from run.
 class Engine {
 public:
 
+	// Subscribes to config reloads for the settings it can apply live
 	Engine(Config& config);
 
 	~Engine();
@@ -17,9 +31,46 @@ public:
 
 private:
 
+	// Everything built on top of the renderer, recreated with it after a device loss
+	void create_resources();
+	void destroy_resources();
+	// the test pipelines, against the renderer's current color format
+	void create_pipelines();
+	// after the swapchain came back with another color format
+	void rebuild_pipelines();
+	void recover_device_lost(const VulkanError& error);
+	void create_test_scene(uint32_t instance_count);
+	void apply_config(const Settings& settings, ConfigSections changed);
+	// headless.readback: logs a checksum or writes a PNG on the job system
+	void save_readback(ReadbackImage&& image);
+
 	Config& m_config;
+	ConfigSubscription m_config_subscription = 0;
+
+	// constructed first so the main thread becomes job worker 0
+	JobSystem m_job_system{ m_config.get_job_workers() };
 	
 	Window m_window{m_config};
 
-	Renderer m_renderer{ m_config, m_window };
+	// replaced as a whole when the device is lost
+	std::optional<Renderer> m_renderer;
+
+	std::vector<Pipeline> m_pipelines;
+	// Renderer::get_format_generation the pipelines were built for
+	uint32_t m_format_generation = 0;
+
+	// grid of test instances, see scene.test_instances
+	std::optional<GpuScene> m_scene;
+	bool m_gpu_driven = false;
+	glm::mat4 m_view_projection{ 1.0f };
+
+	// frames submitted since the start, headless runs stop after headless.frames
+	uint64_t m_frames_rendered = 0;
+	// PNG encodes still running, waited before the job system goes away
+	JobCounter m_readback_jobs{ 0 };
+
+	// downtime of the last device loss, measured until the next presented frame
+	uint32_t m_device_lost_count = 0;
+	bool m_measure_recovery = false;
+	std::chrono::steady_clock::time_point m_recovery_start;
 };
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include "buffer.h"
+
+// core
+#include "core/log.h"
+
+#include "device.h"
+
+// std
+#include <vector>
+#include <cstring>
+#include <cassert>
+
+Buffer::Buffer(Device& device, VkDeviceSize size, VkBufferUsageFlags usage, MemoryUsage memory_usage)
+	: m_device{device}
+	, m_size{size}
+	, m_usage{usage}
+{
+	VmaAllocationCreateInfo allocation_create_info = make_allocation_create_info(memory_usage);
+	create(allocation_create_info);
+}
+
+Buffer::Buffer(Device& device, VkDeviceSize size, MemoryPool& pool)
+	: m_device{device}
+	, m_size{size}
+	, m_usage{pool.get_buffer_usage()}
+{
+	VmaAllocationCreateInfo allocation_create_info = make_allocation_create_info(pool.get_memory_usage());
+	allocation_create_info.pool = pool.get_handle();
+	create(allocation_create_info);
+}
+
+Buffer::Buffer(Buffer&& other) noexcept
+	: m_device{other.m_device}
+	, m_buffer{other.m_buffer}
+	, m_allocation{other.m_allocation}
+	, m_size{other.m_size}
+	, m_usage{other.m_usage}
+	, m_mapped{other.m_mapped}
+{
+	other.m_buffer = VK_NULL_HANDLE;
+	other.m_allocation = VK_NULL_HANDLE;
+	other.m_mapped = nullptr;
+
+	if (m_allocation != VK_NULL_HANDLE)
+	{
+		vmaSetAllocationUserData(m_device.get_allocator(), m_allocation, this);
+	}
+}
+
+Buffer::~Buffer()
+{
+	if (m_buffer != VK_NULL_HANDLE)
+	{
+		vmaDestroyBuffer(m_device.get_allocator(), m_buffer, m_allocation);
+	}
+}
+
+void Buffer::create(VmaAllocationCreateInfo& allocation_create_info)
+{
+	// defragmentation finds the owner of a moved allocation through its user data
+	allocation_create_info.pUserData = this;
+
+	VkBufferCreateInfo buffer_create_info = {
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = m_size,
+		.usage = m_usage,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE
+	};
+
+	// transfer destinations may be written by a dedicated transfer queue, share them instead of
+	// transferring ownership
+	const std::vector<uint32_t>& families = m_device.get_transfer_sharing_families();
+	if ((m_usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) && families.size() > 1)
+	{
+		buffer_create_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		buffer_create_info.queueFamilyIndexCount = static_cast<uint32_t>(families.size());
+		buffer_create_info.pQueueFamilyIndices = families.data();
+	}
+
+	VmaAllocationInfo allocation_info;
+	VK_CHECK(vmaCreateBuffer(m_device.get_allocator(), &buffer_create_info, &allocation_create_info, &m_buffer, &m_allocation, &allocation_info));
+	m_mapped = allocation_info.pMappedData;
+}
+
+void Buffer::write(const void* data, VkDeviceSize size, VkDeviceSize offset)
+{
+	assert(m_mapped && "Cannot write buffer: memory is not host visible");
+	assert(offset + size <= m_size && "Cannot write buffer: out of range");
+
+	memcpy(static_cast<char*>(m_mapped) + offset, data, size);
+	VK_CHECK(vmaFlushAllocation(m_device.get_allocator(), m_allocation, offset, size));
+}
+
+void Buffer::flush(VkDeviceSize size, VkDeviceSize offset)
+{
+	VK_CHECK(vmaFlushAllocation(m_device.get_allocator(), m_allocation, offset, size));
+}
+
+void Buffer::read(void* data, VkDeviceSize size, VkDeviceSize offset)
+{
+	assert(m_mapped && "Cannot read buffer: memory is not host visible");
+	assert(offset + size <= m_size && "Cannot read buffer: out of range");
+
+	VK_CHECK(vmaInvalidateAllocation(m_device.get_allocator(), m_allocation, offset, size));
+	memcpy(data, static_cast<const char*>(m_mapped) + offset, size);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "memory.h"
+
+// lib
+#include <vulkan/vulkan.h>
+#include <vma/vk_mem_alloc.h>
+
+class Device;
+
+class Buffer {
+public:
+
+	Buffer(Device& device, VkDeviceSize size, VkBufferUsageFlags usage, MemoryUsage memory_usage);
+
+	// Sub-allocates from a custom pool, usage must match the pool's buffer usage
+	Buffer(Device& device, VkDeviceSize size, MemoryPool& pool);
+
+	~Buffer();
+
+	Buffer(const Buffer&) = delete;
+	Buffer& operator=(const Buffer&) = delete;
+	Buffer(Buffer&& other) noexcept;
+	Buffer& operator=(Buffer&&) = delete;
+
+	// Copies into a host visible buffer through its persistent mapping
+	void write(const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
+
+	// Makes CPU writes through get_mapped() visible to the device, a no-op on coherent memory
+	void flush(VkDeviceSize size, VkDeviceSize offset = 0);
+
+	// Copies out of a host visible buffer, invalidating non coherent memory first
+	void read(void* data, VkDeviceSize size, VkDeviceSize offset = 0);
+
+	VkBuffer get_handle() const { return m_buffer; }
+	VkDeviceSize get_size() const { return m_size; }
+	void* get_mapped() const { return m_mapped; }
+
+private:
+
+	friend class MemoryPool;
+
+	void create(VmaAllocationCreateInfo& allocation_create_info);
+
+	Device& m_device;
+
+	VkBuffer m_buffer = VK_NULL_HANDLE;
+	VmaAllocation m_allocation = VK_NULL_HANDLE;
+	VkDeviceSize m_size;
+	VkBufferUsageFlags m_usage;
+	void* m_mapped = nullptr;
+};
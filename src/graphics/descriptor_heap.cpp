@@ -0,0 +1,188 @@
+#include "descriptor_heap.h"
+
+// core
+#include "core/log.h"
+
+#include "device.h"
+
+// std
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+DescriptorHeap::DescriptorHeap(Device& device, DescriptorHeapCapacity capacity)
+	: m_device{device}
+{
+	jinfo("descriptor heap constructor");
+
+	// clamp to what the device can hold in an update after bind set, and since every binding is
+	// visible to VK_SHADER_STAGE_ALL, to what a single stage may access
+	const VkPhysicalDeviceVulkan12Properties& limits = m_device.get_properties12();
+	m_capacity = {
+		.sampled_images = std::min({ capacity.sampled_images, limits.maxDescriptorSetUpdateAfterBindSampledImages, limits.maxPerStageDescriptorUpdateAfterBindSampledImages }),
+		.samplers = std::min({ capacity.samplers, limits.maxDescriptorSetUpdateAfterBindSamplers, limits.maxPerStageDescriptorUpdateAfterBindSamplers }),
+		.storage_buffers = std::min({ capacity.storage_buffers, limits.maxDescriptorSetUpdateAfterBindStorageBuffers, limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers })
+	};
+
+	std::array<VkDescriptorSetLayoutBinding, BindingCount> bindings = { {
+		{ SampledImages, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, m_capacity.sampled_images, VK_SHADER_STAGE_ALL, nullptr },
+		{ Samplers, VK_DESCRIPTOR_TYPE_SAMPLER, m_capacity.samplers, VK_SHADER_STAGE_ALL, nullptr },
+		{ StorageBuffers, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_capacity.storage_buffers, VK_SHADER_STAGE_ALL, nullptr }
+	} };
+
+	// slots may be empty and may be written while the set is bound by frames in flight
+	VkDescriptorBindingFlags binding_flag = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
+		| VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+		| VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+	std::array<VkDescriptorBindingFlags, BindingCount> binding_flags;
+	binding_flags.fill(binding_flag);
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_create_info = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+		.bindingCount = static_cast<uint32_t>(binding_flags.size()),
+		.pBindingFlags = binding_flags.data()
+	};
+
+	VkDescriptorSetLayoutCreateInfo layout_create_info = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.pNext = &binding_flags_create_info,
+		.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+		.bindingCount = static_cast<uint32_t>(bindings.size()),
+		.pBindings = bindings.data()
+	};
+	VK_CHECK(vkCreateDescriptorSetLayout(m_device.get_handle(), &layout_create_info, nullptr, &m_layout));
+
+	std::array<VkDescriptorPoolSize, BindingCount> pool_sizes = { {
+		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, m_capacity.sampled_images },
+		{ VK_DESCRIPTOR_TYPE_SAMPLER, m_capacity.samplers },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_capacity.storage_buffers }
+	} };
+
+	VkDescriptorPoolCreateInfo pool_create_info = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+		.maxSets = 1,
+		.poolSizeCount = static_cast<uint32_t>(pool_sizes.size()),
+		.pPoolSizes = pool_sizes.data()
+	};
+	VK_CHECK(vkCreateDescriptorPool(m_device.get_handle(), &pool_create_info, nullptr, &m_pool));
+
+	VkDescriptorSetAllocateInfo set_allocate_info = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.descriptorPool = m_pool,
+		.descriptorSetCount = 1,
+		.pSetLayouts = &m_layout
+	};
+	VK_CHECK(vkAllocateDescriptorSets(m_device.get_handle(), &set_allocate_info, &m_set));
+
+	m_free_lists[SampledImages].capacity = m_capacity.sampled_images;
+	m_free_lists[Samplers].capacity = m_capacity.samplers;
+	m_free_lists[StorageBuffers].capacity = m_capacity.storage_buffers;
+
+	jdebug("descriptor heap: {} sampled images, {} samplers, {} storage buffers",
+		m_capacity.sampled_images, m_capacity.samplers, m_capacity.storage_buffers);
+}
+
+DescriptorHeap::~DescriptorHeap()
+{
+	jinfo("descriptor heap destructor");
+
+	vkDestroyDescriptorPool(m_device.get_handle(), m_pool, nullptr);
+	vkDestroyDescriptorSetLayout(m_device.get_handle(), m_layout, nullptr);
+}
+
+BindlessHandle DescriptorHeap::add_sampled_image(VkImageView view, VkImageLayout layout)
+{
+	VkDescriptorImageInfo image_info = {
+		.imageView = view,
+		.imageLayout = layout
+	};
+
+	std::lock_guard lock{ m_mutex };
+	BindlessHandle handle = allocate(SampledImages);
+	write(SampledImages, handle, &image_info, nullptr);
+	return handle;
+}
+
+BindlessHandle DescriptorHeap::add_sampler(VkSampler sampler)
+{
+	VkDescriptorImageInfo image_info = {
+		.sampler = sampler
+	};
+
+	std::lock_guard lock{ m_mutex };
+	BindlessHandle handle = allocate(Samplers);
+	write(Samplers, handle, &image_info, nullptr);
+	return handle;
+}
+
+BindlessHandle DescriptorHeap::add_storage_buffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	VkDescriptorBufferInfo buffer_info = {
+		.buffer = buffer,
+		.offset = offset,
+		.range = range
+	};
+
+	std::lock_guard lock{ m_mutex };
+	BindlessHandle handle = allocate(StorageBuffers);
+	write(StorageBuffers, handle, nullptr, &buffer_info);
+	return handle;
+}
+
+void DescriptorHeap::release(Binding binding, BindlessHandle handle)
+{
+	if (handle == INVALID_BINDLESS_HANDLE)
+	{
+		return;
+	}
+
+	// the stale descriptor stays in the slot, partially bound arrays only require that shaders don't read it
+	std::lock_guard lock{ m_mutex };
+	m_free_lists[binding].released.push_back(handle);
+}
+
+void DescriptorHeap::bind(VkCommandBuffer cmd, VkPipelineBindPoint bind_point, VkPipelineLayout pipeline_layout) const
+{
+	vkCmdBindDescriptorSets(cmd, bind_point, pipeline_layout, 0, 1, &m_set, 0, nullptr);
+}
+
+BindlessHandle DescriptorHeap::allocate(Binding binding)
+{
+	FreeList& free_list = m_free_lists[binding];
+
+	if (!free_list.released.empty())
+	{
+		BindlessHandle handle = free_list.released.back();
+		free_list.released.pop_back();
+		return handle;
+	}
+
+	if (free_list.next == free_list.capacity)
+	{
+		throw std::runtime_error("descriptor heap is full");
+	}
+
+	return free_list.next++;
+}
+
+void DescriptorHeap::write(Binding binding, BindlessHandle handle, const VkDescriptorImageInfo* image_info, const VkDescriptorBufferInfo* buffer_info)
+{
+	static constexpr VkDescriptorType types[BindingCount] = {
+		VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+		VK_DESCRIPTOR_TYPE_SAMPLER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+	};
+
+	VkWriteDescriptorSet write = {
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.dstSet = m_set,
+		.dstBinding = binding,
+		.dstArrayElement = handle,
+		.descriptorCount = 1,
+		.descriptorType = types[binding],
+		.pImageInfo = image_info,
+		.pBufferInfo = buffer_info
+	};
+	vkUpdateDescriptorSets(m_device.get_handle(), 1, &write, 0, nullptr);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+// lib
+#include <vulkan/vulkan.h>
+
+// std
+#include <mutex>
+#include <vector>
+
+class Device;
+
+// Index into one of the bindless arrays, stays valid until released
+using BindlessHandle = uint32_t;
+
+inline constexpr BindlessHandle INVALID_BINDLESS_HANDLE = UINT32_MAX;
+
+// Push constant range every pipeline layout shares, the guaranteed minimum
+inline constexpr uint32_t BINDLESS_PUSH_CONSTANT_SIZE = 128;
+
+struct DescriptorHeapCapacity {
+	uint32_t sampled_images;
+	uint32_t samplers;
+	uint32_t storage_buffers;
+};
+
+// One global descriptor set of large update-after-bind arrays, matching src/shaders/bindless.glsl:
+//   binding 0: sampled images, binding 1: samplers, binding 2: storage buffers.
+// It is bound once per command buffer and shaders receive handles through push constants.
+class DescriptorHeap {
+public:
+
+	enum Binding : uint32_t {
+		SampledImages = 0,
+		Samplers = 1,
+		StorageBuffers = 2,
+		BindingCount
+	};
+
+	DescriptorHeap(Device& device, DescriptorHeapCapacity capacity);
+
+	~DescriptorHeap();
+
+	DescriptorHeap(const DescriptorHeap&) = delete;
+	DescriptorHeap& operator=(const DescriptorHeap&) = delete;
+	DescriptorHeap(DescriptorHeap&&) = delete;
+	DescriptorHeap& operator=(DescriptorHeap&&) = delete;
+
+	BindlessHandle add_sampled_image(VkImageView view, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	BindlessHandle add_sampler(VkSampler sampler);
+	BindlessHandle add_storage_buffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+
+	// Handles are reused right away, release them through Renderer::defer_destroy
+	// once no frame in flight can still index them
+	void release(Binding binding, BindlessHandle handle);
+
+	void bind(VkCommandBuffer cmd, VkPipelineBindPoint bind_point, VkPipelineLayout pipeline_layout) const;
+
+	VkDescriptorSetLayout get_layout() const { return m_layout; }
+	VkDescriptorSet get_set() const { return m_set; }
+	const DescriptorHeapCapacity& get_capacity() const { return m_capacity; }
+
+private:
+
+	struct FreeList {
+		uint32_t capacity = 0;
+		uint32_t next = 0;
+		std::vector<BindlessHandle> released;
+	};
+
+	BindlessHandle allocate(Binding binding);
+	void write(Binding binding, BindlessHandle handle, const VkDescriptorImageInfo* image_info, const VkDescriptorBufferInfo* buffer_info);
+
+	Device& m_device;
+
+	DescriptorHeapCapacity m_capacity;
+	VkDescriptorSetLayout m_layout = VK_NULL_HANDLE;
+	VkDescriptorPool m_pool = VK_NULL_HANDLE;
+	VkDescriptorSet m_set = VK_NULL_HANDLE;
+
+	// writes to the set need external synchronization, update after bind covers the GPU side
+	std::mutex m_mutex;
+	FreeList m_free_lists[BindingCount];
+};
@@ -3,6 +3,7 @@
 // core
 #include "core/config/config.h"
 #include "core/log.h"
+#include "core/profile/profiler.h"
 
 #include "window/window.h"
 
@@ -15,33 +16,68 @@
 #include <string>
 #include <map>
 #include <set>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+static constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x4F53504C; // "LPSO"
+static constexpr uint32_t PIPELINE_CACHE_VERSION = 1;
 
 
-Device::Device(Config& config, Window& window)
+Device::Device(const Config& config, Window& window)
 	: m_config{config}
 	, m_window{window}
+	, m_shader_cache{*this}
+	, m_pipeline_state_cache{*this}
 {
 	jinfo("device constructor");
+	jprofile("create device");
+	m_headless = m_window.is_headless();
 	create_instance();
-	SDL_Vulkan_CreateSurface(m_window.w_sdl(), m_instance, &m_surface);
+	if (!m_headless)
+	{
+		SDL_Vulkan_CreateSurface(m_window.w_sdl(), m_instance, &m_surface);
+	}
 	select_physical_device();
 	create_device();
+	create_timestamp_calibration();
 	create_allocator();
+	create_immediate_context();
+	create_pipeline_cache();
 }
 
 Device::~Device()
 {
 	jinfo("device destructor");
+	m_pipeline_state_cache.clear();
+	// a lost device has nothing trustworthy to save
+	if (!is_lost())
+	{
+		save_pipeline_cache();
+	}
+	vkDestroyPipelineCache(m_device, m_pipeline_cache, nullptr);
+	vkDestroyFence(m_device, m_immediate_fence, nullptr);
+	vkDestroyCommandPool(m_device, m_immediate_pool, nullptr);
 	vmaDestroyAllocator(m_allocator);
 	vkDestroyDevice(m_device, nullptr);
-	vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+	if (m_surface != VK_NULL_HANDLE)
+	{
+		vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+	}
 	vkDestroyInstance(m_instance, nullptr);
 }
 
 void Device::create_instance()
 {
 	// Convert config layers string to c string style
-	std::vector<std::string> layers = m_config.get_layers();
+	const std::vector<std::string>& layers = m_config.get_layers();
 	std::vector<const char*> cLayers;
 	for (const auto& layer : layers)
 	{
@@ -49,7 +85,7 @@ void Device::create_instance()
 	}
 
 	// Convert config extensions string to c string style
-	std::vector<std::string> extensions = m_config.get_extensions();
+	const std::vector<std::string>& extensions = m_config.get_extensions();
 	std::vector<const char*> cExtensions;
 	for (const auto& ext : extensions)
 	{
@@ -88,7 +124,7 @@ void Device::create_instance()
 		jerr("layers unsupported:");
 		for (const auto& lay : unsupported_layers)
 		{
-			fmt::println("- {}", lay);
+			jerr("- {}", lay);
 		}
 		throw std::runtime_error("instance doesn't support requested layers");
 	}
@@ -99,11 +135,15 @@ void Device::create_instance()
 	std::vector<VkExtensionProperties> available_extensions(count_extensions);
 	vkEnumerateInstanceExtensionProperties(nullptr, &count_extensions, available_extensions.data());
 
-	// Required SDL Extensions
-	uint32_t count_sdl_extensions;
-	SDL_Vulkan_GetInstanceExtensions(m_window.w_sdl(), &count_sdl_extensions, nullptr);
-	std::vector<const char*> sdl_extensions(count_sdl_extensions);
-	SDL_Vulkan_GetInstanceExtensions(m_window.w_sdl(), &count_sdl_extensions, sdl_extensions.data());
+	// Required SDL Extensions, none without a surface
+	uint32_t count_sdl_extensions = 0;
+	std::vector<const char*> sdl_extensions;
+	if (!m_headless)
+	{
+		SDL_Vulkan_GetInstanceExtensions(m_window.w_sdl(), &count_sdl_extensions, nullptr);
+		sdl_extensions.resize(count_sdl_extensions);
+		SDL_Vulkan_GetInstanceExtensions(m_window.w_sdl(), &count_sdl_extensions, sdl_extensions.data());
+	}
 
 	// Requested/Required Extensions
 	std::vector<const char*> required_extensions;
@@ -138,25 +178,26 @@ void Device::create_instance()
 		jwarn("Trying to initialize renderer without unsupported extensions:");
 		for (const auto& ext : unsupported_extensions)
 		{
-			fmt::println("- {}", ext);
+			jwarn("- {}", ext);
 		}
 	}
 
 #ifdef DEBUG
 	jdebug("Using layers:");
 	for (auto& lay : cLayers)
-		fmt::println("- {}", lay);
+		jdebug("- {}", lay);
 	jdebug("Using extensions:");
 	for (const auto& ext : required_extensions)
-		fmt::println("- {}", ext);
+		jdebug("- {}", ext);
 #endif
 
-	uint32_t appVersion = VK_MAKE_API_VERSION(
-		0 /* VARIANT */, m_config.get_app_version()[0] /* MAJOR */, m_config.get_app_version()[1] /* MINOR */, m_config.get_app_version()[2] /* PATCH */);
-	uint32_t apiVersion = VK_MAKE_API_VERSION(
-		0 /* VARIANT */, m_config.get_api_version()[0] /* MAJOR */, m_config.get_api_version()[1] /* MINOR */, m_config.get_api_version()[2] /* PATCH */);
-	uint32_t engineVersion = VK_MAKE_API_VERSION(
-		0 /* VARIANT */, m_config.get_lucida_version()[0] /* MAJOR */, m_config.get_lucida_version()[1] /* MINOR */, m_config.get_lucida_version()[2] /* PATCH */);
+	const Version& app_version = m_config.get_app_version();
+	const Version& api_version = m_config.get_api_version();
+	const Version& lucida_version = m_config.get_lucida_version();
+	uint32_t appVersion = VK_MAKE_API_VERSION(0 /* VARIANT */, app_version.major, app_version.minor, app_version.patch);
+	uint32_t apiVersion = VK_MAKE_API_VERSION(0 /* VARIANT */, api_version.major, api_version.minor, api_version.patch);
+	m_api_version = apiVersion;
+	uint32_t engineVersion = VK_MAKE_API_VERSION(0 /* VARIANT */, lucida_version.major, lucida_version.minor, lucida_version.patch);
 
 	VkApplicationInfo app_info = {
 			.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
@@ -208,6 +249,18 @@ void Device::select_physical_device()
 	{
 		m_physical_device = candidates.rbegin()->second;
 		vkGetPhysicalDeviceProperties(candidates.rbegin()->second, &m_physical_device_properties);
+
+		m_physical_device_id_properties = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES };
+		m_properties12 = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES,
+			.pNext = &m_physical_device_id_properties
+		};
+		VkPhysicalDeviceProperties2 properties2 = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+			.pNext = &m_properties12
+		};
+		vkGetPhysicalDeviceProperties2(m_physical_device, &properties2);
+
 		jdebug("Selected physical device: {}", m_physical_device_properties.deviceName);
 		jdebug("Selected physical device score: {}", candidates.rbegin()->first);
 	}
@@ -223,7 +276,7 @@ void Device::create_device()
 
 	std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
 
-	std::set<uint32_t> unique_queue_families = { indices.graphics_family.value(), indices.present_family.value() };
+	std::set<uint32_t> unique_queue_families = { indices.graphics_family.value(), indices.present_family.value(), indices.transfer_family.value() };
 
 	float queue_priority = 1.0f;
 	for (uint32_t queue_family : unique_queue_families)
@@ -237,32 +290,519 @@ void Device::create_device()
 		queue_create_infos.push_back(queue_create_info);
 	}
 
+	// Required extensions plus whichever optional ones are available
+	uint32_t count_extensions;
+	vkEnumerateDeviceExtensionProperties(m_physical_device, nullptr, &count_extensions, nullptr);
+	std::vector<VkExtensionProperties> available_extensions(count_extensions);
+	vkEnumerateDeviceExtensionProperties(m_physical_device, nullptr, &count_extensions, available_extensions.data());
+
+	// maintenance5 depends on dynamic rendering, which is only core from 1.3
+	bool vulkan13 = m_api_version >= VK_API_VERSION_1_3 && m_physical_device_properties.apiVersion >= VK_API_VERSION_1_3;
+
+	m_enabled_extensions = get_required_device_extensions();
+	for (const auto& ext : optional_device_extensions)
+	{
+		if (!vulkan13 && !strcmp(ext, VK_KHR_MAINTENANCE_5_EXTENSION_NAME))
+		{
+			continue;
+		}
+
+		for (const auto& available_ext : available_extensions)
+		{
+			if (!strcmp(available_ext.extensionName, ext))
+			{
+				m_enabled_extensions.push_back(ext);
+				break;
+			}
+		}
+	}
+
+#ifdef DEBUG
+	jdebug("Using device extensions:");
+	for (const auto& ext : m_enabled_extensions)
+		jdebug("- {}", ext);
+#endif
+
 	VkPhysicalDeviceFeatures device_features{};
 
+	// Supported features, extension feature structs are only chained when the extension is enabled
+	VkPhysicalDeviceMaintenance5FeaturesKHR supported_maintenance5 = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MAINTENANCE_5_FEATURES_KHR };
+	VkPhysicalDeviceVulkan13Features supported_features13 = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES };
+	VkPhysicalDeviceVulkan12Features supported_features12 = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
+	if (vulkan13)
+	{
+		supported_features12.pNext = &supported_features13;
+	}
+	if (is_extension_enabled(VK_KHR_MAINTENANCE_5_EXTENSION_NAME))
+	{
+		supported_features13.pNext = &supported_maintenance5;
+	}
+	VkPhysicalDeviceFeatures2 supported_features = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+		.pNext = &supported_features12
+	};
+	vkGetPhysicalDeviceFeatures2(m_physical_device, &supported_features);
+
+	if (!supported_features12.timelineSemaphore)
+	{
+		throw std::runtime_error("physical device doesn't support timeline semaphores");
+	}
+
+	// the bindless descriptor heap indexes partially bound, update after bind arrays
+	if (!supported_features12.descriptorIndexing
+		|| !supported_features12.runtimeDescriptorArray
+		|| !supported_features12.descriptorBindingPartiallyBound
+		|| !supported_features12.descriptorBindingSampledImageUpdateAfterBind
+		|| !supported_features12.descriptorBindingStorageBufferUpdateAfterBind
+		|| !supported_features12.descriptorBindingUpdateUnusedWhilePending
+		|| !supported_features12.shaderSampledImageArrayNonUniformIndexing
+		|| !supported_features12.shaderStorageBufferArrayNonUniformIndexing)
+	{
+		throw std::runtime_error("physical device doesn't support bindless descriptor indexing");
+	}
+
+	// the render graph records synchronization2 barriers
+	if (!vulkan13 || !supported_features13.synchronization2)
+	{
+		throw std::runtime_error("physical device doesn't support Vulkan 1.3 synchronization2");
+	}
+
+	m_features12 = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+		.pNext = &m_features13,
+		.drawIndirectCount = supported_features12.drawIndirectCount,
+		.descriptorIndexing = VK_TRUE,
+		.shaderSampledImageArrayNonUniformIndexing = VK_TRUE,
+		.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE,
+		.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE,
+		.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE,
+		.descriptorBindingUpdateUnusedWhilePending = VK_TRUE,
+		.descriptorBindingPartiallyBound = VK_TRUE,
+		.runtimeDescriptorArray = VK_TRUE,
+		.timelineSemaphore = VK_TRUE
+	};
+
+	bool dynamic_rendering = m_config.is_dynamic_rendering_enabled() && supported_features13.dynamicRendering;
+	if (m_config.is_dynamic_rendering_enabled() && !dynamic_rendering)
+	{
+		jwarn("dynamic rendering unsupported, falling back to render pass objects");
+	}
+
+	m_features13 = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+		.synchronization2 = VK_TRUE,
+		.dynamicRendering = dynamic_rendering ? VK_TRUE : VK_FALSE
+	};
+
+	// lets pipelines take SPIR-V inline instead of VkShaderModule objects
+	m_maintenance5_features = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MAINTENANCE_5_FEATURES_KHR,
+		.maintenance5 = supported_maintenance5.maintenance5
+	};
+	if (m_maintenance5_features.maintenance5)
+	{
+		m_features13.pNext = &m_maintenance5_features;
+	}
+
+	// GPU driven rendering emits one indirect draw per visible instance, indexed by first instance
+	device_features.multiDrawIndirect = supported_features.features.multiDrawIndirect;
+	device_features.drawIndirectFirstInstance = supported_features.features.drawIndirectFirstInstance;
+	m_gpu_driven_supported = device_features.multiDrawIndirect && device_features.drawIndirectFirstInstance && m_features12.drawIndirectCount;
+
+	// per pass pipeline statistics, the main pass executes secondaries inside the query
+	device_features.pipelineStatisticsQuery = supported_features.features.pipelineStatisticsQuery;
+	device_features.inheritedQueries = supported_features.features.inheritedQueries;
+	m_pipeline_statistics_supported = device_features.pipelineStatisticsQuery && device_features.inheritedQueries;
+
+	VkPhysicalDeviceFeatures2 enabled_features = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+		.pNext = &m_features12,
+		.features = device_features
+	};
+
 	VkDeviceCreateInfo device_create_info = {
 		.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+		.pNext = &enabled_features,
 		.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size()),
 		.pQueueCreateInfos = queue_create_infos.data(),
-		.enabledExtensionCount = static_cast<uint32_t>(device_extensions.size()),
-		.ppEnabledExtensionNames = device_extensions.data(),
-		.pEnabledFeatures = &device_features
+		.enabledExtensionCount = static_cast<uint32_t>(m_enabled_extensions.size()),
+		.ppEnabledExtensionNames = m_enabled_extensions.data(),
 	};
 
 	VK_CHECK(vkCreateDevice(m_physical_device, &device_create_info, nullptr, &m_device));
 
 	vkGetDeviceQueue(m_device, indices.graphics_family.value(), 0, &m_graphics_queue);
 	vkGetDeviceQueue(m_device, indices.present_family.value(), 0, &m_present_queue);
+	vkGetDeviceQueue(m_device, indices.transfer_family.value(), 0, &m_transfer_queue);
+
+	uint32_t count_queue_families;
+	vkGetPhysicalDeviceQueueFamilyProperties(m_physical_device, &count_queue_families, nullptr);
+	std::vector<VkQueueFamilyProperties> queue_families(count_queue_families);
+	vkGetPhysicalDeviceQueueFamilyProperties(m_physical_device, &count_queue_families, queue_families.data());
+	m_timestamp_valid_bits = queue_families[indices.graphics_family.value()].timestampValidBits;
+
+	m_transfer_sharing_families = { indices.graphics_family.value() };
+	if (indices.has_dedicated_transfer())
+	{
+		m_transfer_sharing_families.push_back(indices.transfer_family.value());
+		jdebug("dedicated transfer queue family: {}", indices.transfer_family.value());
+	}
+
+	m_shader_cache.set_inline_modules(m_maintenance5_features.maintenance5);
 }
 
 void Device::create_allocator()
 {
+	VmaAllocatorCreateFlags flags = 0;
+	if (is_extension_enabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+	{
+		flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+	}
+
 	VmaAllocatorCreateInfo allocator_create_info = {
+		.flags = flags,
 		.physicalDevice = m_physical_device,
 		.device = m_device,
-		.instance = m_instance
+		.instance = m_instance,
+		.vulkanApiVersion = m_api_version
 	};
 
 	VK_CHECK(vmaCreateAllocator(&allocator_create_info, &m_allocator));
+
+#ifdef DEBUG
+	log_memory_budget();
+#endif
+}
+
+void Device::create_immediate_context()
+{
+	VkCommandPoolCreateInfo command_pool_create_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+		.queueFamilyIndex = find_queue_families().graphics_family.value()
+	};
+	VK_CHECK(vkCreateCommandPool(m_device, &command_pool_create_info, nullptr, &m_immediate_pool));
+
+	VkCommandBufferAllocateInfo command_buffer_allocate_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.commandPool = m_immediate_pool,
+		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandBufferCount = 1
+	};
+	VK_CHECK(vkAllocateCommandBuffers(m_device, &command_buffer_allocate_info, &m_immediate_buffer));
+
+	VkFenceCreateInfo fence_create_info = { .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+	VK_CHECK(vkCreateFence(m_device, &fence_create_info, nullptr, &m_immediate_fence));
+}
+
+void Device::create_timestamp_calibration()
+{
+	if (!is_extension_enabled(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME) || m_timestamp_valid_bits == 0)
+	{
+		return;
+	}
+
+	// the host domain has to be the clock behind Profiler::now()
+	std::optional<VkTimeDomainEXT> host_domain;
+#if defined(_WIN32)
+	host_domain = VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT;
+#elif defined(__linux__)
+	host_domain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+#endif
+	if (!host_domain)
+	{
+		return;
+	}
+
+	auto get_time_domains = reinterpret_cast<PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT>(
+		vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT"));
+	m_get_calibrated_timestamps = reinterpret_cast<PFN_vkGetCalibratedTimestampsEXT>(
+		vkGetDeviceProcAddr(m_device, "vkGetCalibratedTimestampsEXT"));
+	if (!get_time_domains || !m_get_calibrated_timestamps)
+	{
+		return;
+	}
+
+	uint32_t count_domains;
+	VK_CHECK(get_time_domains(m_physical_device, &count_domains, nullptr));
+	std::vector<VkTimeDomainEXT> domains(count_domains);
+	VK_CHECK(get_time_domains(m_physical_device, &count_domains, domains.data()));
+
+	bool device_domain = std::find(domains.begin(), domains.end(), VK_TIME_DOMAIN_DEVICE_EXT) != domains.end();
+	if (device_domain && std::find(domains.begin(), domains.end(), *host_domain) != domains.end())
+	{
+		m_host_time_domain = host_domain;
+		jdebug("calibrated timestamps: device and host clock");
+	}
+}
+
+bool Device::get_calibrated_timestamps(uint64_t& device_timestamp, int64_t& host_time)
+{
+	if (!m_host_time_domain)
+	{
+		return false;
+	}
+
+	VkCalibratedTimestampInfoEXT infos[] = {
+		{ .sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT, .timeDomain = VK_TIME_DOMAIN_DEVICE_EXT },
+		{ .sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT, .timeDomain = *m_host_time_domain }
+	};
+	uint64_t timestamps[2];
+	uint64_t max_deviation;
+	VK_CHECK(m_get_calibrated_timestamps(m_device, 2, infos, timestamps, &max_deviation));
+
+	device_timestamp = timestamps[0];
+#if defined(_WIN32)
+	// steady_clock counts nanoseconds derived from the performance counter
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	uint64_t ticks = timestamps[1];
+	uint64_t ticks_per_second = static_cast<uint64_t>(frequency.QuadPart);
+	std::chrono::nanoseconds host{ (ticks / ticks_per_second) * 1000000000 + (ticks % ticks_per_second) * 1000000000 / ticks_per_second };
+#else
+	std::chrono::nanoseconds host{ timestamps[1] };
+#endif
+	host_time = std::chrono::duration_cast<std::chrono::steady_clock::duration>(host).count();
+	return true;
+}
+
+void Device::immediate_submit(std::function<void(VkCommandBuffer)>&& record)
+{
+	VK_CHECK(vkResetCommandPool(m_device, m_immediate_pool, 0));
+
+	VkCommandBufferBeginInfo command_buffer_begin_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+	};
+	VK_CHECK(vkBeginCommandBuffer(m_immediate_buffer, &command_buffer_begin_info));
+	record(m_immediate_buffer);
+	VK_CHECK(vkEndCommandBuffer(m_immediate_buffer));
+
+	VkSubmitInfo submit_info = {
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.commandBufferCount = 1,
+		.pCommandBuffers = &m_immediate_buffer
+	};
+	VK_CHECK(vkQueueSubmit(m_graphics_queue, 1, &submit_info, m_immediate_fence));
+	VK_CHECK(vkWaitForFences(m_device, 1, &m_immediate_fence, VK_TRUE, UINT64_MAX));
+	VK_CHECK(vkResetFences(m_device, 1, &m_immediate_fence));
+}
+
+std::vector<VmaBudget> Device::query_memory_budget()
+{
+	const VkPhysicalDeviceMemoryProperties* memory_properties;
+	vmaGetMemoryProperties(m_allocator, &memory_properties);
+
+	std::vector<VmaBudget> budgets(memory_properties->memoryHeapCount);
+	vmaGetHeapBudgets(m_allocator, budgets.data());
+	return budgets;
+}
+
+void Device::log_memory_budget()
+{
+	std::vector<VmaBudget> budgets = query_memory_budget();
+	for (size_t i = 0; i < budgets.size(); i++)
+	{
+		jinfo("memory heap {}: {:.1f} / {:.1f} MiB used, {} allocations",
+			i, budgets[i].usage / (1024.0 * 1024.0), budgets[i].budget / (1024.0 * 1024.0), budgets[i].statistics.allocationCount);
+	}
+}
+
+bool Device::is_extension_enabled(const char* extension) const
+{
+	for (const auto& ext : m_enabled_extensions)
+	{
+		if (!strcmp(ext, extension))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void Device::create_pipeline_cache()
+{
+	m_pipeline_cache_path = m_config.get_pipeline_cache_path();
+
+	std::vector<char> blob;
+	std::ifstream file(m_pipeline_cache_path, std::ios::ate | std::ios::binary);
+	if (file.is_open())
+	{
+		blob.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(blob.data(), blob.size());
+		file.close();
+	}
+
+	VkPipelineCacheCreateInfo pipeline_cache_create_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO
+	};
+
+	if (is_pipeline_cache_compatible(blob))
+	{
+		auto header = reinterpret_cast<const PipelineCacheFileHeader*>(blob.data());
+		m_previous_average_miss_ns = header->average_miss_ns;
+		pipeline_cache_create_info.initialDataSize = header->data_size;
+		pipeline_cache_create_info.pInitialData = blob.data() + sizeof(PipelineCacheFileHeader);
+		jinfo("pipeline cache: loaded {} bytes from {}", header->data_size, m_pipeline_cache_path);
+	}
+	else
+	{
+		jinfo("pipeline cache: starting cold");
+	}
+
+	VK_CHECK(vkCreatePipelineCache(m_device, &pipeline_cache_create_info, nullptr, &m_pipeline_cache));
+}
+
+bool Device::is_pipeline_cache_compatible(const std::vector<char>& blob)
+{
+	if (blob.empty())
+	{
+		return false;
+	}
+
+	if (blob.size() < sizeof(PipelineCacheFileHeader) + sizeof(VkPipelineCacheHeaderVersionOne))
+	{
+		jwarn("pipeline cache: {} is truncated, discarding", m_pipeline_cache_path);
+		return false;
+	}
+
+	PipelineCacheFileHeader header;
+	memcpy(&header, blob.data(), sizeof(header));
+
+	if (header.magic != PIPELINE_CACHE_MAGIC || header.version != PIPELINE_CACHE_VERSION
+		|| header.data_size != blob.size() - sizeof(PipelineCacheFileHeader))
+	{
+		jwarn("pipeline cache: {} has an invalid header, discarding", m_pipeline_cache_path);
+		return false;
+	}
+
+	if (header.vendor_id != m_physical_device_properties.vendorID
+		|| header.device_id != m_physical_device_properties.deviceID
+		|| header.driver_version != m_physical_device_properties.driverVersion
+		|| memcmp(header.driver_uuid, m_physical_device_id_properties.driverUUID, VK_UUID_SIZE) != 0)
+	{
+		jwarn("pipeline cache: {} was produced by another device or driver, discarding", m_pipeline_cache_path);
+		return false;
+	}
+
+	// the driver's own header must agree with ours, otherwise the payload was tampered with
+	VkPipelineCacheHeaderVersionOne driver_header;
+	memcpy(&driver_header, blob.data() + sizeof(PipelineCacheFileHeader), sizeof(driver_header));
+
+	if (driver_header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+		|| driver_header.vendorID != m_physical_device_properties.vendorID
+		|| driver_header.deviceID != m_physical_device_properties.deviceID
+		|| memcmp(driver_header.pipelineCacheUUID, m_physical_device_properties.pipelineCacheUUID, VK_UUID_SIZE) != 0
+		|| memcmp(header.pipeline_cache_uuid, m_physical_device_properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+	{
+		jwarn("pipeline cache: {} has a mismatching pipeline cache UUID, discarding", m_pipeline_cache_path);
+		return false;
+	}
+
+	return true;
+}
+
+void Device::save_pipeline_cache()
+{
+	if (m_pipeline_cache == VK_NULL_HANDLE || m_pipeline_cache_path.empty())
+	{
+		return;
+	}
+
+	size_t data_size = 0;
+	VkResult result = vkGetPipelineCacheData(m_device, m_pipeline_cache, &data_size, nullptr);
+	if (result != VK_SUCCESS)
+	{
+		jwarn("pipeline cache: failed to query the cache size ({}), not saving", string_VkResult(result));
+		return;
+	}
+	std::vector<char> blob(sizeof(PipelineCacheFileHeader) + data_size);
+	result = vkGetPipelineCacheData(m_device, m_pipeline_cache, &data_size, blob.data() + sizeof(PipelineCacheFileHeader));
+	if (result != VK_SUCCESS)
+	{
+		jwarn("pipeline cache: failed to read the cache ({}), not saving", string_VkResult(result));
+		return;
+	}
+
+	uint32_t misses = m_pipeline_cache_stats.misses.load();
+	PipelineCacheFileHeader header = {
+		.magic = PIPELINE_CACHE_MAGIC,
+		.version = PIPELINE_CACHE_VERSION,
+		.data_size = static_cast<uint32_t>(data_size),
+		.vendor_id = m_physical_device_properties.vendorID,
+		.device_id = m_physical_device_properties.deviceID,
+		.driver_version = m_physical_device_properties.driverVersion,
+		.average_miss_ns = misses ? m_pipeline_cache_stats.miss_ns.load() / misses : m_previous_average_miss_ns
+	};
+	memcpy(header.driver_uuid, m_physical_device_id_properties.driverUUID, VK_UUID_SIZE);
+	memcpy(header.pipeline_cache_uuid, m_physical_device_properties.pipelineCacheUUID, VK_UUID_SIZE);
+	memcpy(blob.data(), &header, sizeof(header));
+
+	// write next to the destination and rename over it, so a crash mid-write never leaves a torn cache
+	std::string tmp_path = m_pipeline_cache_path + ".tmp";
+	{
+		std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			jwarn("pipeline cache: failed to open {} for writing", tmp_path);
+			return;
+		}
+		file.write(blob.data(), blob.size());
+		file.flush();
+		if (!file)
+		{
+			jwarn("pipeline cache: failed to write {}", tmp_path);
+			return;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tmp_path, m_pipeline_cache_path, ec);
+	if (ec)
+	{
+		jwarn("pipeline cache: failed to replace {}: {}", m_pipeline_cache_path, ec.message());
+		std::filesystem::remove(tmp_path, ec);
+		return;
+	}
+
+	jinfo("pipeline cache: saved {} bytes to {}", data_size, m_pipeline_cache_path);
+}
+
+void Device::record_pipeline_creation(const VkPipelineCreationFeedback& feedback, uint64_t elapsed_ns)
+{
+	// fall back to wall time when the driver doesn't provide feedback
+	uint64_t duration = (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT) ? feedback.duration : elapsed_ns;
+
+	if (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT)
+	{
+		m_pipeline_cache_stats.hits++;
+		m_pipeline_cache_stats.hit_ns += duration;
+	}
+	else
+	{
+		m_pipeline_cache_stats.misses++;
+		m_pipeline_cache_stats.miss_ns += duration;
+	}
+}
+
+void Device::log_pipeline_cache_stats() const
+{
+	uint32_t hits = m_pipeline_cache_stats.hits.load();
+	uint32_t misses = m_pipeline_cache_stats.misses.load();
+	uint64_t hit_ns = m_pipeline_cache_stats.hit_ns.load();
+	uint64_t miss_ns = m_pipeline_cache_stats.miss_ns.load();
+
+	// estimate what the hits would have cost as misses, preferring this run's average
+	uint64_t average_miss_ns = misses ? miss_ns / misses : m_previous_average_miss_ns;
+	double saved_ms = 0.0;
+	if (hits && average_miss_ns)
+	{
+		saved_ms = (static_cast<double>(average_miss_ns) * hits - static_cast<double>(hit_ns)) / 1e6;
+	}
+
+	jinfo("pipeline cache: {} hits ({:.2f} ms), {} misses ({:.2f} ms), ~{:.2f} ms saved",
+		hits, hit_ns / 1e6, misses, miss_ns / 1e6, saved_ms);
 }
 
 bool Device::is_physical_device_suitable(VkPhysicalDevice physical_device)
@@ -275,8 +815,9 @@ bool Device::is_physical_device_suitable(VkPhysicalDevice physical_device)
 
 	bool extensions_supported = check_device_extension_support(physical_device);
 
-	bool swapchain_adequated = false;
-	if (extensions_supported)
+	// offscreen images need no surface support
+	bool swapchain_adequated = m_headless;
+	if (extensions_supported && !m_headless)
 	{
 		SwapchainSupportDetails swapchain_support = query_swapchain_support_details(physical_device);
 		swapchain_adequated = !swapchain_support.formats.empty() && !swapchain_support.present_modes.empty();
@@ -293,7 +834,8 @@ bool Device::check_device_extension_support(VkPhysicalDevice device)
 	std::vector<VkExtensionProperties> available_extensions(count_extensions);
 	vkEnumerateDeviceExtensionProperties(device, nullptr, &count_extensions, available_extensions.data());
 
-	std::set<std::string> required_extensions(device_extensions.begin(), device_extensions.end());
+	std::vector<const char*> required = get_required_device_extensions();
+	std::set<std::string> required_extensions(required.begin(), required.end());
 
 	for (const auto& ext : available_extensions)
 	{
@@ -303,6 +845,16 @@ bool Device::check_device_extension_support(VkPhysicalDevice device)
 	return required_extensions.empty();
 }
 
+std::vector<const char*> Device::get_required_device_extensions() const
+{
+	// only presentation needs the swapchain
+	if (m_headless)
+	{
+		return {};
+	}
+	return device_extensions;
+}
+
 int Device::rate_physical_device_suitability(VkPhysicalDevice physical_device)
 {
 	VkPhysicalDeviceProperties properties;
@@ -336,8 +888,16 @@ QueueFamilyIndices Device::find_queue_families(VkPhysicalDevice physical_device)
 	int i = 0;
 	for (const auto& queue_family : queue_families)
 	{
+		// without a surface nothing is presented, the graphics queue stands in for the present queue
 		uint32_t support_present = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(physical_device, i, m_surface, &support_present);
+		if (m_headless)
+		{
+			support_present = (queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+		}
+		else
+		{
+			vkGetPhysicalDeviceSurfaceSupportKHR(physical_device, i, m_surface, &support_present);
+		}
 
 		if (support_present)
 		{
@@ -356,6 +916,29 @@ QueueFamilyIndices Device::find_queue_families(VkPhysicalDevice physical_device)
 
 		i++;
 	}
+
+	// prefer a transfer-only family (DMA engine), then any non graphics family that can transfer
+	for (uint32_t family = 0; family < count_queue_family && !indices.transfer_family.has_value(); family++)
+	{
+		VkQueueFlags flags = queue_families[family].queueFlags;
+		if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+		{
+			indices.transfer_family = family;
+		}
+	}
+	for (uint32_t family = 0; family < count_queue_family && !indices.transfer_family.has_value(); family++)
+	{
+		VkQueueFlags flags = queue_families[family].queueFlags;
+		if ((flags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT)) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+		{
+			indices.transfer_family = family;
+		}
+	}
+	if (!indices.transfer_family.has_value())
+	{
+		indices.transfer_family = indices.graphics_family;
+	}
+
 	return indices;
 }
 
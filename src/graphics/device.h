@@ -1,5 +1,8 @@
 #pragma once
 
+#include "shader_cache.h"
+#include "pipeline_state_cache.h"
+
 // lib
 #include <vulkan/vulkan.h>
 #include <vma/vk_mem_alloc.h>
@@ -7,11 +10,17 @@
 // std
 #include <vector>
 #include <optional>
+#include <string>
+#include <atomic>
+#include <functional>
 
 struct QueueFamilyIndices {
 	std::optional<uint32_t> graphics_family;
 	std::optional<uint32_t> present_family;
 
+	// dedicated transfer family when the device exposes one, graphics family otherwise
+	std::optional<uint32_t> transfer_family;
+
 	bool is_complete()
 	{
 		return graphics_family.has_value() && present_family.has_value();
@@ -21,6 +30,11 @@ struct QueueFamilyIndices {
 	{
 		return graphics_family.value() == present_family.value();
 	}
+
+	bool has_dedicated_transfer()
+	{
+		return transfer_family.has_value() && transfer_family.value() != graphics_family.value();
+	}
 };
 
 struct SwapchainSupportDetails {
@@ -29,6 +43,27 @@ struct SwapchainSupportDetails {
 	std::vector<VkPresentModeKHR> present_modes;
 };
 
+// Prefix written in front of the driver blob so a cache produced by another
+// GPU or driver build is rejected before it ever reaches vkCreatePipelineCache.
+struct PipelineCacheFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t data_size;
+	uint32_t vendor_id;
+	uint32_t device_id;
+	uint32_t driver_version;
+	uint8_t driver_uuid[VK_UUID_SIZE];
+	uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+	uint64_t average_miss_ns;
+};
+
+struct PipelineCacheStats {
+	std::atomic<uint32_t> hits{};
+	std::atomic<uint32_t> misses{};
+	std::atomic<uint64_t> hit_ns{};
+	std::atomic<uint64_t> miss_ns{};
+};
+
 class Config;
 class Window;
 
@@ -38,8 +73,15 @@ class Device {
 		VK_KHR_SWAPCHAIN_EXTENSION_NAME
 	};
 
+	// enabled when the physical device supports them
+	const std::vector<const char*> optional_device_extensions = {
+		VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,
+		VK_KHR_MAINTENANCE_5_EXTENSION_NAME,
+		VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME
+	};
+
 public:
-	Device(Config& config, Window& window);
+	Device(const Config& config, Window& window);
 
 	~Device();
 
@@ -51,8 +93,58 @@ public:
 	SwapchainSupportDetails query_swapchain_support_details();
 	QueueFamilyIndices find_queue_families();
 
+	// Records the creation feedback of a pipeline built through the pipeline cache
+	void record_pipeline_creation(const VkPipelineCreationFeedback& feedback, uint64_t elapsed_ns);
+	void log_pipeline_cache_stats() const;
+
+	// Records commands into a one-off command buffer and blocks until the graphics queue executed them
+	void immediate_submit(std::function<void(VkCommandBuffer)>&& record);
+
+	// Per heap usage and budget, the budget is exact when VK_EXT_memory_budget is enabled
+	std::vector<VmaBudget> query_memory_budget();
+	void log_memory_budget();
+
+	bool is_extension_enabled(const char* extension) const;
+
+	// Set from config, off when the device lacks the feature
+	bool is_dynamic_rendering_enabled() const { return m_features13.dynamicRendering == VK_TRUE; }
+
+	// multi draw indirect with count and first instance, required by GpuScene::draw_indirect
+	bool is_gpu_driven_supported() const { return m_gpu_driven_supported; }
+
+	// Timestamps of the graphics queue carry this many bits, 0 when it cannot write timestamps
+	uint32_t get_timestamp_valid_bits() const { return m_timestamp_valid_bits; }
+
+	// Pipeline statistics queries, including around secondaries that inherit them
+	bool is_pipeline_statistics_supported() const { return m_pipeline_statistics_supported; }
+
+	// Samples the device timestamp clock and the host clock at once, host_time in Profiler::now()
+	// ticks. Returns false without VK_EXT_calibrated_timestamps or a host domain matching it.
+	bool get_calibrated_timestamps(uint64_t& device_timestamp, int64_t& host_time);
+	bool is_timestamp_calibration_supported() const { return m_host_time_domain.has_value(); }
+
+	// Rendering offscreen, there is no surface and VK_KHR_swapchain is not enabled
+	bool is_headless() const { return m_headless; }
+
+	// Set once VK_ERROR_DEVICE_LOST was seen, teardown then skips every wait on the device
+	void mark_lost() { m_lost.store(true, std::memory_order_relaxed); }
+	bool is_lost() const { return m_lost.load(std::memory_order_relaxed); }
+
+	const VkPhysicalDeviceProperties& get_properties() const { return m_physical_device_properties; }
+	const VkPhysicalDeviceVulkan12Properties& get_properties12() const { return m_properties12; }
+
 	VkSurfaceKHR get_surface() const { return m_surface; }
 	VkDevice get_handle() const { return m_device; }
+	VkQueue get_graphics_queue() const { return m_graphics_queue; }
+	VkQueue get_present_queue() const { return m_present_queue; }
+	VkQueue get_transfer_queue() const { return m_transfer_queue; }
+
+	// Families a resource written by the transfer queue and read by the graphics queue is shared between
+	const std::vector<uint32_t>& get_transfer_sharing_families() const { return m_transfer_sharing_families; }
+	VkPipelineCache get_pipeline_cache() const { return m_pipeline_cache; }
+	VmaAllocator get_allocator() const { return m_allocator; }
+	ShaderCache& get_shader_cache() { return m_shader_cache; }
+	PipelineStateCache& get_pipeline_state_cache() { return m_pipeline_state_cache; }
 
 private:
 
@@ -60,21 +152,55 @@ private:
 	void select_physical_device();
 	void create_device();
 	void create_allocator();
+	void create_immediate_context();
+	void create_timestamp_calibration();
+	void create_pipeline_cache();
+	// Runs in the destructor, failures are logged instead of thrown
+	void save_pipeline_cache();
+	bool is_pipeline_cache_compatible(const std::vector<char>& blob);
 	bool is_physical_device_suitable(VkPhysicalDevice physical_device);
 	bool check_device_extension_support(VkPhysicalDevice device);
+	std::vector<const char*> get_required_device_extensions() const;
 	int rate_physical_device_suitability(VkPhysicalDevice physical_device);
 	QueueFamilyIndices find_queue_families(VkPhysicalDevice physical_device);
 	SwapchainSupportDetails query_swapchain_support_details(VkPhysicalDevice physical_device);
 
-	Config& m_config;
+	const Config& m_config;
 	Window& m_window;
+	bool m_headless = false;
 
+	uint32_t m_api_version;
 	VkInstance m_instance;
-	VkSurfaceKHR m_surface;
+	VkSurfaceKHR m_surface = VK_NULL_HANDLE;
 	VkPhysicalDevice m_physical_device;
 	VkPhysicalDeviceProperties m_physical_device_properties;
+	VkPhysicalDeviceIDProperties m_physical_device_id_properties;
+	VkPhysicalDeviceVulkan12Properties m_properties12;
 	VkDevice m_device;
 	VkQueue m_graphics_queue;
 	VkQueue m_present_queue;
+	VkQueue m_transfer_queue;
+	std::vector<uint32_t> m_transfer_sharing_families;
+	VkPhysicalDeviceVulkan12Features m_features12{};
+	VkPhysicalDeviceVulkan13Features m_features13{};
+	bool m_gpu_driven_supported = false;
+	bool m_pipeline_statistics_supported = false;
+	uint32_t m_timestamp_valid_bits = 0;
+	std::optional<VkTimeDomainEXT> m_host_time_domain;
+	PFN_vkGetCalibratedTimestampsEXT m_get_calibrated_timestamps = nullptr;
+	std::atomic<bool> m_lost{ false };
+	VkPhysicalDeviceMaintenance5FeaturesKHR m_maintenance5_features{};
 	VmaAllocator m_allocator;
+	ShaderCache m_shader_cache;
+	PipelineStateCache m_pipeline_state_cache;
+	std::vector<const char*> m_enabled_extensions;
+
+	VkCommandPool m_immediate_pool = VK_NULL_HANDLE;
+	VkCommandBuffer m_immediate_buffer = VK_NULL_HANDLE;
+	VkFence m_immediate_fence = VK_NULL_HANDLE;
+
+	VkPipelineCache m_pipeline_cache = VK_NULL_HANDLE;
+	std::string m_pipeline_cache_path;
+	PipelineCacheStats m_pipeline_cache_stats;
+	uint64_t m_previous_average_miss_ns = 0;
 };
\ No newline at end of file
@@ -0,0 +1,353 @@
+#include "gpu_profiler.h"
+
+// core
+#include "core/log.h"
+#include "core/profile/profiler.h"
+
+#include "device.h"
+
+// lib
+#include <fmt/format.h>
+
+// std
+#include <algorithm>
+
+namespace {
+
+// Counter series in the order of GpuProfiler::STATISTICS, which is also the order results are written in
+constexpr const char* STATISTIC_NAMES[GPU_STATISTICS_COUNT] = {
+	"input assembly vertices",
+	"vertex shader invocations",
+	"clipping primitives",
+	"fragment shader invocations",
+	"compute shader invocations"
+};
+
+}
+
+GpuProfiler::GpuProfiler(Device& device, uint32_t frames_in_flight)
+	: m_device{device}
+{
+	jinfo("gpu profiler constructor");
+
+	uint32_t valid_bits = m_device.get_timestamp_valid_bits();
+	float period = m_device.get_properties().limits.timestampPeriod;
+	m_supported = valid_bits > 0 && period > 0.0f;
+	if (!m_supported)
+	{
+		jwarn("gpu profiler: graphics queue has no timestamps, gpu zones are not recorded");
+		return;
+	}
+
+	m_timestamp_mask = valid_bits >= 64 ? UINT64_MAX : (uint64_t{ 1 } << valid_bits) - 1;
+	m_timestamp_period = period;
+	m_statistics_supported = m_device.is_pipeline_statistics_supported();
+	m_report_start = std::chrono::steady_clock::now();
+
+	jdebug("gpu profiler: {} timestamp bits, {} ns per tick, statistics {}, calibrated {}",
+		valid_bits, m_timestamp_period, m_statistics_supported, m_device.is_timestamp_calibration_supported());
+
+	create_slots(frames_in_flight);
+}
+
+GpuProfiler::~GpuProfiler()
+{
+	jinfo("gpu profiler destructor");
+
+	if (!m_device.is_lost())
+	{
+		std::vector<Slot*> pending;
+		for (auto& slot : m_slots)
+		{
+			pending.push_back(&slot);
+		}
+		std::sort(pending.begin(), pending.end(), [](const Slot* a, const Slot* b) { return a->frame < b->frame; });
+		for (auto slot : pending)
+		{
+			collect(*slot);
+		}
+	}
+	destroy_slots();
+}
+
+void GpuProfiler::create_slots(uint32_t frames_in_flight)
+{
+	m_slots.resize(std::max(1u, frames_in_flight));
+	for (auto& slot : m_slots)
+	{
+		VkQueryPoolCreateInfo timestamp_pool_create_info = {
+			.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+			.queryType = VK_QUERY_TYPE_TIMESTAMP,
+			.queryCount = MAX_ZONES * 2
+		};
+		VK_CHECK(vkCreateQueryPool(m_device.get_handle(), &timestamp_pool_create_info, nullptr, &slot.timestamps));
+
+		if (m_statistics_supported)
+		{
+			VkQueryPoolCreateInfo statistics_pool_create_info = {
+				.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+				.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS,
+				.queryCount = MAX_ZONES,
+				.pipelineStatistics = STATISTICS
+			};
+			VK_CHECK(vkCreateQueryPool(m_device.get_handle(), &statistics_pool_create_info, nullptr, &slot.statistics));
+		}
+	}
+}
+
+void GpuProfiler::destroy_slots()
+{
+	for (auto& slot : m_slots)
+	{
+		vkDestroyQueryPool(m_device.get_handle(), slot.timestamps, nullptr);
+		vkDestroyQueryPool(m_device.get_handle(), slot.statistics, nullptr);
+	}
+	m_slots.clear();
+	m_current = nullptr;
+}
+
+void GpuProfiler::set_frames_in_flight(uint32_t frames_in_flight)
+{
+	if (!m_supported)
+	{
+		return;
+	}
+
+	destroy_slots();
+	create_slots(frames_in_flight);
+}
+
+void GpuProfiler::begin_frame(VkCommandBuffer cmd, uint32_t frame_index, uint64_t frame)
+{
+	m_current = nullptr;
+	m_statistics_open = false;
+	if (!m_supported)
+	{
+		return;
+	}
+
+	Slot& slot = m_slots[frame_index];
+	collect(slot);
+
+	if (!Profiler::is_enabled())
+	{
+		return;
+	}
+	calibrate();
+
+	vkCmdResetQueryPool(cmd, slot.timestamps, 0, MAX_ZONES * 2);
+	if (slot.statistics != VK_NULL_HANDLE)
+	{
+		vkCmdResetQueryPool(cmd, slot.statistics, 0, MAX_ZONES);
+	}
+
+	slot.frame = frame;
+	slot.zones.push_back({ "frame", false });
+	vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, slot.timestamps, 0);
+	m_current = &slot;
+}
+
+void GpuProfiler::end_frame(VkCommandBuffer cmd)
+{
+	if (!m_current)
+	{
+		return;
+	}
+
+	vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_current->timestamps, 1);
+	m_current->submit_time = Profiler::now();
+	m_current = nullptr;
+}
+
+uint32_t GpuProfiler::begin_zone(VkCommandBuffer cmd, const char* name)
+{
+	if (!m_current || m_current->zones.size() == MAX_ZONES)
+	{
+		return NO_ZONE;
+	}
+
+	// statistics queries cannot nest, an inner zone is only timed
+	uint32_t zone = static_cast<uint32_t>(m_current->zones.size());
+	bool statistics = m_statistics_supported && !m_statistics_open;
+	m_current->zones.push_back({ name, statistics });
+
+	vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, m_current->timestamps, zone * 2);
+	if (statistics)
+	{
+		vkCmdBeginQuery(cmd, m_current->statistics, zone, 0);
+		m_statistics_open = true;
+	}
+	return zone;
+}
+
+void GpuProfiler::end_zone(VkCommandBuffer cmd, uint32_t zone)
+{
+	if (!m_current || zone == NO_ZONE)
+	{
+		return;
+	}
+
+	if (m_current->zones[zone].statistics)
+	{
+		vkCmdEndQuery(cmd, m_current->statistics, zone);
+		m_statistics_open = false;
+	}
+	vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_current->timestamps, zone * 2 + 1);
+}
+
+void GpuProfiler::calibrate()
+{
+	auto now = std::chrono::steady_clock::now();
+	if (!m_device.is_timestamp_calibration_supported() || (m_calibrated && now - m_last_calibration < CALIBRATION_INTERVAL))
+	{
+		return;
+	}
+
+	m_calibrated = m_device.get_calibrated_timestamps(m_calibration_timestamp, m_calibration_time);
+	m_last_calibration = now;
+}
+
+int64_t GpuProfiler::to_host_time(uint64_t timestamp, uint64_t anchor_timestamp, int64_t anchor_time) const
+{
+	// the counter wraps after its valid bits, the anchor may lie on either side of timestamp
+	uint64_t forward = (timestamp - anchor_timestamp) & m_timestamp_mask;
+	int64_t ticks = forward <= m_timestamp_mask / 2
+		? static_cast<int64_t>(forward)
+		: -static_cast<int64_t>((anchor_timestamp - timestamp) & m_timestamp_mask);
+
+	std::chrono::duration<double, std::nano> elapsed{ static_cast<double>(ticks) * m_timestamp_period };
+	return anchor_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(elapsed).count();
+}
+
+double GpuProfiler::to_ms(uint64_t begin, uint64_t end) const
+{
+	return static_cast<double>((end - begin) & m_timestamp_mask) * m_timestamp_period / 1000000.0;
+}
+
+void GpuProfiler::collect(Slot& slot)
+{
+	if (slot.zones.empty())
+	{
+		return;
+	}
+
+	uint32_t zone_count = static_cast<uint32_t>(slot.zones.size());
+
+	// every query is followed by its availability, nothing waits for the GPU and VK_NOT_READY passes
+	m_timestamp_results.assign(zone_count * 2 * 2, 0);
+	VkResult result = vkGetQueryPoolResults(m_device.get_handle(), slot.timestamps, 0, zone_count * 2,
+		m_timestamp_results.size() * sizeof(uint64_t), m_timestamp_results.data(), 2 * sizeof(uint64_t),
+		VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+	uint32_t statistics_stride = GPU_STATISTICS_COUNT + 1;
+	if (result >= 0 && slot.statistics != VK_NULL_HANDLE)
+	{
+		m_statistics_results.assign(zone_count * statistics_stride, 0);
+		result = vkGetQueryPoolResults(m_device.get_handle(), slot.statistics, 0, zone_count,
+			m_statistics_results.size() * sizeof(uint64_t), m_statistics_results.data(), statistics_stride * sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+	}
+
+	// also runs from the destructor, a failed read drops the frame instead of throwing. A lost
+	// device surfaces on the next fence wait or submit.
+	if (result < 0)
+	{
+		jwarn("gpu profiler: reading the queries of frame {} returned {}, dropping it", slot.frame, string_VkResult(result));
+		slot.zones.clear();
+		return;
+	}
+
+	auto get_timestamp = [&](uint32_t query, uint64_t& timestamp) {
+		timestamp = m_timestamp_results[query * 2] & m_timestamp_mask;
+		return m_timestamp_results[query * 2 + 1] != 0;
+	};
+
+	uint64_t frame_begin, frame_end;
+	if (!get_timestamp(0, frame_begin) || !get_timestamp(1, frame_end))
+	{
+		slot.zones.clear();
+		return;
+	}
+
+	// without calibration the frame is assumed to start executing when it was submitted
+	uint64_t anchor_timestamp = m_calibrated ? m_calibration_timestamp : frame_begin;
+	int64_t anchor_time = m_calibrated ? m_calibration_time : slot.submit_time;
+
+	bool trace = Profiler::is_enabled();
+	if (trace && !m_track)
+	{
+		m_track = &Profiler::get().create_track("gpu graphics queue");
+	}
+	if (trace)
+	{
+		Profiler::get().record(*m_track, slot.zones[0].name,
+			to_host_time(frame_begin, anchor_timestamp, anchor_time), to_host_time(frame_end, anchor_timestamp, anchor_time));
+	}
+
+	m_frame_stats.frame = slot.frame;
+	m_frame_stats.gpu_ms = to_ms(frame_begin, frame_end);
+	m_frame_stats.zones.clear();
+
+	for (uint32_t zone = 1; zone < zone_count; zone++)
+	{
+		uint64_t begin, end;
+		if (!get_timestamp(zone * 2, begin) || !get_timestamp(zone * 2 + 1, end))
+		{
+			continue;
+		}
+
+		GpuZoneStats& stats = m_frame_stats.zones.emplace_back();
+		stats.name = slot.zones[zone].name;
+		stats.gpu_ms = to_ms(begin, end);
+
+		const uint64_t* statistics = slot.statistics != VK_NULL_HANDLE ? &m_statistics_results[zone * statistics_stride] : nullptr;
+		stats.has_statistics = slot.zones[zone].statistics && statistics && statistics[GPU_STATISTICS_COUNT] != 0;
+		if (stats.has_statistics)
+		{
+			std::copy(statistics, statistics + GPU_STATISTICS_COUNT, stats.statistics.begin());
+		}
+
+		if (!trace)
+		{
+			continue;
+		}
+
+		int64_t begin_time = to_host_time(begin, anchor_timestamp, anchor_time);
+		Profiler::get().record(*m_track, stats.name, begin_time, to_host_time(end, anchor_timestamp, anchor_time));
+
+		if (stats.has_statistics)
+		{
+			const char*& counter_name = m_counter_names[stats.name];
+			if (!counter_name)
+			{
+				counter_name = Profiler::get().intern(fmt::format("{} statistics", stats.name));
+			}
+			for (uint32_t i = 0; i < GPU_STATISTICS_COUNT; i++)
+			{
+				Profiler::get().record_counter(counter_name, STATISTIC_NAMES[i], begin_time, static_cast<double>(stats.statistics[i]));
+			}
+		}
+	}
+	slot.zones.clear();
+
+	m_report_sum_ms += m_frame_stats.gpu_ms;
+	m_report_max_ms = std::max(m_report_max_ms, m_frame_stats.gpu_ms);
+	m_report_frames++;
+
+	// summarize once per second rather than flooding the log every frame
+	auto now = std::chrono::steady_clock::now();
+	if (now - m_report_start >= std::chrono::seconds(1))
+	{
+		fmt::memory_buffer zones;
+		for (const auto& zone : m_frame_stats.zones)
+		{
+			fmt::format_to(fmt::appender(zones), ", {} {:.3f} ms", zone.name, zone.gpu_ms);
+		}
+		jdebug("gpu time: avg {:.3f} ms, max {:.3f} ms over {} frames, last frame{}",
+			m_report_sum_ms / m_report_frames, m_report_max_ms, m_report_frames, fmt::to_string(zones));
+		m_report_start = now;
+		m_report_sum_ms = 0.0;
+		m_report_max_ms = 0.0;
+		m_report_frames = 0;
+	}
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+// lib
+#include <vulkan/vulkan.h>
+
+// std
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class Device;
+struct ProfileThread;
+
+inline constexpr uint32_t GPU_STATISTICS_COUNT = 5;
+
+// GPU time and pipeline statistics of one zone of a finished frame
+struct GpuZoneStats {
+	const char* name = nullptr;
+	double gpu_ms = 0.0;
+	bool has_statistics = false;
+	// input assembly vertices, vertex shader, clipping primitives, fragment shader and compute shader invocations
+	std::array<uint64_t, GPU_STATISTICS_COUNT> statistics = {};
+};
+
+struct GpuFrameStats {
+	uint64_t frame = 0;
+	// first to last command of the frame's primary command buffer
+	double gpu_ms = 0.0;
+	std::vector<GpuZoneStats> zones;
+};
+
+// Per frame slot query pools timing the frame and each zone on the graphics queue. Results of a
+// slot are read when the slot comes around again, after its fence signaled, without waiting on
+// the queries, so they arrive frames in flight frames late. Finished frames are published to the
+// Profiler on a "gpu graphics queue" track in host time, through VK_EXT_calibrated_timestamps
+// when available and anchored to the submit time otherwise. Queries are only recorded while the
+// Profiler is enabled. Zones must not overlap, statistics are skipped without pipelineStatisticsQuery
+// and inheritedQueries.
+class GpuProfiler {
+public:
+
+	// zone 0 is the whole frame
+	static constexpr uint32_t MAX_ZONES = 64;
+
+	static constexpr VkQueryPipelineStatisticFlags STATISTICS =
+		VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT
+		| VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT
+		| VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT
+		| VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT
+		| VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
+	// The device and host clocks drift apart, they are sampled together this often
+	static constexpr std::chrono::seconds CALIBRATION_INTERVAL{ 1 };
+
+	static constexpr uint32_t NO_ZONE = UINT32_MAX;
+
+	GpuProfiler(Device& device, uint32_t frames_in_flight);
+
+	// Publishes the frames still pending, the device must be idle
+	~GpuProfiler();
+
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+	GpuProfiler(GpuProfiler&&) = delete;
+	GpuProfiler& operator=(GpuProfiler&&) = delete;
+
+	// Publishes what the slot recorded last time and starts the frame zone. Call once the slot's
+	// fence signaled, right after cmd began.
+	void begin_frame(VkCommandBuffer cmd, uint32_t frame_index, uint64_t frame);
+
+	// Ends the frame zone, call right before cmd ends and is submitted
+	void end_frame(VkCommandBuffer cmd);
+
+	// Outside render pass instances only. Returns NO_ZONE when nothing is recorded, which end_zone ignores.
+	uint32_t begin_zone(VkCommandBuffer cmd, const char* name);
+	void end_zone(VkCommandBuffer cmd, uint32_t zone);
+
+	// For the inheritance info of secondaries executed inside a zone
+	VkQueryPipelineStatisticFlags get_inherited_statistics() const { return m_statistics_supported ? STATISTICS : 0; }
+
+	// Recreates the query pools, pending results are dropped. The device must be idle.
+	void set_frames_in_flight(uint32_t frames_in_flight);
+
+	// Last frame published
+	const GpuFrameStats& get_frame_stats() const { return m_frame_stats; }
+
+private:
+
+	struct Zone {
+		const char* name;
+		bool statistics;
+	};
+
+	struct Slot {
+		VkQueryPool timestamps = VK_NULL_HANDLE;
+		VkQueryPool statistics = VK_NULL_HANDLE;
+		uint64_t frame = 0;
+		// empty when the frame recorded no queries
+		std::vector<Zone> zones;
+		// host time of the submit, anchors the frame without calibrated timestamps
+		int64_t submit_time = 0;
+	};
+
+	void create_slots(uint32_t frames_in_flight);
+	void destroy_slots();
+	// Publishes what the slot recorded, results that cannot be read are dropped instead of thrown
+	void collect(Slot& slot);
+	void calibrate();
+	// device timestamp to Profiler::now() ticks
+	int64_t to_host_time(uint64_t timestamp, uint64_t anchor_timestamp, int64_t anchor_time) const;
+	double to_ms(uint64_t begin, uint64_t end) const;
+
+	Device& m_device;
+	bool m_supported = false;
+	bool m_statistics_supported = false;
+	uint64_t m_timestamp_mask = 0;
+	double m_timestamp_period = 1.0;
+
+	std::vector<Slot> m_slots;
+	Slot* m_current = nullptr;
+	bool m_statistics_open = false;
+
+	bool m_calibrated = false;
+	uint64_t m_calibration_timestamp = 0;
+	int64_t m_calibration_time = 0;
+	std::chrono::steady_clock::time_point m_last_calibration;
+
+	ProfileThread* m_track = nullptr;
+	// counter names per zone name, both interned
+	std::unordered_map<const char*, const char*> m_counter_names;
+
+	std::vector<uint64_t> m_timestamp_results;
+	std::vector<uint64_t> m_statistics_results;
+
+	GpuFrameStats m_frame_stats;
+	std::chrono::steady_clock::time_point m_report_start;
+	double m_report_sum_ms = 0.0;
+	double m_report_max_ms = 0.0;
+	uint32_t m_report_frames = 0;
+};
@@ -0,0 +1,333 @@
+#include "gpu_scene.h"
+
+// core
+#include "core/log.h"
+
+#include "renderer.h"
+#include "shader.h"
+
+// std
+#include <algorithm>
+#include <cfloat>
+#include <stdexcept>
+
+namespace {
+
+// push constant blocks of cull.comp and gpu_scene.vert, both fit BINDLESS_PUSH_CONSTANT_SIZE
+struct CullConstants {
+	glm::vec4 frustum[6];
+	BindlessHandle instances;
+	BindlessHandle meshes;
+	BindlessHandle draws;
+	BindlessHandle count;
+	uint32_t instance_count;
+};
+
+struct DrawConstants {
+	glm::mat4 view_projection;
+	BindlessHandle instances;
+};
+
+static_assert(sizeof(CullConstants) <= BINDLESS_PUSH_CONSTANT_SIZE);
+static_assert(sizeof(DrawConstants) <= BINDLESS_PUSH_CONSTANT_SIZE);
+
+constexpr uint32_t CULL_GROUP_SIZE = 64;
+
+// Gribb-Hartmann plane extraction, Vulkan clip space depth is [0, 1]
+void extract_frustum(const glm::mat4& m, glm::vec4 (&planes)[6])
+{
+	glm::vec4 row0 = { m[0][0], m[1][0], m[2][0], m[3][0] };
+	glm::vec4 row1 = { m[0][1], m[1][1], m[2][1], m[3][1] };
+	glm::vec4 row2 = { m[0][2], m[1][2], m[2][2], m[3][2] };
+	glm::vec4 row3 = { m[0][3], m[1][3], m[2][3], m[3][3] };
+
+	planes[0] = row3 + row0;
+	planes[1] = row3 - row0;
+	planes[2] = row3 + row1;
+	planes[3] = row3 - row1;
+	planes[4] = row2;
+	planes[5] = row3 - row2;
+
+	for (auto& plane : planes)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+}
+
+}
+
+GpuScene::GpuScene(Renderer& renderer, uint32_t max_instances, uint32_t max_vertices, uint32_t max_indices)
+	: m_renderer{renderer}
+	, m_max_instances{max_instances}
+	, m_max_vertices{max_vertices}
+	, m_max_indices{max_indices}
+	, m_vertices{ renderer.get_device(), max_vertices * sizeof(Vertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, MemoryUsage::DeviceLocal }
+	, m_indices{ renderer.get_device(), max_indices * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, MemoryUsage::DeviceLocal }
+	, m_meshes{ renderer.get_device(), std::max(max_instances, 1u) * sizeof(GpuMesh), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, MemoryUsage::DeviceLocal }
+	, m_instance_buffer{ renderer.get_device(), std::max(max_instances, 1u) * sizeof(GpuInstance), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, MemoryUsage::DeviceLocal }
+{
+	jinfo("gpu scene constructor");
+
+	DescriptorHeap& heap = m_renderer.get_descriptor_heap();
+	m_meshes_handle = heap.add_storage_buffer(m_meshes.get_handle());
+	m_instances_handle = heap.add_storage_buffer(m_instance_buffer.get_handle());
+
+	create_frame_buffers(m_renderer.get_frames_in_flight());
+	create_pipelines();
+}
+
+GpuScene::~GpuScene()
+{
+	jinfo("gpu scene destructor");
+
+	// the buffers are destroyed right away, callers wait for the device before tearing the scene down
+	DescriptorHeap& heap = m_renderer.get_descriptor_heap();
+	heap.release(DescriptorHeap::StorageBuffers, m_meshes_handle);
+	heap.release(DescriptorHeap::StorageBuffers, m_instances_handle);
+	for (auto& frame : m_frames)
+	{
+		heap.release(DescriptorHeap::StorageBuffers, frame.draws_handle);
+		heap.release(DescriptorHeap::StorageBuffers, frame.count_handle);
+	}
+}
+
+void GpuScene::create_frame_buffers(uint32_t frames_in_flight)
+{
+	Device& device = m_renderer.get_device();
+	DescriptorHeap& heap = m_renderer.get_descriptor_heap();
+
+	// only ever grows, slots beyond a lowered frames in flight count simply go unused
+	while (m_frames.size() < frames_in_flight)
+	{
+		Buffer draws{ device, std::max(m_max_instances, 1u) * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MemoryUsage::DeviceLocal };
+		Buffer count{ device, sizeof(uint32_t), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, MemoryUsage::DeviceLocal };
+		BindlessHandle draws_handle = heap.add_storage_buffer(draws.get_handle());
+		BindlessHandle count_handle = heap.add_storage_buffer(count.get_handle());
+		m_frames.push_back({ std::move(draws), std::move(count), draws_handle, count_handle });
+	}
+}
+
+void GpuScene::create_pipelines()
+{
+	Device& device = m_renderer.get_device();
+
+	create_draw_pipeline();
+
+	Shader cull_shader{ device, "shaders/spv/cull.comp.spv" };
+
+	// inline modules chain their create info instead of passing a handle
+	const std::shared_ptr<const ShaderModule>& cull_module = cull_shader.get_shader_module();
+	VkComputePipelineCreateInfo compute_pipeline_create_info = {
+		.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+		.stage = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.pNext = cull_module->module == VK_NULL_HANDLE ? &cull_module->create_info : nullptr,
+			.stage = VK_SHADER_STAGE_COMPUTE_BIT,
+			.module = cull_module->module,
+			.pName = "main"
+		},
+		.layout = m_renderer.get_pipeline_layout()
+	};
+
+	Pipeline cull_pipeline{ device };
+	cull_pipeline.m_bind_point = VK_PIPELINE_BIND_POINT_COMPUTE;
+	VK_CHECK(vkCreateComputePipelines(device.get_handle(), device.get_pipeline_cache(), 1, &compute_pipeline_create_info, nullptr, &cull_pipeline.m_handle));
+	m_cull_pipeline.emplace(std::move(cull_pipeline));
+}
+
+void GpuScene::create_draw_pipeline()
+{
+	Device& device = m_renderer.get_device();
+
+	Shader vert_shader{ device, "shaders/spv/gpu_scene.vert.spv" };
+	Shader frag_shader{ device, "shaders/spv/gpu_scene.frag.spv" };
+
+	PipelineBuilder builder = m_renderer.create_pipeline_builder()
+		.add_shader_stage(vert_shader, VK_SHADER_STAGE_VERTEX_BIT)
+		.add_shader_stage(frag_shader, VK_SHADER_STAGE_FRAGMENT_BIT)
+		.set_dynamic_states(VK_DYNAMIC_STATE_VIEWPORT)
+		.set_dynamic_states(VK_DYNAMIC_STATE_SCISSOR)
+		.add_color_blend_attachment()
+		.set_debug_name("gpu scene");
+	m_draw_pipeline = device.get_pipeline_state_cache().get(builder);
+}
+
+MeshHandle GpuScene::add_mesh(std::span<const Vertex> vertices, std::span<const uint32_t> indices)
+{
+	if (m_vertex_count + vertices.size() > m_max_vertices || m_index_count + indices.size() > m_max_indices || m_meshes_data.size() == m_max_instances)
+	{
+		throw std::runtime_error("gpu scene megabuffers are full");
+	}
+
+	// bounding sphere around the box center, loose but cheap
+	glm::vec3 min{ FLT_MAX };
+	glm::vec3 max{ -FLT_MAX };
+	for (const auto& vertex : vertices)
+	{
+		min = glm::min(min, vertex.position);
+		max = glm::max(max, vertex.position);
+	}
+	glm::vec3 center = (min + max) * 0.5f;
+	float radius = 0.0f;
+	for (const auto& vertex : vertices)
+	{
+		radius = std::max(radius, glm::length(vertex.position - center));
+	}
+
+	if (m_pending_vertices.empty())
+	{
+		m_pending_vertex_start = m_vertex_count;
+	}
+	if (m_pending_indices.empty())
+	{
+		m_pending_index_start = m_index_count;
+	}
+	m_pending_vertices.insert(m_pending_vertices.end(), vertices.begin(), vertices.end());
+	m_pending_indices.insert(m_pending_indices.end(), indices.begin(), indices.end());
+
+	GpuMesh mesh = {
+		.bounds = glm::vec4(center, radius),
+		.first_index = m_index_count,
+		.index_count = static_cast<uint32_t>(indices.size()),
+		.vertex_offset = static_cast<int32_t>(m_vertex_count)
+	};
+	m_meshes_data.push_back(mesh);
+
+	m_vertex_count += static_cast<uint32_t>(vertices.size());
+	m_index_count += static_cast<uint32_t>(indices.size());
+
+	return static_cast<MeshHandle>(m_meshes_data.size() - 1);
+}
+
+uint32_t GpuScene::add_instance(MeshHandle mesh, const glm::mat4& transform)
+{
+	if (m_instances.size() == m_max_instances)
+	{
+		throw std::runtime_error("gpu scene instance buffer is full");
+	}
+
+	m_instances.push_back({ transform, mesh, {} });
+	return static_cast<uint32_t>(m_instances.size() - 1);
+}
+
+void GpuScene::upload()
+{
+	Uploader& uploader = m_renderer.get_uploader();
+
+	if (!m_pending_vertices.empty())
+	{
+		uploader.upload_buffer(m_vertices, m_pending_vertices.data(), m_pending_vertices.size() * sizeof(Vertex), m_pending_vertex_start * sizeof(Vertex));
+		m_pending_vertices.clear();
+	}
+	if (!m_pending_indices.empty())
+	{
+		uploader.upload_buffer(m_indices, m_pending_indices.data(), m_pending_indices.size() * sizeof(uint32_t), m_pending_index_start * sizeof(uint32_t));
+		m_pending_indices.clear();
+	}
+	if (m_uploaded_meshes < m_meshes_data.size())
+	{
+		uploader.upload_buffer(m_meshes, &m_meshes_data[m_uploaded_meshes], (m_meshes_data.size() - m_uploaded_meshes) * sizeof(GpuMesh), m_uploaded_meshes * sizeof(GpuMesh));
+		m_uploaded_meshes = static_cast<uint32_t>(m_meshes_data.size());
+	}
+	if (m_uploaded_instances < m_instances.size())
+	{
+		uploader.upload_buffer(m_instance_buffer, &m_instances[m_uploaded_instances], (m_instances.size() - m_uploaded_instances) * sizeof(GpuInstance), m_uploaded_instances * sizeof(GpuInstance));
+		m_uploaded_instances = static_cast<uint32_t>(m_instances.size());
+	}
+
+	UploadTicket ticket = uploader.flush();
+	m_renderer.wait_for_upload(ticket, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT);
+}
+
+void GpuScene::cull(VkCommandBuffer cmd, const glm::mat4& view_projection)
+{
+	// frames in flight may have been raised by a config reload
+	create_frame_buffers(m_renderer.get_frames_in_flight());
+
+	FrameBuffers& frame = m_frames[m_renderer.get_frame_index()];
+	uint32_t instance_count = get_instance_count();
+
+	vkCmdFillBuffer(cmd, frame.count.get_handle(), 0, sizeof(uint32_t), 0);
+
+	// the previous use of this frame's buffers was drawn by the frame that last used the slot
+	VkMemoryBarrier2 reset_barrier = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+		.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+		.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+		.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+	};
+	VkDependencyInfo reset_dependency = {
+		.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		.memoryBarrierCount = 1,
+		.pMemoryBarriers = &reset_barrier
+	};
+	vkCmdPipelineBarrier2(cmd, &reset_dependency);
+
+	if (instance_count > 0)
+	{
+		CullConstants constants = {
+			.instances = m_instances_handle,
+			.meshes = m_meshes_handle,
+			.draws = frame.draws_handle,
+			.count = frame.count_handle,
+			.instance_count = instance_count
+		};
+		extract_frustum(view_projection, constants.frustum);
+
+		m_cull_pipeline->bind(cmd);
+		m_renderer.get_descriptor_heap().bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_renderer.get_pipeline_layout());
+		m_renderer.push_constants(cmd, &constants, sizeof(constants));
+		vkCmdDispatch(cmd, (instance_count + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+	}
+
+	VkMemoryBarrier2 draw_barrier = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+		.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+		.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		.dstStageMask = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+		.dstAccessMask = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT
+	};
+	VkDependencyInfo draw_dependency = {
+		.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		.memoryBarrierCount = 1,
+		.pMemoryBarriers = &draw_barrier
+	};
+	vkCmdPipelineBarrier2(cmd, &draw_dependency);
+}
+
+void GpuScene::bind_geometry(VkCommandBuffer cmd, const glm::mat4& view_projection)
+{
+	m_draw_pipeline->bind(cmd);
+
+	VkBuffer vertex_buffer = m_vertices.get_handle();
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(cmd, 0, 1, &vertex_buffer, &offset);
+	vkCmdBindIndexBuffer(cmd, m_indices.get_handle(), 0, VK_INDEX_TYPE_UINT32);
+
+	DrawConstants constants = {
+		.view_projection = view_projection,
+		.instances = m_instances_handle
+	};
+	m_renderer.push_constants(cmd, &constants, sizeof(constants));
+}
+
+void GpuScene::draw_indirect(VkCommandBuffer cmd, const glm::mat4& view_projection)
+{
+	FrameBuffers& frame = m_frames[m_renderer.get_frame_index()];
+
+	bind_geometry(cmd, view_projection);
+	vkCmdDrawIndexedIndirectCount(cmd, frame.draws.get_handle(), 0, frame.count.get_handle(), 0,
+		get_instance_count(), sizeof(VkDrawIndexedIndirectCommand));
+}
+
+void GpuScene::draw_direct(VkCommandBuffer cmd, const glm::mat4& view_projection, uint32_t begin, uint32_t end)
+{
+	bind_geometry(cmd, view_projection);
+
+	for (uint32_t i = begin; i < end; i++)
+	{
+		const GpuMesh& mesh = m_meshes_data[m_instances[i].mesh];
+		vkCmdDrawIndexed(cmd, mesh.index_count, 1, mesh.first_index, mesh.vertex_offset, i);
+	}
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "buffer.h"
+#include "pipeline.h"
+#include "vertex.h"
+#include "uploader.h"
+#include "descriptor_heap.h"
+
+// lib
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+// std
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+class Renderer;
+
+using MeshHandle = uint32_t;
+
+// std430 mirrors of the structs in src/shaders/cull.comp and gpu_scene.vert
+struct GpuMesh {
+	glm::vec4 bounds; // object space sphere, xyz center and w radius
+	uint32_t first_index;
+	uint32_t index_count;
+	int32_t vertex_offset;
+	uint32_t padding;
+};
+
+struct GpuInstance {
+	glm::mat4 transform;
+	MeshHandle mesh;
+	uint32_t padding[3];
+};
+
+static_assert(sizeof(GpuMesh) == 32);
+static_assert(sizeof(GpuInstance) == 80);
+
+// Static geometry merged into shared vertex and index megabuffers with per instance data in
+// storage buffers. A compute pass frustum culls the instances and compacts one indexed indirect
+// command per visible instance, drawn with a single vkCmdDrawIndexedIndirectCount.
+class GpuScene {
+public:
+
+	GpuScene(Renderer& renderer, uint32_t max_instances, uint32_t max_vertices, uint32_t max_indices);
+
+	~GpuScene();
+
+	GpuScene(const GpuScene&) = delete;
+	GpuScene& operator=(const GpuScene&) = delete;
+	GpuScene(GpuScene&&) = delete;
+	GpuScene& operator=(GpuScene&&) = delete;
+
+	// Appends the mesh to the megabuffers, the data is streamed by the next upload
+	MeshHandle add_mesh(std::span<const Vertex> vertices, std::span<const uint32_t> indices);
+
+	uint32_t add_instance(MeshHandle mesh, const glm::mat4& transform);
+
+	// Streams meshes and instances added since the last call, the next frame waits for them
+	void upload();
+
+	// Fills this frame's indirect buffers, recorded outside of any render pass
+	void cull(VkCommandBuffer cmd, const glm::mat4& view_projection);
+
+	// Draws what cull left visible, inside the main pass
+	void draw_indirect(VkCommandBuffer cmd, const glm::mat4& view_projection);
+
+	// One vkCmdDrawIndexed per instance in [begin, end) without culling, the CPU submission
+	// baseline. Suits Renderer::record_parallel slices.
+	void draw_direct(VkCommandBuffer cmd, const glm::mat4& view_projection, uint32_t begin, uint32_t end);
+
+	// Against the renderer's current color format, call after Renderer::get_format_generation changed
+	// and the device is idle
+	void create_draw_pipeline();
+
+	uint32_t get_instance_count() const { return static_cast<uint32_t>(m_instances.size()); }
+
+private:
+
+	// per frame in flight, the previous frame may still draw from its buffers while this one culls
+	struct FrameBuffers {
+		Buffer draws;
+		Buffer count;
+		BindlessHandle draws_handle;
+		BindlessHandle count_handle;
+	};
+
+	void create_frame_buffers(uint32_t frames_in_flight);
+	void create_pipelines();
+	void bind_geometry(VkCommandBuffer cmd, const glm::mat4& view_projection);
+
+	Renderer& m_renderer;
+
+	uint32_t m_max_instances;
+	uint32_t m_max_vertices;
+	uint32_t m_max_indices;
+
+	Buffer m_vertices;
+	Buffer m_indices;
+	Buffer m_meshes;
+	Buffer m_instance_buffer;
+	BindlessHandle m_meshes_handle;
+	BindlessHandle m_instances_handle;
+	std::vector<FrameBuffers> m_frames;
+
+	std::vector<GpuMesh> m_meshes_data;
+	std::vector<GpuInstance> m_instances;
+	uint32_t m_vertex_count = 0;
+	uint32_t m_index_count = 0;
+
+	// first mesh and instance not streamed yet
+	uint32_t m_uploaded_meshes = 0;
+	uint32_t m_uploaded_instances = 0;
+	std::vector<Vertex> m_pending_vertices;
+	std::vector<uint32_t> m_pending_indices;
+	uint32_t m_pending_vertex_start = 0;
+	uint32_t m_pending_index_start = 0;
+
+	std::shared_ptr<Pipeline> m_draw_pipeline;
+	std::optional<Pipeline> m_cull_pipeline;
+};
@@ -0,0 +1,105 @@
+#include "image.h"
+
+// core
+#include "core/log.h"
+
+#include "device.h"
+
+VkImageAspectFlags get_format_aspect(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_D16_UNORM:
+	case VK_FORMAT_D32_SFLOAT:
+	case VK_FORMAT_X8_D24_UNORM_PACK32:
+		return VK_IMAGE_ASPECT_DEPTH_BIT;
+	case VK_FORMAT_D16_UNORM_S8_UINT:
+	case VK_FORMAT_D24_UNORM_S8_UINT:
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+	case VK_FORMAT_S8_UINT:
+		return VK_IMAGE_ASPECT_STENCIL_BIT;
+	default:
+		return VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+}
+
+Image::Image(Device& device, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, MemoryUsage memory_usage)
+	: m_device{device}
+	, m_extent{extent}
+	, m_format{format}
+	, m_aspect{get_format_aspect(format)}
+{
+	VkImageCreateInfo image_create_info = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+		.imageType = VK_IMAGE_TYPE_2D,
+		.format = format,
+		.extent = { extent.width, extent.height, 1 },
+		.mipLevels = 1,
+		.arrayLayers = 1,
+		.samples = VK_SAMPLE_COUNT_1_BIT,
+		// host access to images is only meaningful with linear tiling
+		.tiling = memory_usage == MemoryUsage::DeviceLocal ? VK_IMAGE_TILING_OPTIMAL : VK_IMAGE_TILING_LINEAR,
+		.usage = usage,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+	};
+
+	// see Buffer, images uploaded by a dedicated transfer queue are shared with the graphics queue
+	const std::vector<uint32_t>& families = m_device.get_transfer_sharing_families();
+	if ((usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) && families.size() > 1)
+	{
+		image_create_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		image_create_info.queueFamilyIndexCount = static_cast<uint32_t>(families.size());
+		image_create_info.pQueueFamilyIndices = families.data();
+	}
+
+	VmaAllocationCreateInfo allocation_create_info = make_allocation_create_info(memory_usage);
+	VK_CHECK(vmaCreateImage(m_device.get_allocator(), &image_create_info, &allocation_create_info, &m_image, &m_allocation, nullptr));
+
+	VkImageViewCreateInfo image_view_create_info = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		.image = m_image,
+		.viewType = VK_IMAGE_VIEW_TYPE_2D,
+		.format = format,
+		.components = {
+			VK_COMPONENT_SWIZZLE_IDENTITY,
+			VK_COMPONENT_SWIZZLE_IDENTITY,
+			VK_COMPONENT_SWIZZLE_IDENTITY,
+			VK_COMPONENT_SWIZZLE_IDENTITY
+		},
+		.subresourceRange = {
+			.aspectMask = m_aspect,
+			.baseMipLevel = 0,
+			.levelCount = 1,
+			.baseArrayLayer = 0,
+			.layerCount = 1
+		}
+	};
+	VK_CHECK(vkCreateImageView(m_device.get_handle(), &image_view_create_info, nullptr, &m_view));
+}
+
+Image::Image(Image&& other) noexcept
+	: m_device{other.m_device}
+	, m_image{other.m_image}
+	, m_view{other.m_view}
+	, m_allocation{other.m_allocation}
+	, m_extent{other.m_extent}
+	, m_format{other.m_format}
+	, m_aspect{other.m_aspect}
+{
+	other.m_image = VK_NULL_HANDLE;
+	other.m_view = VK_NULL_HANDLE;
+	other.m_allocation = VK_NULL_HANDLE;
+}
+
+Image::~Image()
+{
+	if (m_image == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	vkDestroyImageView(m_device.get_handle(), m_view, nullptr);
+	vmaDestroyImage(m_device.get_allocator(), m_image, m_allocation);
+}
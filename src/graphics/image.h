@@ -0,0 +1,43 @@
+#pragma once
+
+#include "memory.h"
+
+// lib
+#include <vulkan/vulkan.h>
+#include <vma/vk_mem_alloc.h>
+
+class Device;
+
+// 2D image with a single mip level and a default view
+class Image {
+public:
+
+	Image(Device& device, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, MemoryUsage memory_usage = MemoryUsage::DeviceLocal);
+
+	~Image();
+
+	Image(const Image&) = delete;
+	Image& operator=(const Image&) = delete;
+	Image(Image&& other) noexcept;
+	Image& operator=(Image&&) = delete;
+
+	VkImage get_handle() const { return m_image; }
+	VkImageView get_view() const { return m_view; }
+	VkExtent2D get_extent() const { return m_extent; }
+	VkFormat get_format() const { return m_format; }
+	VkImageAspectFlags get_aspect() const { return m_aspect; }
+
+private:
+
+	Device& m_device;
+
+	VkImage m_image = VK_NULL_HANDLE;
+	VkImageView m_view = VK_NULL_HANDLE;
+	VmaAllocation m_allocation = VK_NULL_HANDLE;
+	VkExtent2D m_extent;
+	VkFormat m_format;
+	VkImageAspectFlags m_aspect;
+};
+
+// Returns the aspect a default view of format covers
+VkImageAspectFlags get_format_aspect(VkFormat format);
@@ -0,0 +1,157 @@
+#include "memory.h"
+
+// core
+#include "core/log.h"
+
+#include "device.h"
+#include "buffer.h"
+
+// std
+#include <vector>
+
+VmaAllocationCreateInfo make_allocation_create_info(MemoryUsage usage)
+{
+	VmaAllocationCreateInfo allocation_create_info{};
+
+	switch (usage)
+	{
+	case MemoryUsage::DeviceLocal:
+		allocation_create_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+		break;
+	case MemoryUsage::Streaming:
+		allocation_create_info.usage = VMA_MEMORY_USAGE_AUTO;
+		allocation_create_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+		break;
+	case MemoryUsage::Readback:
+		allocation_create_info.usage = VMA_MEMORY_USAGE_AUTO;
+		allocation_create_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+		break;
+	}
+
+	return allocation_create_info;
+}
+
+MemoryPool::MemoryPool(Device& device, VkBufferUsageFlags buffer_usage, MemoryUsage memory_usage, VkDeviceSize block_size, size_t max_block_count)
+	: m_device{device}
+	// defragmentation moves buffers with a transfer copy
+	, m_buffer_usage{buffer_usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT}
+	, m_memory_usage{memory_usage}
+{
+	jinfo("memory pool constructor");
+
+	// the memory type is chosen once from a representative buffer
+	VkBufferCreateInfo buffer_create_info = {
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = 1024,
+		.usage = m_buffer_usage
+	};
+	VmaAllocationCreateInfo allocation_create_info = make_allocation_create_info(memory_usage);
+
+	uint32_t memory_type_index;
+	VK_CHECK(vmaFindMemoryTypeIndexForBufferInfo(m_device.get_allocator(), &buffer_create_info, &allocation_create_info, &memory_type_index));
+
+	VmaPoolCreateInfo pool_create_info = {
+		.memoryTypeIndex = memory_type_index,
+		.blockSize = block_size,
+		.maxBlockCount = max_block_count
+	};
+	VK_CHECK(vmaCreatePool(m_device.get_allocator(), &pool_create_info, &m_pool));
+}
+
+MemoryPool::~MemoryPool()
+{
+	jinfo("memory pool destructor");
+	vmaDestroyPool(m_device.get_allocator(), m_pool);
+}
+
+VkDeviceSize MemoryPool::defragment()
+{
+	VmaAllocator allocator = m_device.get_allocator();
+
+	VmaDefragmentationInfo defragmentation_info = {
+		.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_FAST_BIT,
+		.pool = m_pool
+	};
+
+	VmaDefragmentationContext context;
+	VK_CHECK(vmaBeginDefragmentation(allocator, &defragmentation_info, &context));
+
+	while (true)
+	{
+		VmaDefragmentationPassMoveInfo pass;
+		VkResult result = vmaBeginDefragmentationPass(allocator, context, &pass);
+		if (result == VK_SUCCESS)
+		{
+			break;
+		}
+		if (result != VK_INCOMPLETE)
+		{
+			VK_CHECK(result);
+		}
+
+		// recreate every moved buffer on its new memory and copy the contents over
+		std::vector<std::pair<Buffer*, VkBuffer>> moved;
+		moved.reserve(pass.moveCount);
+
+		m_device.immediate_submit([&](VkCommandBuffer cmd) {
+			for (uint32_t i = 0; i < pass.moveCount; i++)
+			{
+				VmaAllocationInfo allocation_info;
+				vmaGetAllocationInfo(allocator, pass.pMoves[i].srcAllocation, &allocation_info);
+				Buffer* buffer = static_cast<Buffer*>(allocation_info.pUserData);
+
+				const std::vector<uint32_t>& families = m_device.get_transfer_sharing_families();
+				VkBufferCreateInfo buffer_create_info = {
+					.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+					.size = buffer->m_size,
+					.usage = buffer->m_usage,
+					.sharingMode = families.size() > 1 ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+					.queueFamilyIndexCount = static_cast<uint32_t>(families.size()),
+					.pQueueFamilyIndices = families.data()
+				};
+
+				VkBuffer new_buffer;
+				VK_CHECK(vkCreateBuffer(m_device.get_handle(), &buffer_create_info, nullptr, &new_buffer));
+				VK_CHECK(vmaBindBufferMemory(allocator, pass.pMoves[i].dstTmpAllocation, new_buffer));
+
+				VkBufferCopy region = { .srcOffset = 0, .dstOffset = 0, .size = buffer->m_size };
+				vkCmdCopyBuffer(cmd, buffer->m_buffer, new_buffer, 1, &region);
+
+				moved.emplace_back(buffer, new_buffer);
+			}
+		});
+
+		for (auto& [buffer, new_buffer] : moved)
+		{
+			vkDestroyBuffer(m_device.get_handle(), buffer->m_buffer, nullptr);
+			buffer->m_buffer = new_buffer;
+		}
+
+		// VMA swaps the allocations to their new place when the pass ends
+		result = vmaEndDefragmentationPass(allocator, context, &pass);
+
+		for (auto& [buffer, new_buffer] : moved)
+		{
+			VmaAllocationInfo allocation_info;
+			vmaGetAllocationInfo(allocator, buffer->m_allocation, &allocation_info);
+			buffer->m_mapped = allocation_info.pMappedData;
+		}
+
+		if (result == VK_SUCCESS)
+		{
+			break;
+		}
+		if (result != VK_INCOMPLETE)
+		{
+			VK_CHECK(result);
+		}
+	}
+
+	VmaDefragmentationStats stats;
+	vmaEndDefragmentation(allocator, context, &stats);
+
+	jinfo("memory pool: defragmented {} allocations, {} bytes moved, {} bytes freed",
+		stats.allocationsMoved, stats.bytesMoved, stats.bytesFreed);
+
+	return stats.bytesFreed;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+// lib
+#include <vulkan/vulkan.h>
+#include <vma/vk_mem_alloc.h>
+
+class Device;
+
+enum class MemoryUsage {
+	DeviceLocal, // GPU only, filled through transfers
+	Streaming,   // host visible and persistently mapped, written sequentially by the CPU
+	Readback     // host visible, cached and persistently mapped, read by the CPU
+};
+
+VmaAllocationCreateInfo make_allocation_create_info(MemoryUsage usage);
+
+// Custom VMA pool for many small resources of the same kind, keeps them out of the
+// default pools and lets them be compacted independently.
+class MemoryPool {
+public:
+
+	// block_size of 0 lets VMA pick, max_block_count of 0 means unlimited
+	MemoryPool(Device& device, VkBufferUsageFlags buffer_usage, MemoryUsage memory_usage, VkDeviceSize block_size, size_t max_block_count = 0);
+
+	~MemoryPool();
+
+	MemoryPool(const MemoryPool&) = delete;
+	MemoryPool& operator=(const MemoryPool&) = delete;
+	MemoryPool(MemoryPool&&) = delete;
+	MemoryPool& operator=(MemoryPool&&) = delete;
+
+	// Moves live buffers to compact the pool and returns the number of bytes released.
+	// None of the pool's buffers may be in use by the GPU while this runs.
+	VkDeviceSize defragment();
+
+	VmaPool get_handle() const { return m_pool; }
+	VkBufferUsageFlags get_buffer_usage() const { return m_buffer_usage; }
+	MemoryUsage get_memory_usage() const { return m_memory_usage; }
+
+private:
+
+	Device& m_device;
+
+	VmaPool m_pool = VK_NULL_HANDLE;
+	VkBufferUsageFlags m_buffer_usage;
+	MemoryUsage m_memory_usage;
+};
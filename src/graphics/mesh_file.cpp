@@ -0,0 +1,167 @@
+#include "mesh_file.h"
+
+// std
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+uint32_t align_offset(size_t offset)
+{
+	return static_cast<uint32_t>((offset + MESH_FILE_ALIGNMENT - 1) & ~static_cast<size_t>(MESH_FILE_ALIGNMENT - 1));
+}
+
+}
+
+std::vector<uint8_t> encode_indices(std::span<const uint32_t> indices)
+{
+	std::vector<uint8_t> encoded;
+	encoded.reserve(indices.size() * 2);
+
+	uint32_t previous = 0;
+	for (uint32_t index : indices)
+	{
+		int32_t delta = static_cast<int32_t>(index - previous);
+		uint32_t zigzag = (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31);
+		previous = index;
+
+		while (zigzag >= 0x80)
+		{
+			encoded.push_back(static_cast<uint8_t>(zigzag | 0x80));
+			zigzag >>= 7;
+		}
+		encoded.push_back(static_cast<uint8_t>(zigzag));
+	}
+
+	return encoded;
+}
+
+MeshFile::MeshFile(const std::string& filename)
+	: m_file{filename}
+{
+	if (m_file.size() < sizeof(MeshFileHeader))
+	{
+		throw std::runtime_error("mesh file is truncated: " + filename);
+	}
+
+	m_header = reinterpret_cast<const MeshFileHeader*>(m_file.data());
+	if (m_header->magic != MESH_FILE_MAGIC || m_header->version != MESH_FILE_VERSION)
+	{
+		throw std::runtime_error("invalid mesh file: " + filename);
+	}
+
+	// sizes are computed in 64 bits, counts from a corrupt header must not wrap around
+	auto check_section = [&](uint32_t offset, uint64_t size) {
+		if (offset % MESH_FILE_ALIGNMENT != 0 || offset + size > m_file.size())
+		{
+			throw std::runtime_error("mesh file section out of range: " + filename);
+		}
+		return m_file.data() + offset;
+	};
+
+	const MeshFileHeader& header = *m_header;
+	uint64_t meshlet_triangle_bytes = uint64_t{ header.meshlet_triangle_count } * 3;
+	m_vertices = { reinterpret_cast<const CompactVertex*>(check_section(header.vertices_offset, uint64_t{ header.vertex_count } * sizeof(CompactVertex))), header.vertex_count };
+	m_indices = { reinterpret_cast<const uint8_t*>(check_section(header.indices_offset, header.compressed_index_size)), header.compressed_index_size };
+	m_meshlets = { reinterpret_cast<const Meshlet*>(check_section(header.meshlets_offset, uint64_t{ header.meshlet_count } * sizeof(Meshlet))), header.meshlet_count };
+	m_meshlet_vertices = { reinterpret_cast<const uint32_t*>(check_section(header.meshlet_vertices_offset, uint64_t{ header.meshlet_vertex_count } * sizeof(uint32_t))), header.meshlet_vertex_count };
+	m_meshlet_triangles = { reinterpret_cast<const uint8_t*>(check_section(header.meshlet_triangles_offset, meshlet_triangle_bytes)), static_cast<size_t>(meshlet_triangle_bytes) };
+
+	if (header.index_count % 3 != 0 || header.compressed_index_size < header.index_count)
+	{
+		throw std::runtime_error("mesh file index stream is corrupt: " + filename);
+	}
+}
+
+size_t MeshFile::decode_indices(size_t position, uint32_t& previous, uint32_t* indices, uint32_t count) const
+{
+	const uint8_t* data = m_indices.data();
+	const size_t size = m_indices.size();
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t zigzag = 0;
+		uint32_t shift = 0;
+		uint8_t byte;
+		do {
+			if (position == size || shift > 28)
+			{
+				throw std::runtime_error("mesh file index stream is corrupt");
+			}
+			byte = data[position++];
+			zigzag |= static_cast<uint32_t>(byte & 0x7f) << shift;
+			shift += 7;
+		} while (byte & 0x80);
+
+		int32_t delta = static_cast<int32_t>(zigzag >> 1) ^ -static_cast<int32_t>(zigzag & 1);
+		previous += static_cast<uint32_t>(delta);
+
+		if (previous >= m_header->vertex_count)
+		{
+			throw std::runtime_error("mesh file index out of range");
+		}
+		indices[i] = previous;
+	}
+
+	return position;
+}
+
+void MeshFile::write(const std::string& filename, const CookedMesh& mesh)
+{
+	std::vector<uint8_t> indices = encode_indices(mesh.indices);
+
+	MeshFileHeader header = {
+		.magic = MESH_FILE_MAGIC,
+		.version = MESH_FILE_VERSION,
+		.vertex_count = static_cast<uint32_t>(mesh.vertices.size()),
+		.index_count = static_cast<uint32_t>(mesh.indices.size()),
+		.meshlet_count = static_cast<uint32_t>(mesh.meshlets.size()),
+		.meshlet_vertex_count = static_cast<uint32_t>(mesh.meshlet_vertices.size()),
+		.meshlet_triangle_count = static_cast<uint32_t>(mesh.meshlet_triangles.size() / 3),
+		.compressed_index_size = static_cast<uint32_t>(indices.size()),
+		.reserved = {},
+		.bounds = { mesh.bounds.x, mesh.bounds.y, mesh.bounds.z, mesh.bounds.w }
+	};
+
+	struct Section {
+		uint32_t& offset;
+		const void* data;
+		size_t size;
+	};
+	Section sections[] = {
+		{ header.vertices_offset, mesh.vertices.data(), mesh.vertices.size() * sizeof(CompactVertex) },
+		{ header.indices_offset, indices.data(), indices.size() },
+		{ header.meshlets_offset, mesh.meshlets.data(), mesh.meshlets.size() * sizeof(Meshlet) },
+		{ header.meshlet_vertices_offset, mesh.meshlet_vertices.data(), mesh.meshlet_vertices.size() * sizeof(uint32_t) },
+		{ header.meshlet_triangles_offset, mesh.meshlet_triangles.data(), mesh.meshlet_triangles.size() }
+	};
+
+	size_t offset = sizeof(MeshFileHeader);
+	for (auto& section : sections)
+	{
+		section.offset = align_offset(offset);
+		offset = section.offset + section.size;
+	}
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("failed to open mesh file for writing: " + filename);
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	const char padding[MESH_FILE_ALIGNMENT]{};
+	for (const auto& section : sections)
+	{
+		size_t position = static_cast<size_t>(file.tellp());
+		file.write(padding, section.offset - position);
+		file.write(static_cast<const char*>(section.data), section.size);
+	}
+
+	if (!file)
+	{
+		throw std::runtime_error("failed to write mesh file: " + filename);
+	}
+}
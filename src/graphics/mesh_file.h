@@ -0,0 +1,110 @@
+#pragma once
+
+#include "utils.h"
+#include "vertex.h"
+
+// std
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// Cooked mesh, written by LucidaMeshCook and mapped as is at runtime:
+//
+//   MeshFileHeader
+//   CompactVertex[vertex_count]            in first use order of the index buffer
+//   compressed indices                     see encode_indices
+//   Meshlet[meshlet_count]
+//   uint32_t[meshlet_vertex_count]         mesh vertex of every meshlet local vertex
+//   uint8_t[meshlet_triangle_count * 3]    meshlet local triangle corners
+//
+// Every section starts at a multiple of MESH_FILE_ALIGNMENT.
+
+static constexpr uint32_t MESH_FILE_MAGIC = 0x48534D4C; // "LMSH"
+static constexpr uint32_t MESH_FILE_VERSION = 1;
+static constexpr uint32_t MESH_FILE_ALIGNMENT = 16;
+
+// Fits the mesh shader limits of every vendor, at most 3 * 124 local index bytes
+static constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+static constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+struct MeshFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertex_count;
+	uint32_t index_count;
+	uint32_t meshlet_count;
+	uint32_t meshlet_vertex_count;
+	uint32_t meshlet_triangle_count;
+	uint32_t compressed_index_size;
+	uint32_t vertices_offset;
+	uint32_t indices_offset;
+	uint32_t meshlets_offset;
+	uint32_t meshlet_vertices_offset;
+	uint32_t meshlet_triangles_offset;
+	uint32_t reserved[3];
+	float bounds[4]; // object space sphere, xyz center and w radius
+};
+
+struct Meshlet {
+	uint32_t vertex_offset;
+	uint32_t triangle_offset;
+	uint32_t vertex_count;
+	uint32_t triangle_count;
+	float bounds[4];
+};
+
+static_assert(sizeof(MeshFileHeader) == 80);
+static_assert(sizeof(Meshlet) == 32);
+
+// Everything the cooker produces, in memory
+struct CookedMesh {
+	std::vector<CompactVertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<Meshlet> meshlets;
+	std::vector<uint32_t> meshlet_vertices;
+	std::vector<uint8_t> meshlet_triangles;
+	glm::vec4 bounds{ 0.0f };
+};
+
+// Indices as zigzag deltas to the previous index in LEB128 varints. After vertex fetch
+// reordering most deltas fit one byte.
+std::vector<uint8_t> encode_indices(std::span<const uint32_t> indices);
+
+class MeshFile {
+public:
+
+	MeshFile(const std::string& filename);
+
+	MeshFile(const MeshFile&) = delete;
+	MeshFile& operator=(const MeshFile&) = delete;
+	MeshFile(MeshFile&&) = default;
+	MeshFile& operator=(MeshFile&&) = delete;
+
+	// Decodes count indices starting at the stream position into indices and returns the
+	// new position, start with position 0 and previous 0 and keep both between calls
+	size_t decode_indices(size_t position, uint32_t& previous, uint32_t* indices, uint32_t count) const;
+
+	uint32_t get_vertex_count() const { return m_header->vertex_count; }
+	uint32_t get_index_count() const { return m_header->index_count; }
+	glm::vec4 get_bounds() const { return { m_header->bounds[0], m_header->bounds[1], m_header->bounds[2], m_header->bounds[3] }; }
+
+	// Spans into the mapping, valid as long as the file
+	std::span<const CompactVertex> get_vertices() const { return m_vertices; }
+	std::span<const uint8_t> get_compressed_indices() const { return m_indices; }
+	std::span<const Meshlet> get_meshlets() const { return m_meshlets; }
+	std::span<const uint32_t> get_meshlet_vertices() const { return m_meshlet_vertices; }
+	std::span<const uint8_t> get_meshlet_triangles() const { return m_meshlet_triangles; }
+
+	static void write(const std::string& filename, const CookedMesh& mesh);
+
+private:
+
+	MappedFile m_file;
+	const MeshFileHeader* m_header = nullptr;
+	std::span<const CompactVertex> m_vertices;
+	std::span<const uint8_t> m_indices;
+	std::span<const Meshlet> m_meshlets;
+	std::span<const uint32_t> m_meshlet_vertices;
+	std::span<const uint8_t> m_meshlet_triangles;
+};
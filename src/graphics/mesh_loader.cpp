@@ -0,0 +1,48 @@
+#include "mesh_loader.h"
+
+// core
+#include "core/log.h"
+
+#include "buffer.h"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+UploadTicket stream_mesh(Uploader& uploader, const MeshFile& mesh, Buffer& vertices, VkDeviceSize vertex_offset, Buffer& indices, VkDeviceSize index_offset)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	VkDeviceSize chunk_bytes = uploader.get_capacity() / 4;
+	uint32_t vertex_chunk = static_cast<uint32_t>(chunk_bytes / sizeof(CompactVertex));
+	uint32_t index_chunk = static_cast<uint32_t>(chunk_bytes / sizeof(uint32_t));
+	if (vertex_chunk == 0 || index_chunk == 0)
+	{
+		throw std::runtime_error("staging ring too small to stream meshes");
+	}
+
+	std::span<const CompactVertex> source = mesh.get_vertices();
+	for (uint32_t first = 0; first < source.size(); first += vertex_chunk)
+	{
+		uint32_t count = std::min(vertex_chunk, static_cast<uint32_t>(source.size()) - first);
+		uploader.upload_buffer(vertices, &source[first], count * sizeof(CompactVertex), vertex_offset + first * sizeof(CompactVertex));
+	}
+
+	size_t position = 0;
+	uint32_t previous = 0;
+	for (uint32_t first = 0; first < mesh.get_index_count(); first += index_chunk)
+	{
+		uint32_t count = std::min(index_chunk, mesh.get_index_count() - first);
+		auto staged = static_cast<uint32_t*>(uploader.stage_buffer(indices, count * sizeof(uint32_t), index_offset + first * sizeof(uint32_t)));
+		position = mesh.decode_indices(position, previous, staged, count);
+	}
+
+	UploadTicket ticket = uploader.flush();
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	jinfo("streamed mesh: {} vertices, {} triangles, {} meshlets, staged in {:.2f} ms",
+		mesh.get_vertex_count(), mesh.get_index_count() / 3, mesh.get_meshlets().size(), elapsed.count());
+
+	return ticket;
+}
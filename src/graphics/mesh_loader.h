@@ -0,0 +1,15 @@
+#pragma once
+
+#include "mesh_file.h"
+#include "uploader.h"
+
+// lib
+#include <vulkan/vulkan.h>
+
+class Buffer;
+
+// Streams a cooked mesh into vertex and index buffers through the staging ring. Vertices
+// are copied from the mapping as is and indices are decoded directly into staging memory,
+// in chunks of a quarter of the ring so meshes larger than the ring still load. Returns the
+// ticket of the last batch.
+UploadTicket stream_mesh(Uploader& uploader, const MeshFile& mesh, Buffer& vertices, VkDeviceSize vertex_offset, Buffer& indices, VkDeviceSize index_offset);
@@ -10,13 +10,26 @@ Pipeline::Pipeline(Device& device)
 	jinfo("pipeline constructor");
 }
 
+Pipeline::Pipeline(Pipeline&& other) noexcept
+	: m_handle{other.m_handle}
+	, m_bind_point{other.m_bind_point}
+	, m_device{other.m_device}
+{
+	other.m_handle = VK_NULL_HANDLE;
+}
+
 Pipeline::~Pipeline()
 {
+	if (m_handle == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
 	jinfo("pipeline destructor");
 	vkDestroyPipeline(m_device.get_handle(), m_handle, nullptr);
 }
 
 void Pipeline::bind(VkCommandBuffer cmd)
 {
-	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_handle);
+	vkCmdBindPipeline(cmd, m_bind_point, m_handle);
 }
\ No newline at end of file
@@ -17,9 +17,15 @@ public:
 
 	~Pipeline();
 
+	Pipeline(const Pipeline&) = delete;
+	Pipeline& operator=(const Pipeline&) = delete;
+	Pipeline(Pipeline&& other) noexcept;
+	Pipeline& operator=(Pipeline&&) = delete;
+
 	void bind(VkCommandBuffer cmd);
 
-	VkPipeline m_handle;
+	VkPipeline m_handle = VK_NULL_HANDLE;
+	VkPipelineBindPoint m_bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS;
 private:
 
 	Device& m_device;
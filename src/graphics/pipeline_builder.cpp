@@ -1,11 +1,19 @@
 #include "pipeline_builder.h"
 
 #include "core/log.h"
+#include "core/profile/profiler.h"
 #include "vertex.h"
 #include "pipeline.h"
 #include "device.h"
+#include "shader.h"
+#include "utils.h"
 
-PipelineBuilder PipelineBuilder::create(VkPipelineLayout pipeline_layout, VkRenderPass render_pass)
+// std
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+PipelineBuilder PipelineBuilder::create(VkPipelineLayout pipeline_layout, std::span<const uint64_t> layout_description, VkRenderPass render_pass, const std::vector<VkFormat>& color_formats, VkFormat depth_format)
 {
 	assert(pipeline_layout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no VkPipelineLayout provided in configInfo");
 	assert(render_pass != VK_NULL_HANDLE && "Cannot create graphics pipeline: no VkRenderPass provided in configInfo");
@@ -13,6 +21,21 @@ PipelineBuilder PipelineBuilder::create(VkPipelineLayout pipeline_layout, VkRend
 	PipelineBuilder pipeline_builder;
 	pipeline_builder.m_render_pass = render_pass;
 	pipeline_builder.m_pipeline_layout = pipeline_layout;
+	pipeline_builder.m_layout_description.assign(layout_description.begin(), layout_description.end());
+	pipeline_builder.m_color_formats = color_formats;
+	pipeline_builder.m_depth_format = depth_format;
+	return pipeline_builder;
+}
+
+PipelineBuilder PipelineBuilder::create(VkPipelineLayout pipeline_layout, std::span<const uint64_t> layout_description, const std::vector<VkFormat>& color_formats, VkFormat depth_format)
+{
+	assert(pipeline_layout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no VkPipelineLayout provided in configInfo");
+
+	PipelineBuilder pipeline_builder;
+	pipeline_builder.m_pipeline_layout = pipeline_layout;
+	pipeline_builder.m_layout_description.assign(layout_description.begin(), layout_description.end());
+	pipeline_builder.m_color_formats = color_formats;
+	pipeline_builder.m_depth_format = depth_format;
 	return pipeline_builder;
 }
 
@@ -23,14 +46,10 @@ PipelineBuilder::PipelineBuilder()
 	// empty pipeline layout
 	m_pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 
-	m_attribute_descriptions = Vertex::get_attribute_descriptions();
-	m_binding_descriptions = Vertex::get_binding_descriptions();
+	set_vertex_layout<Vertex>();
 
+	// build required
 	m_vertex_input.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	m_vertex_input.vertexBindingDescriptionCount = static_cast<uint32_t>(m_binding_descriptions.size());
-	m_vertex_input.pVertexBindingDescriptions = m_binding_descriptions.data();
-	m_vertex_input.vertexAttributeDescriptionCount = static_cast<uint32_t>(m_attribute_descriptions.size());
-	m_vertex_input.pVertexAttributeDescriptions = m_attribute_descriptions.data();
 
 	// ok
 	m_input_assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -105,6 +124,30 @@ PipelineBuilder& PipelineBuilder::add_shader_stage(VkShaderModule module, VkShad
 	return *this;
 }
 
+PipelineBuilder& PipelineBuilder::add_shader_stage(const Shader& shader, VkShaderStageFlagBits stage)
+{
+	const std::shared_ptr<const ShaderModule>& module = shader.get_shader_module();
+
+	VkPipelineShaderStageCreateInfo shader_stage = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+		.pNext = module->module == VK_NULL_HANDLE ? &module->create_info : nullptr,
+		.stage = stage,
+		.module = module->module,
+		.pName = "main",
+	};
+
+	m_shader_stages.push_back(shader_stage);
+	m_shader_modules.push_back(module);
+	return *this;
+}
+
+PipelineBuilder& PipelineBuilder::set_vertex_input(std::span<const VkVertexInputBindingDescription> bindings, std::span<const VkVertexInputAttributeDescription> attributes)
+{
+	m_binding_descriptions.assign(bindings.begin(), bindings.end());
+	m_attribute_descriptions.assign(attributes.begin(), attributes.end());
+	return *this;
+}
+
 PipelineBuilder& PipelineBuilder::set_input_assembly(VkPrimitiveTopology topology)
 {
 	m_input_assembly.topology = topology;
@@ -156,6 +199,14 @@ PipelineBuilder& PipelineBuilder::set_debug_name(const std::string& name)
 
 Pipeline PipelineBuilder::build(Device& device)
 {
+	jprofile("build pipeline");
+
+	// apply vertex input, builders are copied into batches so pointers are resolved here
+	m_vertex_input.vertexBindingDescriptionCount = static_cast<uint32_t>(m_binding_descriptions.size());
+	m_vertex_input.pVertexBindingDescriptions = m_binding_descriptions.data();
+	m_vertex_input.vertexAttributeDescriptionCount = static_cast<uint32_t>(m_attribute_descriptions.size());
+	m_vertex_input.pVertexAttributeDescriptions = m_attribute_descriptions.data();
+
 	// apply color blend attachments
 	m_color_blend.attachmentCount = static_cast<uint32_t>(m_color_blend_attachments.size());
 	m_color_blend.pAttachments = m_color_blend_attachments.data();
@@ -164,9 +215,26 @@ Pipeline PipelineBuilder::build(Device& device)
 	m_dynamic.dynamicStateCount = static_cast<uint32_t>(m_dynamic_states.size());
 	m_dynamic.pDynamicStates = m_dynamic_states.data();
 
+	// creation feedback tells us whether the pipeline cache was hit
+	VkPipelineCreationFeedback creation_feedback{};
+	VkPipelineCreationFeedbackCreateInfo creation_feedback_create_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO,
+		.pPipelineCreationFeedback = &creation_feedback
+	};
+
+	// without a render pass the attachment formats are all the pipeline needs to know
+	VkPipelineRenderingCreateInfo rendering_create_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+		.pNext = &creation_feedback_create_info,
+		.colorAttachmentCount = static_cast<uint32_t>(m_color_formats.size()),
+		.pColorAttachmentFormats = m_color_formats.data(),
+		.depthAttachmentFormat = m_depth_format
+	};
+
 	// create graphics pipeline
 	VkGraphicsPipelineCreateInfo graphics_pipeline_create_info = {
 		.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+		.pNext = m_render_pass == VK_NULL_HANDLE ? static_cast<const void*>(&rendering_create_info) : &creation_feedback_create_info,
 		.stageCount = static_cast<uint32_t>(m_shader_stages.size()),
 		.pStages = m_shader_stages.data(),
 		.pVertexInputState = &m_vertex_input,
@@ -183,9 +251,201 @@ Pipeline PipelineBuilder::build(Device& device)
 	};
 
 	Pipeline pipeline{device};
-	VK_CHECK(vkCreateGraphicsPipelines(device.get_handle(), VK_NULL_HANDLE, 1, &graphics_pipeline_create_info, nullptr, &pipeline.m_handle));
+	auto start = std::chrono::steady_clock::now();
+	VK_CHECK(vkCreateGraphicsPipelines(device.get_handle(), device.get_pipeline_cache(), 1, &graphics_pipeline_create_info, nullptr, &pipeline.m_handle));
+	auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+	device.record_pipeline_creation(creation_feedback, static_cast<uint64_t>(elapsed.count()));
 
 	return pipeline;
 }
 
+PipelineKey PipelineBuilder::compute_key() const
+{
+	// fields are copied one by one, the create info structs carry padding and pointers
+	PipelineKey key;
+	auto add = [&key](uint64_t value) {
+		key.state.push_back(value);
+	};
+	auto add_float = [&add](float value) {
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		add(bits);
+	};
+
+	// stages by stage bit, a module is known by its content
+	for (const VkPipelineShaderStageCreateInfo& stage : m_shader_stages)
+	{
+		auto shared = std::find_if(m_shader_modules.begin(), m_shader_modules.end(), [&stage](const auto& module) {
+			return stage.module != VK_NULL_HANDLE ? module->module == stage.module : &module->create_info == stage.pNext;
+		});
+		if (shared == m_shader_modules.end())
+		{
+			throw std::invalid_argument(fmt::format("pipeline '{}': stage {} was not added from a Shader, its content is unknown", m_debug_name, static_cast<uint32_t>(stage.stage)));
+		}
+		key.stages.push_back({ stage.stage, *shared, stage.pName });
+	}
+	std::sort(key.stages.begin(), key.stages.end(), [](const PipelineKey::Stage& a, const PipelineKey::Stage& b) {
+		return a.stage < b.stage;
+	});
+
+	add(m_binding_descriptions.size());
+	for (const auto& binding : m_binding_descriptions)
+	{
+		add(binding.binding);
+		add(binding.stride);
+		add(binding.inputRate);
+	}
+	add(m_attribute_descriptions.size());
+	for (const auto& attribute : m_attribute_descriptions)
+	{
+		add(attribute.location);
+		add(attribute.binding);
+		add(attribute.format);
+		add(attribute.offset);
+	}
+
+	add(m_input_assembly.topology);
+	add(m_input_assembly.primitiveRestartEnable);
+
+	add(m_rasterizer.depthClampEnable);
+	add(m_rasterizer.rasterizerDiscardEnable);
+	add(m_rasterizer.polygonMode);
+	add(m_rasterizer.cullMode);
+	add(m_rasterizer.frontFace);
+	add(m_rasterizer.depthBiasEnable);
+	if (m_rasterizer.depthBiasEnable)
+	{
+		add_float(m_rasterizer.depthBiasConstantFactor);
+		add_float(m_rasterizer.depthBiasClamp);
+		add_float(m_rasterizer.depthBiasSlopeFactor);
+	}
+	add_float(m_rasterizer.lineWidth);
+
+	add(m_multisampling.rasterizationSamples);
+	add(m_multisampling.sampleShadingEnable);
+	if (m_multisampling.sampleShadingEnable)
+	{
+		add_float(m_multisampling.minSampleShading);
+	}
+	add(m_multisampling.alphaToCoverageEnable);
+	add(m_multisampling.alphaToOneEnable);
+
+	add(m_color_blend_attachments.size());
+	for (const auto& attachment : m_color_blend_attachments)
+	{
+		add(attachment.blendEnable);
+		if (attachment.blendEnable)
+		{
+			add(attachment.srcColorBlendFactor);
+			add(attachment.dstColorBlendFactor);
+			add(attachment.colorBlendOp);
+			add(attachment.srcAlphaBlendFactor);
+			add(attachment.dstAlphaBlendFactor);
+			add(attachment.alphaBlendOp);
+		}
+		add(attachment.colorWriteMask);
+	}
+	add(m_color_blend.logicOpEnable);
+	if (m_color_blend.logicOpEnable)
+	{
+		add(m_color_blend.logicOp);
+	}
+
+	std::vector<VkDynamicState> dynamic_states = m_dynamic_states;
+	std::sort(dynamic_states.begin(), dynamic_states.end());
+	dynamic_states.erase(std::unique(dynamic_states.begin(), dynamic_states.end()), dynamic_states.end());
+	auto is_dynamic = [&dynamic_states](VkDynamicState state) {
+		return std::binary_search(dynamic_states.begin(), dynamic_states.end(), state);
+	};
+	add(dynamic_states.size());
+	for (VkDynamicState state : dynamic_states)
+	{
+		add(state);
+	}
+
+	if (!is_dynamic(VK_DYNAMIC_STATE_BLEND_CONSTANTS))
+	{
+		for (float constant : m_color_blend.blendConstants)
+		{
+			add_float(constant);
+		}
+	}
+
+	// only meaningful when there is a depth attachment to test against
+	if (m_depth_format != VK_FORMAT_UNDEFINED)
+	{
+		add(m_depth_stencil.depthTestEnable);
+		add(m_depth_stencil.depthWriteEnable);
+		if (m_depth_stencil.depthTestEnable)
+		{
+			add(m_depth_stencil.depthCompareOp);
+		}
+		add(m_depth_stencil.depthBoundsTestEnable);
+		if (m_depth_stencil.depthBoundsTestEnable)
+		{
+			add_float(m_depth_stencil.minDepthBounds);
+			add_float(m_depth_stencil.maxDepthBounds);
+		}
+		add(m_depth_stencil.stencilTestEnable);
+		if (m_depth_stencil.stencilTestEnable)
+		{
+			for (const VkStencilOpState& op : { m_depth_stencil.front, m_depth_stencil.back })
+			{
+				add(op.failOp);
+				add(op.passOp);
+				add(op.depthFailOp);
+				add(op.compareOp);
+				add(op.compareMask);
+				add(op.writeMask);
+				add(op.reference);
+			}
+		}
+	}
+
+	add(m_layout_description.size());
+	key.state.insert(key.state.end(), m_layout_description.begin(), m_layout_description.end());
+
+	add(m_render_pass != VK_NULL_HANDLE);
+	add(m_subpass);
+	add(m_color_formats.size());
+	for (VkFormat format : m_color_formats)
+	{
+		add(format);
+	}
+	add(m_depth_format);
+
+	key.hash = hash_bytes(key.state.data(), key.state.size() * sizeof(uint64_t));
+	for (const PipelineKey::Stage& stage : key.stages)
+	{
+		key.hash = hash_combine(key.hash, stage.stage);
+		key.hash = hash_combine(key.hash, stage.module->hash);
+		key.hash = hash_combine(key.hash, hash_bytes(stage.entry_point.data(), stage.entry_point.size()));
+	}
+
+	return key;
+}
 
+bool PipelineKey::operator==(const PipelineKey& other) const
+{
+	if (hash != other.hash || state != other.state || stages.size() != other.stages.size())
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < stages.size(); i++)
+	{
+		const Stage& a = stages[i];
+		const Stage& b = other.stages[i];
+		if (a.stage != b.stage || a.entry_point != b.entry_point)
+		{
+			return false;
+		}
+		// the ShaderCache shares one module per content, distinct modules are compared by digest
+		if (a.module != b.module && a.module->digest != b.module->digest)
+		{
+			return false;
+		}
+	}
+	return true;
+}
@@ -6,17 +6,61 @@
 // std
 #include <vector>
 #include <string>
+#include <memory>
+#include <span>
 
 class Device;
 class Pipeline;
+class Shader;
+struct ShaderModule;
+
+// Normalized pipeline state, equal for builders that produce identical pipelines. Modules,
+// the layout and the render pass are compared by content rather than by handle, a handle
+// value can come back for a different object once the first one is destroyed.
+struct PipelineKey {
+	struct Stage {
+		VkShaderStageFlagBits stage;
+		std::shared_ptr<const ShaderModule> module;
+		std::string entry_point;
+	};
+
+	// sorted by stage bit
+	std::vector<Stage> stages;
+	// every other field that reaches vkCreateGraphicsPipelines, in a fixed order
+	std::vector<uint64_t> state;
+	// buckets only, equality compares the fields
+	uint64_t hash = 0;
+
+	bool operator==(const PipelineKey& other) const;
+};
+
+struct PipelineKeyHash {
+	size_t operator()(const PipelineKey& key) const { return static_cast<size_t>(key.hash); }
+};
 
 class PipelineBuilder {
 public:
 
-	static PipelineBuilder create(VkPipelineLayout pipeline_layout, VkRenderPass render_pass);
+	// layout_description is what pipeline_layout was created from, flattened by the caller. The
+	// render pass is known by its attachment formats, pipelines are compatible across render
+	// passes with the same ones.
+	static PipelineBuilder create(VkPipelineLayout pipeline_layout, std::span<const uint64_t> layout_description, VkRenderPass render_pass, const std::vector<VkFormat>& color_formats, VkFormat depth_format = VK_FORMAT_UNDEFINED);
 
+	// Dynamic rendering, the pipeline only depends on the attachment formats
+	static PipelineBuilder create(VkPipelineLayout pipeline_layout, std::span<const uint64_t> layout_description, const std::vector<VkFormat>& color_formats, VkFormat depth_format = VK_FORMAT_UNDEFINED);
+
+	// The module content is unknown, so builders with such stages cannot go through the PipelineStateCache
 	PipelineBuilder& add_shader_stage(VkShaderModule module, VkShaderStageFlagBits stage);
 
+	// Keeps the shared module alive and passes inline SPIR-V when the module has no handle
+	PipelineBuilder& add_shader_stage(const Shader& shader, VkShaderStageFlagBits stage);
+
+	// Defaults to Vertex::Layout
+	PipelineBuilder& set_vertex_input(std::span<const VkVertexInputBindingDescription> bindings, std::span<const VkVertexInputAttributeDescription> attributes);
+
+	template<typename V>
+	PipelineBuilder& set_vertex_layout() { return set_vertex_input(V::Layout::BINDINGS, V::Layout::ATTRIBUTES); }
+
 	PipelineBuilder& set_input_assembly(VkPrimitiveTopology topology);
 
 	PipelineBuilder& set_rasterizer();
@@ -35,7 +79,17 @@ public:
 
 	Pipeline build(Device& device);
 
-public:
+	// Covers everything that reaches vkCreateGraphicsPipelines except the debug name. Order
+	// independent state such as dynamic states and shader stages is sorted first, and state
+	// disabled by another field (blend factors without blending, compare ops without the
+	// test) is left out. Throws when a stage was added by VkShaderModule.
+	PipelineKey compute_key() const;
+
+	const std::string& get_debug_name() const { return m_debug_name; }
+
+private:
+
+	PipelineBuilder();
 
 	std::string m_debug_name;
 
@@ -47,6 +101,8 @@ public:
 
 	std::vector<VkPipelineShaderStageCreateInfo> m_shader_stages{};
 
+	std::vector<std::shared_ptr<const ShaderModule>> m_shader_modules;
+
 	VkPipelineVertexInputStateCreateInfo m_vertex_input{};
 
 	VkPipelineInputAssemblyStateCreateInfo m_input_assembly{};
@@ -69,13 +125,14 @@ public:
 
 	VkPipelineLayout m_pipeline_layout{};
 
+	std::vector<uint64_t> m_layout_description;
+
 	VkRenderPass m_render_pass{};
 
 	uint32_t m_subpass{};
 
-private:
-
-	PipelineBuilder();
+	std::vector<VkFormat> m_color_formats;
 
+	VkFormat m_depth_format = VK_FORMAT_UNDEFINED;
 };
 
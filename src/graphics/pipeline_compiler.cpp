@@ -0,0 +1,142 @@
+#include "pipeline_compiler.h"
+
+// core
+#include "core/log.h"
+#include "core/profile/profiler.h"
+
+#include "device.h"
+
+// std
+#include <algorithm>
+#include <chrono>
+
+PipelineCompiler::PipelineCompiler(Device& device, uint32_t thread_count)
+	: m_device{device}
+{
+	jinfo("pipeline compiler constructor");
+
+	if (thread_count == 0)
+	{
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	m_workers.reserve(thread_count);
+	for (uint32_t i = 0; i < thread_count; i++)
+	{
+		m_workers.emplace_back(&PipelineCompiler::worker_loop, this);
+	}
+
+	jdebug("pipeline compiler threads: {}", thread_count);
+}
+
+PipelineCompiler::~PipelineCompiler()
+{
+	jinfo("pipeline compiler destructor");
+	{
+		std::lock_guard lock{ m_mutex };
+		m_stopping = true;
+	}
+	m_condition.notify_all();
+
+	for (auto& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+std::future<Pipeline> PipelineCompiler::submit(PipelineBuilder builder)
+{
+	std::packaged_task<Pipeline()> task{ [this, builder = std::move(builder)]() mutable {
+		return builder.build(m_device);
+	} };
+	std::future<Pipeline> result = task.get_future();
+
+	{
+		std::lock_guard lock{ m_mutex };
+		m_tasks.emplace_back(std::move(task));
+	}
+	m_condition.notify_one();
+
+	return result;
+}
+
+std::shared_future<std::shared_ptr<Pipeline>> PipelineCompiler::submit_shared(PipelineBuilder builder)
+{
+	std::packaged_task<std::shared_ptr<Pipeline>()> task{ [this, builder = std::move(builder)]() mutable {
+		return std::make_shared<Pipeline>(builder.build(m_device));
+	} };
+	std::shared_future<std::shared_ptr<Pipeline>> result = task.get_future().share();
+
+	{
+		std::lock_guard lock{ m_mutex };
+		m_tasks.emplace_back(std::move(task));
+	}
+	m_condition.notify_one();
+
+	return result;
+}
+
+std::vector<std::future<Pipeline>> PipelineCompiler::submit_batch(std::vector<PipelineBuilder> builders)
+{
+	std::vector<std::future<Pipeline>> results;
+	results.reserve(builders.size());
+
+	{
+		std::lock_guard lock{ m_mutex };
+		for (auto& builder : builders)
+		{
+			std::packaged_task<Pipeline()> task{ [this, builder = std::move(builder)]() mutable {
+				return builder.build(m_device);
+			} };
+			results.push_back(task.get_future());
+			m_tasks.emplace_back(std::move(task));
+		}
+	}
+	m_condition.notify_all();
+
+	return results;
+}
+
+std::vector<Pipeline> PipelineCompiler::compile_batch(std::vector<PipelineBuilder> builders)
+{
+	jprofile("compile pipeline batch");
+	size_t count = builders.size();
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::future<Pipeline>> futures = submit_batch(std::move(builders));
+
+	std::vector<Pipeline> pipelines;
+	pipelines.reserve(count);
+	for (auto& future : futures)
+	{
+		pipelines.push_back(future.get());
+	}
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	jinfo("pipeline compiler: {} pipelines on {} threads in {:.2f} ms", count, m_workers.size(), elapsed.count());
+
+	return pipelines;
+}
+
+void PipelineCompiler::worker_loop()
+{
+	Profiler::get().set_thread_name("pipeline compiler");
+
+	while (true)
+	{
+		std::packaged_task<void()> task;
+		{
+			std::unique_lock lock{ m_mutex };
+			m_condition.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+
+			if (m_tasks.empty())
+			{
+				return;
+			}
+
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+		}
+		task();
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "pipeline_builder.h"
+#include "pipeline.h"
+
+// std
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <memory>
+
+class Device;
+
+// Compiles pipelines on a pool of worker threads. All workers share the
+// device pipeline cache, which Vulkan synchronizes internally.
+class PipelineCompiler {
+public:
+
+	// thread_count of 0 uses every hardware thread
+	PipelineCompiler(Device& device, uint32_t thread_count);
+
+	~PipelineCompiler();
+
+	PipelineCompiler(const PipelineCompiler&) = delete;
+	PipelineCompiler& operator=(const PipelineCompiler&) = delete;
+	PipelineCompiler(PipelineCompiler&&) = delete;
+	PipelineCompiler& operator=(PipelineCompiler&&) = delete;
+
+	std::future<Pipeline> submit(PipelineBuilder builder);
+
+	// For a result several threads wait on, such as a PipelineStateCache entry
+	std::shared_future<std::shared_ptr<Pipeline>> submit_shared(PipelineBuilder builder);
+
+	std::vector<std::future<Pipeline>> submit_batch(std::vector<PipelineBuilder> builders);
+
+	// Blocks until the whole batch is compiled, results keep the order of builders
+	std::vector<Pipeline> compile_batch(std::vector<PipelineBuilder> builders);
+
+	uint32_t get_thread_count() const { return static_cast<uint32_t>(m_workers.size()); }
+
+private:
+
+	void worker_loop();
+
+	Device& m_device;
+
+	std::vector<std::thread> m_workers;
+	// each wraps the packaged task whose future the submitter holds
+	std::deque<std::packaged_task<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stopping = false;
+};
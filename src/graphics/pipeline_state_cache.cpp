@@ -0,0 +1,149 @@
+#include "pipeline_state_cache.h"
+
+// core
+#include "core/log.h"
+
+#include "device.h"
+#include "pipeline_compiler.h"
+
+// std
+#include <chrono>
+
+PipelineStateCache::PipelineStateCache(Device& device)
+	: m_device{device}
+{
+}
+
+std::shared_ptr<Pipeline> PipelineStateCache::get(const PipelineBuilder& builder)
+{
+	PipelineKey key = builder.compute_key();
+
+	std::promise<std::shared_ptr<Pipeline>> promise;
+	PipelineFuture future;
+	bool compile = false;
+	{
+		std::lock_guard lock{ m_mutex };
+
+		auto [it, inserted] = m_entries.try_emplace(key);
+		if (inserted)
+		{
+			// a second caller with the same state waits on this instead of building it twice
+			it->second = promise.get_future().share();
+			compile = true;
+		}
+		future = it->second;
+	}
+
+	if (!compile)
+	{
+		try
+		{
+			std::shared_ptr<Pipeline> pipeline = future.get();
+			m_hits++;
+			return pipeline;
+		}
+		catch (...)
+		{
+			forget_failed(key);
+			throw;
+		}
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	std::shared_ptr<Pipeline> pipeline;
+	try
+	{
+		PipelineBuilder copy = builder;
+		pipeline = std::make_shared<Pipeline>(copy.build(m_device));
+	}
+	catch (...)
+	{
+		promise.set_exception(std::current_exception());
+		forget_failed(key);
+		throw;
+	}
+	promise.set_value(pipeline);
+	m_misses++;
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	jdebug("pipeline state cache: compiled '{}' ({:016x}) in {:.2f} ms", builder.get_debug_name(), key.hash, elapsed.count());
+
+	return pipeline;
+}
+
+std::shared_ptr<Pipeline> PipelineStateCache::request(const PipelineBuilder& builder, PipelineCompiler& compiler, const std::shared_ptr<Pipeline>& fallback)
+{
+	PipelineKey key = builder.compute_key();
+
+	std::lock_guard lock{ m_mutex };
+
+	auto it = m_entries.find(key);
+	if (it == m_entries.end())
+	{
+		jdebug("pipeline state cache: compiling '{}' ({:016x}) in the background", builder.get_debug_name(), key.hash);
+		m_entries.emplace(std::move(key), compiler.submit_shared(builder));
+		m_background_compiles++;
+		m_fallbacks++;
+		return fallback;
+	}
+
+	if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+	{
+		m_fallbacks++;
+		return fallback;
+	}
+
+	try
+	{
+		std::shared_ptr<Pipeline> pipeline = it->second.get();
+		m_hits++;
+		return pipeline;
+	}
+	catch (...)
+	{
+		// a failed compile rethrows once, the next request queues it again
+		m_entries.erase(it);
+		throw;
+	}
+}
+
+void PipelineStateCache::clear()
+{
+	std::unordered_map<PipelineKey, PipelineFuture, PipelineKeyHash> entries;
+	{
+		std::lock_guard lock{ m_mutex };
+		entries.swap(m_entries);
+	}
+
+	// compiles still reference the device, let them land first
+	for (auto& [key, future] : entries)
+	{
+		future.wait();
+	}
+}
+
+void PipelineStateCache::log_stats() const
+{
+	jinfo("pipeline state cache: {} hits, {} compiled in place, {} compiled in the background, {} fallbacks served",
+		m_hits.load(), m_misses.load(), m_background_compiles.load(), m_fallbacks.load());
+}
+
+void PipelineStateCache::forget_failed(const PipelineKey& key)
+{
+	std::lock_guard lock{ m_mutex };
+
+	auto it = m_entries.find(key);
+	if (it == m_entries.end() || it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+	{
+		return;
+	}
+
+	try
+	{
+		it->second.get();
+	}
+	catch (...)
+	{
+		m_entries.erase(it);
+	}
+}
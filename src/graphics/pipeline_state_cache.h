@@ -0,0 +1,61 @@
+#pragma once
+
+#include "pipeline_builder.h"
+#include "pipeline.h"
+
+// std
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+class Device;
+class PipelineCompiler;
+
+// Pipelines by PipelineKey, so requesting a state that was built before returns the same
+// pipeline instead of compiling it again. Missing permutations can compile in the background
+// while the caller keeps drawing with a fallback. Thread safe, the lock only covers the lookup,
+// compiles and waits happen outside of it.
+class PipelineStateCache {
+public:
+
+	PipelineStateCache(Device& device);
+
+	PipelineStateCache(const PipelineStateCache&) = delete;
+	PipelineStateCache& operator=(const PipelineStateCache&) = delete;
+	PipelineStateCache(PipelineStateCache&&) = delete;
+	PipelineStateCache& operator=(PipelineStateCache&&) = delete;
+
+	// Compiles on the calling thread when the state is missing, waits for it when another
+	// thread or a background compile is building the same state. A failed compile throws to
+	// every caller waiting on it and the next call retries.
+	std::shared_ptr<Pipeline> get(const PipelineBuilder& builder);
+
+	// Never compiles or waits on the calling thread. A missing state is queued on compiler
+	// once and fallback is returned until the compile has finished.
+	std::shared_ptr<Pipeline> request(const PipelineBuilder& builder, PipelineCompiler& compiler, const std::shared_ptr<Pipeline>& fallback);
+
+	// Drops every pipeline the cache owns, the device calls it before it is destroyed
+	void clear();
+
+	void log_stats() const;
+
+private:
+
+	using PipelineFuture = std::shared_future<std::shared_ptr<Pipeline>>;
+
+	// Drops the entry of key when its compile failed, so the next get or request retries
+	void forget_failed(const PipelineKey& key);
+
+	Device& m_device;
+
+	std::mutex m_mutex;
+	// ready once the in place or background compile finished
+	std::unordered_map<PipelineKey, PipelineFuture, PipelineKeyHash> m_entries;
+
+	std::atomic<uint32_t> m_hits{};
+	std::atomic<uint32_t> m_misses{};
+	std::atomic<uint32_t> m_background_compiles{};
+	std::atomic<uint32_t> m_fallbacks{};
+};
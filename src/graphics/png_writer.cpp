@@ -0,0 +1,124 @@
+#include "png_writer.h"
+
+// std
+#include <array>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+
+// largest payload of a stored deflate block
+static constexpr size_t DEFLATE_STORED_BLOCK_SIZE = 65535;
+
+static constexpr std::array<uint32_t, 256> make_crc_table()
+{
+	std::array<uint32_t, 256> table{};
+	for (uint32_t n = 0; n < 256; n++)
+	{
+		uint32_t c = n;
+		for (int k = 0; k < 8; k++)
+		{
+			c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+		}
+		table[n] = c;
+	}
+	return table;
+}
+
+static constexpr std::array<uint32_t, 256> CRC_TABLE = make_crc_table();
+
+static uint32_t update_crc(uint32_t crc, const uint8_t* data, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+	{
+		crc = CRC_TABLE[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+static void append_u32(std::vector<uint8_t>& out, uint32_t value)
+{
+	out.push_back(static_cast<uint8_t>(value >> 24));
+	out.push_back(static_cast<uint8_t>(value >> 16));
+	out.push_back(static_cast<uint8_t>(value >> 8));
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+// length, type, data, crc over type and data
+static void write_chunk(std::ofstream& file, const char type[4], const std::vector<uint8_t>& data)
+{
+	std::vector<uint8_t> chunk;
+	chunk.reserve(data.size() + 12);
+	append_u32(chunk, static_cast<uint32_t>(data.size()));
+	chunk.insert(chunk.end(), type, type + 4);
+	chunk.insert(chunk.end(), data.begin(), data.end());
+	append_u32(chunk, update_crc(0xffffffffu, chunk.data() + 4, chunk.size() - 4) ^ 0xffffffffu);
+
+	file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+}
+
+void write_png(const std::string& path, uint32_t width, uint32_t height, const uint8_t* rgba)
+{
+	std::ofstream file{ path, std::ios::binary };
+	if (!file)
+	{
+		throw std::runtime_error("failed to open " + path);
+	}
+
+	static constexpr uint8_t SIGNATURE[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	file.write(reinterpret_cast<const char*>(SIGNATURE), sizeof(SIGNATURE));
+
+	// 8 bit depth, truecolor with alpha, default compression, filter and no interlace
+	std::vector<uint8_t> header;
+	append_u32(header, width);
+	append_u32(header, height);
+	header.insert(header.end(), { 8, 6, 0, 0, 0 });
+	write_chunk(file, "IHDR", header);
+
+	// every row starts with filter type none
+	size_t row_size = size_t{ width } * 4;
+	std::vector<uint8_t> raw;
+	raw.reserve((row_size + 1) * height);
+	for (uint32_t y = 0; y < height; y++)
+	{
+		raw.push_back(0);
+		raw.insert(raw.end(), rgba + y * row_size, rgba + (y + 1) * row_size);
+	}
+
+	// zlib stream of stored blocks followed by the adler32 of the raw data
+	size_t block_count = std::max<size_t>(1, (raw.size() + DEFLATE_STORED_BLOCK_SIZE - 1) / DEFLATE_STORED_BLOCK_SIZE);
+	std::vector<uint8_t> compressed;
+	compressed.reserve(raw.size() + block_count * 5 + 6);
+	compressed.insert(compressed.end(), { 0x78, 0x01 });
+
+	uint32_t adler_a = 1;
+	uint32_t adler_b = 0;
+	for (size_t block = 0; block < block_count; block++)
+	{
+		size_t offset = block * DEFLATE_STORED_BLOCK_SIZE;
+		uint16_t size = static_cast<uint16_t>(std::min(DEFLATE_STORED_BLOCK_SIZE, raw.size() - offset));
+		bool last = block + 1 == block_count;
+
+		compressed.push_back(last ? 1 : 0);
+		compressed.insert(compressed.end(), {
+			static_cast<uint8_t>(size), static_cast<uint8_t>(size >> 8),
+			static_cast<uint8_t>(~size), static_cast<uint8_t>(~size >> 8)
+		});
+		compressed.insert(compressed.end(), raw.begin() + offset, raw.begin() + offset + size);
+
+		for (size_t i = offset; i < offset + size; i++)
+		{
+			adler_a = (adler_a + raw[i]) % 65521;
+			adler_b = (adler_b + adler_a) % 65521;
+		}
+	}
+	append_u32(compressed, (adler_b << 16) | adler_a);
+
+	write_chunk(file, "IDAT", compressed);
+	write_chunk(file, "IEND", {});
+
+	if (!file)
+	{
+		throw std::runtime_error("failed to write " + path);
+	}
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+// std
+#include <string>
+#include <cstdint>
+
+// Writes 8 bit RGBA pixels with tightly packed rows as a PNG. The image data is stored
+// uncompressed, which keeps encoding at memcpy speed for frame dumps. Throws on I/O errors.
+void write_png(const std::string& path, uint32_t width, uint32_t height, const uint8_t* rgba);
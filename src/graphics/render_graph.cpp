@@ -0,0 +1,655 @@
+#include "render_graph.h"
+
+// core
+#include "core/log.h"
+#include "core/profile/profiler.h"
+
+#include "device.h"
+#include "gpu_profiler.h"
+#include "image.h"
+#include "memory.h"
+
+// std
+#include <algorithm>
+#include <chrono>
+
+RenderGraphPass& RenderGraphPass::read(RenderResource resource, const ImageAccess& access)
+{
+	m_accesses.push_back({ resource, access, false });
+	return *this;
+}
+
+RenderGraphPass& RenderGraphPass::write(RenderResource resource, const ImageAccess& access)
+{
+	m_accesses.push_back({ resource, access, true });
+	return *this;
+}
+
+RenderGraphPass& RenderGraphPass::set_side_effects()
+{
+	m_side_effects = true;
+	return *this;
+}
+
+RenderGraphPass& RenderGraphPass::set_execute(std::function<void(VkCommandBuffer)>&& execute)
+{
+	m_execute = std::move(execute);
+	return *this;
+}
+
+RenderGraph::RenderGraph(Device& device)
+	: m_device{device}
+{
+	jinfo("render graph constructor");
+}
+
+RenderGraph::~RenderGraph()
+{
+	jinfo("render graph destructor");
+
+	RetiredRenderGraph retired;
+	for (auto& resource : m_resources)
+	{
+		if (!resource.imported && resource.image != VK_NULL_HANDLE)
+		{
+			retired.images.push_back(resource.image);
+			retired.image_views.push_back(resource.view);
+		}
+	}
+	retired.allocations = std::move(m_allocations);
+	destroy_retired(retired);
+}
+
+RenderResource RenderGraph::create_image(const std::string& name, const RenderImageDesc& desc)
+{
+	Resource resource = {
+		.name = name,
+		.format = desc.format,
+		.extent = desc.extent
+	};
+	m_resources.push_back(resource);
+	return static_cast<RenderResource>(m_resources.size() - 1);
+}
+
+RenderResource RenderGraph::import_image(const std::string& name, VkFormat format, const ImageAccess& initial, const ImageAccess& final)
+{
+	Resource resource = {
+		.name = name,
+		.format = format,
+		.extent = { 0, 0 },
+		.imported = true,
+		.initial = initial,
+		.final = final
+	};
+	m_resources.push_back(resource);
+	return static_cast<RenderResource>(m_resources.size() - 1);
+}
+
+void RenderGraph::set_imported_image(RenderResource resource, VkImage image, VkImageView view)
+{
+	m_resources[resource].image = image;
+	m_resources[resource].view = view;
+}
+
+RenderGraphPass& RenderGraph::add_pass(const std::string& name)
+{
+	RenderGraphPass& pass = m_passes.emplace_back();
+	pass.m_name = name;
+	pass.m_profile_name = Profiler::get().intern(name);
+	return pass;
+}
+
+VkExtent2D RenderGraph::get_extent(RenderResource resource) const
+{
+	const Resource& r = m_resources[resource];
+	if (r.imported || r.extent.width == 0 || r.extent.height == 0)
+	{
+		return m_reference_extent;
+	}
+	return r.extent;
+}
+
+RetiredRenderGraph RenderGraph::compile()
+{
+	auto start = std::chrono::steady_clock::now();
+
+	RetiredRenderGraph retired;
+	for (auto& resource : m_resources)
+	{
+		if (!resource.imported && resource.image != VK_NULL_HANDLE)
+		{
+			retired.images.push_back(resource.image);
+			retired.image_views.push_back(resource.view);
+			resource.image = VK_NULL_HANDLE;
+			resource.view = VK_NULL_HANDLE;
+		}
+
+		resource.usage = 0;
+		resource.first_pass = UINT32_MAX;
+		resource.last_pass = 0;
+		resource.reference_count = 0;
+		resource.memory_slot = UINT32_MAX;
+		resource.alias_predecessor = UINT32_MAX;
+	}
+	retired.allocations = std::move(m_allocations);
+	m_allocations.clear();
+
+	cull_passes();
+	compute_lifetimes();
+	allocate_transients();
+	compute_barriers();
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	jdebug("render graph: compiled {} passes in {:.3f} ms", m_passes.size(), elapsed.count());
+
+	return retired;
+}
+
+void RenderGraph::cull_passes()
+{
+	// Frostbite style culling: a pass is referenced by the images it writes, an image by the
+	// passes reading it. Imported images are read by whoever owns them.
+	std::vector<uint32_t> pass_references(m_passes.size(), 0);
+
+	for (size_t i = 0; i < m_passes.size(); i++)
+	{
+		RenderGraphPass& pass = m_passes[i];
+		pass.m_culled = false;
+
+		for (const auto& access : pass.m_accesses)
+		{
+			if (access.write)
+			{
+				pass_references[i]++;
+				continue;
+			}
+
+			// read-modify-write of the same image would keep the pass alive on its own
+			bool also_written = std::any_of(pass.m_accesses.begin(), pass.m_accesses.end(), [&](const RenderGraphPass::Access& other) {
+				return other.write && other.resource == access.resource;
+			});
+			if (!also_written)
+			{
+				m_resources[access.resource].reference_count++;
+			}
+		}
+	}
+
+	std::vector<RenderResource> unreferenced;
+	for (RenderResource r = 0; r < m_resources.size(); r++)
+	{
+		if (m_resources[r].imported)
+		{
+			m_resources[r].reference_count++;
+		}
+		else if (m_resources[r].reference_count == 0)
+		{
+			unreferenced.push_back(r);
+		}
+	}
+
+	auto cull = [&](size_t i) {
+		RenderGraphPass& pass = m_passes[i];
+		pass.m_culled = true;
+		for (const auto& access : pass.m_accesses)
+		{
+			Resource& resource = m_resources[access.resource];
+			if (!access.write && resource.reference_count > 0 && --resource.reference_count == 0 && !resource.imported)
+			{
+				unreferenced.push_back(access.resource);
+			}
+		}
+	};
+
+	for (size_t i = 0; i < m_passes.size(); i++)
+	{
+		if (pass_references[i] == 0 && !m_passes[i].m_side_effects)
+		{
+			cull(i);
+		}
+	}
+
+	while (!unreferenced.empty())
+	{
+		RenderResource r = unreferenced.back();
+		unreferenced.pop_back();
+
+		for (size_t i = 0; i < m_passes.size(); i++)
+		{
+			RenderGraphPass& pass = m_passes[i];
+			if (pass.m_culled || pass.m_side_effects)
+			{
+				continue;
+			}
+
+			for (const auto& access : pass.m_accesses)
+			{
+				if (access.write && access.resource == r && --pass_references[i] == 0)
+				{
+					cull(i);
+					break;
+				}
+			}
+		}
+	}
+
+#ifdef DEBUG
+	for (const auto& pass : m_passes)
+	{
+		if (pass.m_culled)
+		{
+			jdebug("render graph: culled pass {}", pass.m_name);
+		}
+	}
+#endif
+}
+
+void RenderGraph::compute_lifetimes()
+{
+	for (uint32_t i = 0; i < m_passes.size(); i++)
+	{
+		if (m_passes[i].m_culled)
+		{
+			continue;
+		}
+
+		for (const auto& access : m_passes[i].m_accesses)
+		{
+			Resource& resource = m_resources[access.resource];
+			resource.first_pass = std::min(resource.first_pass, i);
+			resource.last_pass = std::max(resource.last_pass, i);
+			resource.usage |= access.access.usage;
+		}
+	}
+}
+
+void RenderGraph::allocate_transients()
+{
+	VkDevice device = m_device.get_handle();
+
+	std::vector<RenderResource> transients;
+	std::vector<VkMemoryRequirements> requirements(m_resources.size());
+
+	for (RenderResource r = 0; r < m_resources.size(); r++)
+	{
+		Resource& resource = m_resources[r];
+		if (resource.imported || resource.first_pass == UINT32_MAX)
+		{
+			continue;
+		}
+
+		VkExtent2D extent = get_extent(r);
+		VkImageCreateInfo image_create_info = {
+			.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+			.imageType = VK_IMAGE_TYPE_2D,
+			.format = resource.format,
+			.extent = { extent.width, extent.height, 1 },
+			.mipLevels = 1,
+			.arrayLayers = 1,
+			.samples = VK_SAMPLE_COUNT_1_BIT,
+			.tiling = VK_IMAGE_TILING_OPTIMAL,
+			.usage = resource.usage,
+			.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+		};
+		VK_CHECK(vkCreateImage(device, &image_create_info, nullptr, &resource.image));
+		vkGetImageMemoryRequirements(device, resource.image, &requirements[r]);
+
+		transients.push_back(r);
+	}
+
+	// biggest images first so the smaller ones fill the gaps they leave
+	std::sort(transients.begin(), transients.end(), [&](RenderResource a, RenderResource b) {
+		return requirements[a].size > requirements[b].size;
+	});
+
+	struct MemorySlot {
+		VkMemoryRequirements requirements;
+		std::vector<RenderResource> occupants;
+	};
+	std::vector<MemorySlot> slots;
+
+	for (RenderResource r : transients)
+	{
+		Resource& resource = m_resources[r];
+
+		for (uint32_t s = 0; s < slots.size() && resource.memory_slot == UINT32_MAX; s++)
+		{
+			MemorySlot& slot = slots[s];
+			if ((slot.requirements.memoryTypeBits & requirements[r].memoryTypeBits) == 0)
+			{
+				continue;
+			}
+
+			bool overlaps = std::any_of(slot.occupants.begin(), slot.occupants.end(), [&](RenderResource other) {
+				return resource.first_pass <= m_resources[other].last_pass && m_resources[other].first_pass <= resource.last_pass;
+			});
+			if (overlaps)
+			{
+				continue;
+			}
+
+			slot.requirements.size = std::max(slot.requirements.size, requirements[r].size);
+			slot.requirements.alignment = std::max(slot.requirements.alignment, requirements[r].alignment);
+			slot.requirements.memoryTypeBits &= requirements[r].memoryTypeBits;
+			slot.occupants.push_back(r);
+			resource.memory_slot = s;
+		}
+
+		if (resource.memory_slot == UINT32_MAX)
+		{
+			resource.memory_slot = static_cast<uint32_t>(slots.size());
+			slots.push_back({ requirements[r], { r } });
+		}
+	}
+
+	VmaAllocationCreateInfo allocation_create_info = make_allocation_create_info(MemoryUsage::DeviceLocal);
+	VkDeviceSize requested = 0;
+	VkDeviceSize allocated = 0;
+
+	for (auto& slot : slots)
+	{
+		// occupants in execution order, each one inherits the memory from the one before it
+		// and the first one from the last, which was used by the previous frame
+		std::sort(slot.occupants.begin(), slot.occupants.end(), [&](RenderResource a, RenderResource b) {
+			return m_resources[a].first_pass < m_resources[b].first_pass;
+		});
+		for (size_t i = 0; i < slot.occupants.size(); i++)
+		{
+			size_t previous = (i + slot.occupants.size() - 1) % slot.occupants.size();
+			m_resources[slot.occupants[i]].alias_predecessor = slot.occupants[previous];
+		}
+
+		VmaAllocation allocation;
+		VK_CHECK(vmaAllocateMemory(m_device.get_allocator(), &slot.requirements, &allocation_create_info, &allocation, nullptr));
+		m_allocations.push_back(allocation);
+		allocated += slot.requirements.size;
+
+		for (RenderResource r : slot.occupants)
+		{
+			Resource& resource = m_resources[r];
+			requested += requirements[r].size;
+
+			VK_CHECK(vmaBindImageMemory(m_device.get_allocator(), allocation, resource.image));
+
+			VkImageViewCreateInfo image_view_create_info = {
+				.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+				.image = resource.image,
+				.viewType = VK_IMAGE_VIEW_TYPE_2D,
+				.format = resource.format,
+				.components = {
+					VK_COMPONENT_SWIZZLE_IDENTITY,
+					VK_COMPONENT_SWIZZLE_IDENTITY,
+					VK_COMPONENT_SWIZZLE_IDENTITY,
+					VK_COMPONENT_SWIZZLE_IDENTITY
+				},
+				.subresourceRange = {
+					.aspectMask = get_format_aspect(resource.format),
+					.baseMipLevel = 0,
+					.levelCount = 1,
+					.baseArrayLayer = 0,
+					.layerCount = 1
+				}
+			};
+			VK_CHECK(vkCreateImageView(device, &image_view_create_info, nullptr, &resource.view));
+		}
+	}
+
+	if (!transients.empty())
+	{
+		jdebug("render graph: {} transient images in {} allocations, {} KiB instead of {} KiB",
+			transients.size(), slots.size(), allocated / 1024, requested / 1024);
+	}
+}
+
+bool RenderGraph::transition(ResourceState& state, const ImageAccess& access, bool write, VkImageMemoryBarrier2& barrier)
+{
+	bool layout_change = state.layout != access.layout;
+
+	if (!write && !layout_change)
+	{
+		// read after read in the same layout, only the first reader of each stage has to wait
+		if ((state.read_stages & access.stages) == access.stages && (state.read_access & access.access) == access.access)
+		{
+			return false;
+		}
+
+		bool needs_barrier = state.write_stages != VK_PIPELINE_STAGE_2_NONE;
+		barrier.srcStageMask = state.write_stages;
+		barrier.srcAccessMask = state.write_access;
+		barrier.dstStageMask = access.stages;
+		barrier.dstAccessMask = access.access;
+		barrier.oldLayout = state.layout;
+		barrier.newLayout = access.layout;
+
+		state.read_stages |= access.stages;
+		state.read_access |= access.access;
+		return needs_barrier;
+	}
+
+	// writes and layout transitions wait for the last write and every read since (write after read
+	// only needs the execution dependency, reads have nothing to make available)
+	VkPipelineStageFlags2 src_stages = state.write_stages | state.read_stages;
+	barrier.srcStageMask = src_stages;
+	barrier.srcAccessMask = state.write_access;
+	barrier.dstStageMask = access.stages;
+	barrier.dstAccessMask = access.access;
+	barrier.oldLayout = state.layout;
+	barrier.newLayout = access.layout;
+
+	bool needs_barrier = layout_change || src_stages != VK_PIPELINE_STAGE_2_NONE;
+
+	// a layout transition is a write that completes before the destination stages
+	state.write_stages = access.stages;
+	state.write_access = write ? access.access : VK_ACCESS_2_NONE;
+	state.read_stages = write ? VK_PIPELINE_STAGE_2_NONE : access.stages;
+	state.read_access = write ? VK_ACCESS_2_NONE : access.access;
+	state.layout = access.layout;
+
+	return needs_barrier;
+}
+
+RenderGraph::ResourceState RenderGraph::initial_state(const Resource& resource, const std::vector<ResourceState>& previous_frame) const
+{
+	ResourceState state{};
+
+	if (resource.imported)
+	{
+		state.write_stages = resource.initial.stages;
+		state.write_access = resource.initial.access;
+		state.layout = resource.initial.layout;
+		return state;
+	}
+
+	// transient contents never survive, but the memory may still be in use by the previous occupant
+	if (resource.alias_predecessor != UINT32_MAX && !previous_frame.empty())
+	{
+		const ResourceState& previous = previous_frame[resource.alias_predecessor];
+		state.write_stages = previous.write_stages | previous.read_stages;
+		state.write_access = previous.write_access;
+	}
+	else
+	{
+		state.write_stages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+		state.write_access = VK_ACCESS_2_MEMORY_WRITE_BIT;
+	}
+	state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	return state;
+}
+
+void RenderGraph::compute_barriers()
+{
+	// Barriers at the start of a frame depend on the state transients are left in at the end of
+	// the previous one, so walk the frame once to learn the end states and then for real.
+	std::vector<ResourceState> final_states;
+
+	for (int iteration = 0; iteration < 2; iteration++)
+	{
+		std::vector<ResourceState> states(m_resources.size());
+		std::vector<bool> touched(m_resources.size(), false);
+
+		for (auto& pass : m_passes)
+		{
+			pass.m_barriers.clear();
+			pass.m_barrier_resources.clear();
+
+			if (pass.m_culled)
+			{
+				continue;
+			}
+
+			for (const auto& access : pass.m_accesses)
+			{
+				Resource& resource = m_resources[access.resource];
+				ResourceState& state = states[access.resource];
+
+				if (!touched[access.resource])
+				{
+					touched[access.resource] = true;
+					state = initial_state(resource, final_states);
+				}
+
+				VkImageMemoryBarrier2 barrier = {
+					.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+					.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.subresourceRange = {
+						.aspectMask = get_format_aspect(resource.format),
+						.baseMipLevel = 0,
+						.levelCount = 1,
+						.baseArrayLayer = 0,
+						.layerCount = 1
+					}
+				};
+
+				if (!transition(state, access.access, access.write, barrier))
+				{
+					continue;
+				}
+
+				// merge with a barrier already emitted for the same image in this pass
+				auto existing = std::find(pass.m_barrier_resources.begin(), pass.m_barrier_resources.end(), access.resource);
+				if (existing != pass.m_barrier_resources.end())
+				{
+					VkImageMemoryBarrier2& merged = pass.m_barriers[existing - pass.m_barrier_resources.begin()];
+					merged.dstStageMask |= barrier.dstStageMask;
+					merged.dstAccessMask |= barrier.dstAccessMask;
+					merged.newLayout = barrier.newLayout;
+					continue;
+				}
+
+				pass.m_barriers.push_back(barrier);
+				pass.m_barrier_resources.push_back(access.resource);
+			}
+		}
+
+		m_final_barriers.clear();
+		m_final_barrier_resources.clear();
+		for (RenderResource r = 0; r < m_resources.size(); r++)
+		{
+			Resource& resource = m_resources[r];
+			if (!resource.imported)
+			{
+				continue;
+			}
+
+			ResourceState& state = states[r];
+			if (!touched[r])
+			{
+				state = initial_state(resource, final_states);
+			}
+
+			VkImageMemoryBarrier2 barrier = {
+				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+				.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.subresourceRange = {
+					.aspectMask = get_format_aspect(resource.format),
+					.baseMipLevel = 0,
+					.levelCount = 1,
+					.baseArrayLayer = 0,
+					.layerCount = 1
+				}
+			};
+			if (transition(state, resource.final, false, barrier))
+			{
+				m_final_barriers.push_back(barrier);
+				m_final_barrier_resources.push_back(r);
+			}
+		}
+
+		final_states = std::move(states);
+	}
+
+#ifdef DEBUG
+	size_t barrier_count = m_final_barriers.size();
+	for (const auto& pass : m_passes)
+	{
+		barrier_count += pass.m_barriers.size();
+	}
+	jdebug("render graph: {} image barriers per frame", barrier_count);
+#endif
+}
+
+void RenderGraph::execute(VkCommandBuffer cmd, GpuProfiler* gpu_profiler)
+{
+	auto record_barriers = [&](std::vector<VkImageMemoryBarrier2>& barriers, const std::vector<RenderResource>& resources) {
+		if (barriers.empty())
+		{
+			return;
+		}
+
+		for (size_t i = 0; i < barriers.size(); i++)
+		{
+			barriers[i].image = m_resources[resources[i]].image;
+		}
+
+		VkDependencyInfo dependency_info = {
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size()),
+			.pImageMemoryBarriers = barriers.data()
+		};
+		vkCmdPipelineBarrier2(cmd, &dependency_info);
+	};
+
+	for (auto& pass : m_passes)
+	{
+		if (pass.m_culled)
+		{
+			continue;
+		}
+
+		// the zone covers the pass's barriers, which is where waits on earlier passes show up
+		uint32_t gpu_zone = gpu_profiler ? gpu_profiler->begin_zone(cmd, pass.m_profile_name) : GpuProfiler::NO_ZONE;
+		record_barriers(pass.m_barriers, pass.m_barrier_resources);
+
+		if (pass.m_execute)
+		{
+			jprofile(pass.m_profile_name);
+			pass.m_execute(cmd);
+		}
+
+		if (gpu_profiler)
+		{
+			gpu_profiler->end_zone(cmd, gpu_zone);
+		}
+	}
+
+	record_barriers(m_final_barriers, m_final_barrier_resources);
+}
+
+void RenderGraph::destroy_retired(const RetiredRenderGraph& retired)
+{
+	for (auto image_view : retired.image_views)
+	{
+		vkDestroyImageView(m_device.get_handle(), image_view, nullptr);
+	}
+	for (auto image : retired.images)
+	{
+		vkDestroyImage(m_device.get_handle(), image, nullptr);
+	}
+	for (auto allocation : retired.allocations)
+	{
+		vmaFreeMemory(m_device.get_allocator(), allocation);
+	}
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+// lib
+#include <vulkan/vulkan.h>
+#include <vma/vk_mem_alloc.h>
+
+// std
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+class Device;
+class GpuProfiler;
+
+using RenderResource = uint32_t;
+
+// How a pass touches an image, the usage flags are added to transient images automatically
+struct ImageAccess {
+	VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_NONE;
+	VkAccessFlags2 access = VK_ACCESS_2_NONE;
+	VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	VkImageUsageFlags usage = 0;
+};
+
+inline constexpr ImageAccess ACCESS_NONE = {};
+
+inline constexpr ImageAccess ACCESS_COLOR_ATTACHMENT_WRITE = {
+	VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+	VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+	VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+	VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+};
+
+inline constexpr ImageAccess ACCESS_DEPTH_ATTACHMENT_WRITE = {
+	VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+	VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+	VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+	VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT
+};
+
+inline constexpr ImageAccess ACCESS_FRAGMENT_SAMPLED = {
+	VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+	VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+	VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	VK_IMAGE_USAGE_SAMPLED_BIT
+};
+
+inline constexpr ImageAccess ACCESS_COMPUTE_SAMPLED = {
+	VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+	VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+	VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	VK_IMAGE_USAGE_SAMPLED_BIT
+};
+
+inline constexpr ImageAccess ACCESS_COMPUTE_STORAGE_WRITE = {
+	VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+	VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+	VK_IMAGE_LAYOUT_GENERAL,
+	VK_IMAGE_USAGE_STORAGE_BIT
+};
+
+inline constexpr ImageAccess ACCESS_TRANSFER_SRC = {
+	VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+	VK_ACCESS_2_TRANSFER_READ_BIT,
+	VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+	VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+};
+
+inline constexpr ImageAccess ACCESS_TRANSFER_DST = {
+	VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+	VK_ACCESS_2_TRANSFER_WRITE_BIT,
+	VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+	VK_IMAGE_USAGE_TRANSFER_DST_BIT
+};
+
+// Handed over to the presentation engine, the semaphore signal makes the writes visible
+inline constexpr ImageAccess ACCESS_PRESENT = {
+	VK_PIPELINE_STAGE_2_NONE,
+	VK_ACCESS_2_NONE,
+	VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+	0
+};
+
+struct RenderImageDesc {
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	// {0, 0} follows the reference extent of the graph, usually the swapchain
+	VkExtent2D extent = { 0, 0 };
+};
+
+// Transient images of a previous compile, destroyed once no frame in flight uses them
+struct RetiredRenderGraph {
+	std::vector<VkImage> images;
+	std::vector<VkImageView> image_views;
+	std::vector<VmaAllocation> allocations;
+};
+
+class RenderGraphPass {
+public:
+
+	RenderGraphPass& read(RenderResource resource, const ImageAccess& access);
+	RenderGraphPass& write(RenderResource resource, const ImageAccess& access);
+
+	// Keeps the pass even when nothing reads what it writes
+	RenderGraphPass& set_side_effects();
+
+	RenderGraphPass& set_execute(std::function<void(VkCommandBuffer)>&& execute);
+
+	const std::string& get_name() const { return m_name; }
+
+private:
+
+	friend class RenderGraph;
+
+	struct Access {
+		RenderResource resource;
+		ImageAccess access;
+		bool write;
+	};
+
+	std::string m_name;
+	// interned m_name, the zone of the pass in profiler traces
+	const char* m_profile_name = nullptr;
+	std::vector<Access> m_accesses;
+	std::function<void(VkCommandBuffer)> m_execute;
+	bool m_side_effects = false;
+	bool m_culled = false;
+
+	// barriers recorded before the pass, image handles are filled in at execute time
+	std::vector<VkImageMemoryBarrier2> m_barriers;
+	std::vector<RenderResource> m_barrier_resources;
+};
+
+// Declarative frame graph. Passes declare the images they read and write in submission
+// order; compile culls passes nothing depends on, derives the synchronization2 barriers
+// between the remaining ones and places transient images whose lifetimes don't overlap
+// in the same memory.
+class RenderGraph {
+public:
+
+	RenderGraph(Device& device);
+
+	~RenderGraph();
+
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph& operator=(const RenderGraph&) = delete;
+	RenderGraph(RenderGraph&&) = delete;
+	RenderGraph& operator=(RenderGraph&&) = delete;
+
+	// Image owned by the graph, only valid between its first and last use in a frame
+	RenderResource create_image(const std::string& name, const RenderImageDesc& desc);
+
+	// Image owned elsewhere, it enters the frame in initial and has to leave it in final
+	RenderResource import_image(const std::string& name, VkFormat format, const ImageAccess& initial, const ImageAccess& final);
+
+	// Rebinds an imported image, e.g. to the acquired swapchain image
+	void set_imported_image(RenderResource resource, VkImage image, VkImageView view);
+
+	RenderGraphPass& add_pass(const std::string& name);
+
+	// Drops every pass, resources stay declared. Compile again before the next execute.
+	void clear_passes() { m_passes.clear(); }
+
+	void set_reference_extent(VkExtent2D extent) { m_reference_extent = extent; }
+
+	// (Re)builds barriers and transient images, the previous transients are returned so the
+	// caller can destroy them once the frames using them have retired
+	RetiredRenderGraph compile();
+
+	// Each pass is a GPU zone of gpu_profiler when given
+	void execute(VkCommandBuffer cmd, GpuProfiler* gpu_profiler = nullptr);
+
+	void destroy_retired(const RetiredRenderGraph& retired);
+
+	VkImage get_image(RenderResource resource) const { return m_resources[resource].image; }
+	VkImageView get_view(RenderResource resource) const { return m_resources[resource].view; }
+	VkExtent2D get_extent(RenderResource resource) const;
+	VkFormat get_format(RenderResource resource) const { return m_resources[resource].format; }
+
+private:
+
+	struct Resource {
+		std::string name;
+		VkFormat format;
+		VkExtent2D extent;
+		VkImageUsageFlags usage = 0;
+		bool imported = false;
+		ImageAccess initial;
+		ImageAccess final;
+
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+
+		// compile state
+		uint32_t first_pass = UINT32_MAX;
+		uint32_t last_pass = 0;
+		uint32_t reference_count = 0;
+		uint32_t memory_slot = UINT32_MAX;
+		// transient that previously occupied the same memory, UINT32_MAX if none
+		uint32_t alias_predecessor = UINT32_MAX;
+	};
+
+	// Last write and the reads since, enough to build the next barrier
+	struct ResourceState {
+		VkPipelineStageFlags2 write_stages = VK_PIPELINE_STAGE_2_NONE;
+		VkAccessFlags2 write_access = VK_ACCESS_2_NONE;
+		VkPipelineStageFlags2 read_stages = VK_PIPELINE_STAGE_2_NONE;
+		VkAccessFlags2 read_access = VK_ACCESS_2_NONE;
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	};
+
+	void cull_passes();
+	void compute_lifetimes();
+	void allocate_transients();
+	void compute_barriers();
+	bool transition(ResourceState& state, const ImageAccess& access, bool write, VkImageMemoryBarrier2& barrier);
+	ResourceState initial_state(const Resource& resource, const std::vector<ResourceState>& previous_frame) const;
+
+	Device& m_device;
+
+	std::vector<Resource> m_resources;
+	std::deque<RenderGraphPass> m_passes;
+	VkExtent2D m_reference_extent = { 0, 0 };
+
+	std::vector<VmaAllocation> m_allocations;
+
+	std::vector<VkImageMemoryBarrier2> m_final_barriers;
+	std::vector<RenderResource> m_final_barrier_resources;
+};
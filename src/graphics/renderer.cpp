@@ -2,19 +2,44 @@
 
 // core
 #include "core/log.h"
+#include "core/profile/profiler.h"
+#include "core/config/config.h"
+#include "core/jobs/job_system.h"
 
-Renderer::Renderer(Config& config, Window& window)
+#include "window/window.h"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+
+Renderer::Renderer(const Config& config, Window& window, JobSystem& job_system)
 	: m_config{config}
 	, m_window{window}
+	, m_job_system{job_system}
 {
 	jinfo("renderer constructor");
 	create_pipeline_layout();
-	create_render_pass();
+
+	// dynamic rendering needs neither render pass nor framebuffer objects
+	if (!m_device.is_dynamic_rendering_enabled())
+	{
+		create_render_pass();
+	}
+	create_framebuffers();
+	create_frames(m_config.get_frames_in_flight());
+	create_render_graph();
+
+	// the first latency report covers the frames since startup
+	m_latency_report_start = std::chrono::steady_clock::now();
 }
 
 Renderer::~Renderer()
 {
 	jinfo("renderer destructor");
+	flush_readbacks();
+	collect_retired(true);
+	destroy_frames();
+	destroy_framebuffers();
 	vkDestroyPipelineLayout(m_device.get_handle(), m_pipeline_layout, nullptr);
 	vkDestroyRenderPass(m_device.get_handle(), m_render_pass, nullptr);
 }
@@ -28,8 +53,9 @@ void Renderer::create_render_pass()
 	color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 	color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	// the render graph transitions the image around the pass and provides the dependencies
+	color_attachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	color_attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
 	VkAttachmentReference color_attachment_ref = {};
 	color_attachment_ref.attachment = 0;
@@ -40,14 +66,6 @@ void Renderer::create_render_pass()
 	subpass.colorAttachmentCount = 1;
 	subpass.pColorAttachments = &color_attachment_ref;
 
-	VkSubpassDependency dependency = {};
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.srcAccessMask = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	dependency.dstSubpass = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
 	std::vector<VkAttachmentDescription> attachments = { color_attachment };
 	VkRenderPassCreateInfo renderPassInfo = {};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -55,15 +73,777 @@ void Renderer::create_render_pass()
 	renderPassInfo.pAttachments = attachments.data();
 	renderPassInfo.subpassCount = 1;
 	renderPassInfo.pSubpasses = &subpass;
-	renderPassInfo.dependencyCount = 1;
-	renderPassInfo.pDependencies = &dependency;
 
 	VK_CHECK(vkCreateRenderPass(m_device.get_handle(), &renderPassInfo, nullptr, &m_render_pass));
 }
 
 void Renderer::create_pipeline_layout()
 {
-	VkPipelineLayoutCreateInfo pipeline_layout_create_info{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+	// every pipeline shares the bindless heap layout, per draw data travels in push constants
+	VkDescriptorSetLayout descriptor_set_layout = m_descriptor_heap.get_layout();
+	VkPushConstantRange push_constant_range = {
+		.stageFlags = VK_SHADER_STAGE_ALL,
+		.offset = 0,
+		.size = BINDLESS_PUSH_CONSTANT_SIZE
+	};
+
+	VkPipelineLayoutCreateInfo pipeline_layout_create_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.setLayoutCount = 1,
+		.pSetLayouts = &descriptor_set_layout,
+		.pushConstantRangeCount = 1,
+		.pPushConstantRanges = &push_constant_range
+	};
 
 	VK_CHECK(vkCreatePipelineLayout(m_device.get_handle(), &pipeline_layout_create_info, nullptr, &m_pipeline_layout));
+
+	const DescriptorHeapCapacity& capacity = m_descriptor_heap.get_capacity();
+	m_pipeline_layout_description = {
+		capacity.sampled_images,
+		capacity.samplers,
+		capacity.storage_buffers,
+		push_constant_range.stageFlags,
+		push_constant_range.offset,
+		push_constant_range.size
+	};
+}
+
+void Renderer::create_framebuffers()
+{
+	const std::vector<VkImageView>& image_views = m_swapchain.get_image_views();
+	VkExtent2D extent = m_swapchain.get_extent();
+
+	m_framebuffers.resize(m_render_pass != VK_NULL_HANDLE ? image_views.size() : 0);
+	for (size_t i = 0; i < m_framebuffers.size(); i++)
+	{
+		VkFramebufferCreateInfo framebuffer_create_info = {
+			.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+			.renderPass = m_render_pass,
+			.attachmentCount = 1,
+			.pAttachments = &image_views[i],
+			.width = extent.width,
+			.height = extent.height,
+			.layers = 1
+		};
+		VK_CHECK(vkCreateFramebuffer(m_device.get_handle(), &framebuffer_create_info, nullptr, &m_framebuffers[i]));
+	}
+
+	VkSemaphoreCreateInfo semaphore_create_info = { .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+	m_render_finished.resize(image_views.size());
+	for (auto& semaphore : m_render_finished)
+	{
+		VK_CHECK(vkCreateSemaphore(m_device.get_handle(), &semaphore_create_info, nullptr, &semaphore));
+	}
+}
+
+void Renderer::destroy_framebuffers()
+{
+	for (auto framebuffer : m_framebuffers)
+	{
+		vkDestroyFramebuffer(m_device.get_handle(), framebuffer, nullptr);
+	}
+	m_framebuffers.clear();
+
+	for (auto semaphore : m_render_finished)
+	{
+		vkDestroySemaphore(m_device.get_handle(), semaphore, nullptr);
+	}
+	m_render_finished.clear();
+}
+
+void Renderer::create_frames(uint32_t frames_in_flight)
+{
+	frames_in_flight = std::max(1u, frames_in_flight);
+	jdebug("frames in flight: {}", frames_in_flight);
+
+	QueueFamilyIndices indices = m_device.find_queue_families();
+
+	m_frames.resize(frames_in_flight);
+	for (auto& frame : m_frames)
+	{
+		// buffers are never freed individually, the whole pool is reset once per frame
+		VkCommandPoolCreateInfo command_pool_create_info = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+			.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+			.queueFamilyIndex = indices.graphics_family.value()
+		};
+		VK_CHECK(vkCreateCommandPool(m_device.get_handle(), &command_pool_create_info, nullptr, &frame.command_pool));
+
+		VkCommandBufferAllocateInfo command_buffer_allocate_info = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = frame.command_pool,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1
+		};
+		VK_CHECK(vkAllocateCommandBuffers(m_device.get_handle(), &command_buffer_allocate_info, &frame.command_buffer));
+
+		// one pool per job worker, command pools must not be used from two threads at once
+		frame.worker_commands.resize(m_job_system.get_worker_count());
+		for (auto& worker_commands : frame.worker_commands)
+		{
+			VK_CHECK(vkCreateCommandPool(m_device.get_handle(), &command_pool_create_info, nullptr, &worker_commands.command_pool));
+		}
+
+		VkSemaphoreCreateInfo semaphore_create_info = { .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+		VK_CHECK(vkCreateSemaphore(m_device.get_handle(), &semaphore_create_info, nullptr, &frame.image_available));
+
+		// created signaled so the first wait on each slot returns immediately
+		VkFenceCreateInfo fence_create_info = {
+			.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+			.flags = VK_FENCE_CREATE_SIGNALED_BIT
+		};
+		VK_CHECK(vkCreateFence(m_device.get_handle(), &fence_create_info, nullptr, &frame.in_flight));
+	}
+}
+
+void Renderer::create_render_graph()
+{
+	// the acquire semaphore is waited at color attachment output, the first write waits on that stage
+	ImageAccess acquired = {
+		.stages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+		.access = VK_ACCESS_2_NONE,
+		.layout = VK_IMAGE_LAYOUT_UNDEFINED
+	};
+	// offscreen images are left ready for the readback copy instead of presentation
+	ImageAccess final_access = m_device.is_headless() ? ACCESS_TRANSFER_SRC : ACCESS_PRESENT;
+	m_backbuffer = m_render_graph.import_image("backbuffer", m_swapchain.get_image_format(), acquired, final_access);
+	m_render_graph.set_reference_extent(m_swapchain.get_extent());
+}
+
+void Renderer::compile_render_graph()
+{
+	jprofile("compile render graph");
+	m_render_graph.set_reference_extent(m_swapchain.get_extent());
+
+	RetiredRenderGraph retired = m_render_graph.compile();
+	defer_destroy([this, retired = std::move(retired)]() {
+		m_render_graph.destroy_retired(retired);
+	});
+}
+
+void Renderer::execute_render_graph(VkCommandBuffer cmd)
+{
+	m_render_graph.set_imported_image(m_backbuffer, m_swapchain.get_images()[m_image_index], m_swapchain.get_image_views()[m_image_index]);
+	m_render_graph.execute(cmd, &m_gpu_profiler);
+}
+
+void Renderer::destroy_frames()
+{
+	for (auto& frame : m_frames)
+	{
+		vkDestroyFence(m_device.get_handle(), frame.in_flight, nullptr);
+		vkDestroySemaphore(m_device.get_handle(), frame.image_available, nullptr);
+		vkDestroyCommandPool(m_device.get_handle(), frame.command_pool, nullptr);
+		for (auto& worker_commands : frame.worker_commands)
+		{
+			vkDestroyCommandPool(m_device.get_handle(), worker_commands.command_pool, nullptr);
+		}
+	}
+	m_frames.clear();
+}
+
+void Renderer::set_frames_in_flight(uint32_t frames_in_flight)
+{
+	if (std::max(1u, frames_in_flight) == m_frames.size())
+	{
+		return;
+	}
+
+	// every slot is replaced, nothing recorded from the old ones may still be executing
+	flush_readbacks();
+	collect_retired(true);
+	destroy_frames();
+	create_frames(frames_in_flight);
+	m_gpu_profiler.set_frames_in_flight(frames_in_flight);
+	m_frame_index = 0;
+
+	// offscreen images are indexed by frame slot, there must be one per slot
+	if (m_device.is_headless())
+	{
+		m_swapchain.set_offscreen_image_count(static_cast<uint32_t>(m_frames.size()));
+		m_swapchain_dirty = true;
+	}
+}
+
+VkCommandBuffer Renderer::begin_frame()
+{
+	FrameData& frame = m_frames[m_frame_index];
+
+	// the GPU is done with this slot once its fence signals, other slots may still be executing
+	{
+		jprofile("wait for frame slot");
+		VK_CHECK(vkWaitForFences(m_device.get_handle(), 1, &frame.in_flight, VK_TRUE, UINT64_MAX));
+	}
+	collect_retired(false);
+	m_uploader.collect();
+	collect_readback(frame);
+
+	if (m_window.resized())
+	{
+		m_window.clear_resized();
+		m_swapchain_dirty = true;
+	}
+
+	if (m_swapchain_dirty)
+	{
+		int width, height;
+		m_window.get_drawable_size(width, height);
+		if (width == 0 || height == 0)
+		{
+			// minimized, nothing to present to
+			return VK_NULL_HANDLE;
+		}
+		recreate_swapchain();
+	}
+
+	m_acquire_start = std::chrono::steady_clock::now();
+	if (m_device.is_headless())
+	{
+		// each slot renders to its own offscreen image, the slot's fence already guards it
+		m_image_index = m_frame_index;
+	}
+	else
+	{
+		jprofile("acquire");
+		VkResult result = m_swapchain.acquire_next_image(frame.image_available, m_image_index);
+		if (result == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			m_swapchain_dirty = true;
+			return VK_NULL_HANDLE;
+		}
+		VK_CHECK(result);
+	}
+
+	// only reset once we know work will be submitted, otherwise the next wait would deadlock
+	VK_CHECK(vkResetFences(m_device.get_handle(), 1, &frame.in_flight));
+	VK_CHECK(vkResetCommandPool(m_device.get_handle(), frame.command_pool, 0));
+	for (auto& worker_commands : frame.worker_commands)
+	{
+		if (worker_commands.used > 0)
+		{
+			VK_CHECK(vkResetCommandPool(m_device.get_handle(), worker_commands.command_pool, 0));
+			worker_commands.used = 0;
+		}
+	}
+
+	VkCommandBufferBeginInfo command_buffer_begin_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+	};
+	VK_CHECK(vkBeginCommandBuffer(frame.command_buffer, &command_buffer_begin_info));
+	m_gpu_profiler.begin_frame(frame.command_buffer, m_frame_index, m_frame_count);
+
+	return frame.command_buffer;
+}
+
+void Renderer::end_frame()
+{
+	FrameData& frame = m_frames[m_frame_index];
+	VkSemaphore render_finished = m_render_finished[m_image_index];
+	bool headless = m_device.is_headless();
+
+	if (m_readback_request)
+	{
+		record_readback(frame);
+		frame.readback = std::move(m_readback_request);
+		m_readback_request = nullptr;
+	}
+
+	m_gpu_profiler.end_frame(frame.command_buffer);
+	VK_CHECK(vkEndCommandBuffer(frame.command_buffer));
+
+	// the binary acquire semaphore ignores its value, the upload timeline waits for the requested ticket.
+	// Offscreen frames acquire nothing and only wait for uploads.
+	VkSemaphore wait_semaphores[] = { frame.image_available, m_uploader.get_timeline() };
+	VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, m_upload_wait_stages };
+	uint64_t wait_values[] = { 0, m_upload_wait_ticket };
+	uint32_t first_wait = headless ? 1 : 0;
+	uint32_t wait_count = (m_upload_wait_ticket ? 2 : 1) - first_wait;
+
+	VkTimelineSemaphoreSubmitInfo timeline_submit_info = {
+		.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+		.waitSemaphoreValueCount = wait_count,
+		.pWaitSemaphoreValues = wait_values + first_wait
+	};
+
+	VkSubmitInfo submit_info = {
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.pNext = &timeline_submit_info,
+		.waitSemaphoreCount = wait_count,
+		.pWaitSemaphores = wait_semaphores + first_wait,
+		.pWaitDstStageMask = wait_stages + first_wait,
+		.commandBufferCount = 1,
+		.pCommandBuffers = &frame.command_buffer,
+		.signalSemaphoreCount = headless ? 0u : 1u,
+		.pSignalSemaphores = &render_finished
+	};
+	{
+		jprofile("submit");
+		VK_CHECK(vkQueueSubmit(m_device.get_graphics_queue(), 1, &submit_info, frame.in_flight));
+	}
+	m_upload_wait_ticket = 0;
+	m_upload_wait_stages = 0;
+
+	if (!headless)
+	{
+		jprofile("present");
+		VkResult result = m_swapchain.present(m_device.get_present_queue(), render_finished, m_image_index);
+		record_present_latency();
+		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+		{
+			m_swapchain_dirty = true;
+		}
+		else
+		{
+			VK_CHECK(result);
+
+			if (m_measure_resize)
+			{
+				m_measure_resize = false;
+				std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - m_resize_start;
+				jinfo("swapchain: first present {:.2f} ms after resize", elapsed.count());
+			}
+		}
+	}
+
+	m_frame_count++;
+	m_frame_index = (m_frame_index + 1) % static_cast<uint32_t>(m_frames.size());
+}
+
+void Renderer::begin_main_pass(VkCommandBuffer cmd, VkSubpassContents contents)
+{
+	VkExtent2D extent = m_swapchain.get_extent();
+	VkClearValue clear_value = { .color = { { 0.0f, 0.0f, 0.0f, 1.0f } } };
+
+	if (m_render_pass == VK_NULL_HANDLE)
+	{
+		VkRenderingAttachmentInfo color_attachment = {
+			.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+			.imageView = m_swapchain.get_image_views()[m_image_index],
+			.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+			.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+			.clearValue = clear_value
+		};
+		VkRenderingInfo rendering_info = {
+			.sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+			.flags = contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0u,
+			.renderArea = { { 0, 0 }, extent },
+			.layerCount = 1,
+			.colorAttachmentCount = 1,
+			.pColorAttachments = &color_attachment
+		};
+		vkCmdBeginRendering(cmd, &rendering_info);
+	}
+	else
+	{
+		VkRenderPassBeginInfo render_pass_begin_info = {
+			.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+			.renderPass = m_render_pass,
+			.framebuffer = m_framebuffers[m_image_index],
+			.renderArea = { { 0, 0 }, extent },
+			.clearValueCount = 1,
+			.pClearValues = &clear_value
+		};
+		vkCmdBeginRenderPass(cmd, &render_pass_begin_info, contents);
+	}
+
+	// secondaries set their own state, nothing may be recorded inline in this subpass
+	if (contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS)
+	{
+		return;
+	}
+
+	m_descriptor_heap.bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout);
+
+	VkViewport viewport = {
+		.x = 0.0f,
+		.y = 0.0f,
+		.width = static_cast<float>(extent.width),
+		.height = static_cast<float>(extent.height),
+		.minDepth = 0.0f,
+		.maxDepth = 1.0f
+	};
+	vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+	VkRect2D scissor = { { 0, 0 }, extent };
+	vkCmdSetScissor(cmd, 0, 1, &scissor);
+}
+
+void Renderer::end_main_pass(VkCommandBuffer cmd)
+{
+	if (m_render_pass == VK_NULL_HANDLE)
+	{
+		vkCmdEndRendering(cmd);
+	}
+	else
+	{
+		vkCmdEndRenderPass(cmd);
+	}
+}
+
+std::shared_ptr<Pipeline> Renderer::request_pipeline(const PipelineBuilder& builder, const std::shared_ptr<Pipeline>& fallback)
+{
+	return m_device.get_pipeline_state_cache().request(builder, m_pipeline_compiler, fallback);
+}
+
+void Renderer::push_constants(VkCommandBuffer cmd, const void* data, uint32_t size, uint32_t offset)
+{
+	vkCmdPushConstants(cmd, m_pipeline_layout, VK_SHADER_STAGE_ALL, offset, size, data);
+}
+
+PipelineBuilder Renderer::create_pipeline_builder() const
+{
+	if (m_render_pass == VK_NULL_HANDLE)
+	{
+		return PipelineBuilder::create(m_pipeline_layout, m_pipeline_layout_description, std::vector<VkFormat>{ m_swapchain.get_image_format() });
+	}
+	return PipelineBuilder::create(m_pipeline_layout, m_pipeline_layout_description, m_render_pass, std::vector<VkFormat>{ m_swapchain.get_image_format() });
+}
+
+VkCommandBuffer Renderer::acquire_secondary(FrameData& frame)
+{
+	uint32_t worker = JobSystem::get_worker_index();
+	if (worker >= frame.worker_commands.size())
+	{
+		throw std::runtime_error("secondary command buffers can only be recorded on job workers");
+	}
+
+	WorkerCommands& worker_commands = frame.worker_commands[worker];
+	if (worker_commands.used == worker_commands.secondaries.size())
+	{
+		VkCommandBufferAllocateInfo command_buffer_allocate_info = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = worker_commands.command_pool,
+			.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+			.commandBufferCount = 1
+		};
+		VkCommandBuffer secondary;
+		VK_CHECK(vkAllocateCommandBuffers(m_device.get_handle(), &command_buffer_allocate_info, &secondary));
+		worker_commands.secondaries.push_back(secondary);
+	}
+
+	// buffers survive the per frame pool reset and are simply recorded again
+	return worker_commands.secondaries[worker_commands.used++];
+}
+
+void Renderer::record_parallel(VkCommandBuffer cmd, uint32_t draw_count, uint32_t slice_size, const RecordDrawsFunction& record)
+{
+	if (draw_count == 0)
+	{
+		return;
+	}
+
+	jprofile("record parallel");
+	auto start = std::chrono::steady_clock::now();
+
+	slice_size = std::max(1u, slice_size);
+	uint32_t slice_count = (draw_count + slice_size - 1) / slice_size;
+	std::vector<VkCommandBuffer> secondaries(slice_count);
+
+	VkExtent2D extent = m_swapchain.get_extent();
+
+	// jobs capture a pointer to this instead of the state itself to fit the inline job storage
+	struct SliceContext {
+		Renderer* renderer;
+		FrameData* frame;
+		const RecordDrawsFunction* record;
+		VkCommandBuffer* secondaries;
+		VkFramebuffer framebuffer;
+		VkFormat color_format;
+		VkExtent2D extent;
+		VkQueryPipelineStatisticFlags statistics;
+		uint32_t draw_count;
+		uint32_t slice_size;
+	} context = {
+		this, &m_frames[m_frame_index], &record, secondaries.data(),
+		m_framebuffers.empty() ? VK_NULL_HANDLE : m_framebuffers[m_image_index],
+		m_swapchain.get_image_format(), extent, m_gpu_profiler.get_inherited_statistics(), draw_count, slice_size
+	};
+
+	JobCounter counter{ 0 };
+	m_job_system.parallel_for(slice_count, 1, [context = &context](uint32_t slice_begin, uint32_t slice_end) {
+		for (uint32_t slice = slice_begin; slice < slice_end; slice++)
+		{
+			jprofile("record slice");
+			VkCommandBuffer secondary = context->renderer->acquire_secondary(*context->frame);
+
+			// with dynamic rendering the secondary inherits attachment formats instead of a render pass
+			VkCommandBufferInheritanceRenderingInfo inheritance_rendering_info = {
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+				.colorAttachmentCount = 1,
+				.pColorAttachmentFormats = &context->color_format,
+				.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT
+			};
+			VkCommandBufferInheritanceInfo inheritance_info = {
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+				.pNext = context->renderer->m_render_pass == VK_NULL_HANDLE ? &inheritance_rendering_info : nullptr,
+				.renderPass = context->renderer->m_render_pass,
+				.subpass = 0,
+				.framebuffer = context->framebuffer,
+				.pipelineStatistics = context->statistics
+			};
+			VkCommandBufferBeginInfo command_buffer_begin_info = {
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+				.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+				.pInheritanceInfo = &inheritance_info
+			};
+			VK_CHECK(vkBeginCommandBuffer(secondary, &command_buffer_begin_info));
+
+			// dynamic state is not inherited from the primary
+			VkViewport viewport = {
+				.x = 0.0f,
+				.y = 0.0f,
+				.width = static_cast<float>(context->extent.width),
+				.height = static_cast<float>(context->extent.height),
+				.minDepth = 0.0f,
+				.maxDepth = 1.0f
+			};
+			vkCmdSetViewport(secondary, 0, 1, &viewport);
+
+			VkRect2D scissor = { { 0, 0 }, context->extent };
+			vkCmdSetScissor(secondary, 0, 1, &scissor);
+
+			// neither are descriptor sets, the heap is bound once per secondary instead of per draw
+			context->renderer->m_descriptor_heap.bind(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, context->renderer->m_pipeline_layout);
+
+			uint32_t begin = slice * context->slice_size;
+			uint32_t end = std::min(begin + context->slice_size, context->draw_count);
+			(*context->record)(secondary, begin, end);
+
+			VK_CHECK(vkEndCommandBuffer(secondary));
+			context->secondaries[slice] = secondary;
+		}
+	}, counter);
+	m_job_system.wait_for(counter);
+
+	vkCmdExecuteCommands(cmd, slice_count, secondaries.data());
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	m_frame_stats.record_ms = elapsed.count();
+	m_frame_stats.recorded_draws = draw_count;
+	m_frame_stats.recorded_slices = slice_count;
+	m_record_sum_ms += elapsed.count();
+	m_record_samples++;
+}
+
+void Renderer::wait_idle()
+{
+	// nothing runs on a lost device anymore, teardown may go ahead; the next frame reports the loss
+	VkResult result = vkDeviceWaitIdle(m_device.get_handle());
+	if (result == VK_ERROR_DEVICE_LOST)
+	{
+		m_device.mark_lost();
+		return;
+	}
+	VK_CHECK(result);
+}
+
+void Renderer::defer_destroy(std::function<void()>&& destroy)
+{
+	m_retired.push_back({ m_frame_count, std::move(destroy) });
+}
+
+void Renderer::collect_retired(bool force)
+{
+	// frames are waited in submission order, once frame_count - frames_in_flight is reached
+	// every submission recorded before the resources were retired has completed
+	while (!m_retired.empty() && (force || m_retired.front().retire_frame + m_frames.size() <= m_frame_count))
+	{
+		m_retired.front().destroy();
+		m_retired.pop_front();
+	}
+}
+
+void Renderer::recreate_swapchain()
+{
+	jprofile("recreate swapchain");
+	m_resize_start = std::chrono::steady_clock::now();
+	m_swapchain_dirty = false;
+
+	VkFormat previous_format = m_swapchain.get_image_format();
+	RetiredSwapchain retired = m_swapchain.recreate();
+
+	std::vector<VkFramebuffer> retired_framebuffers = std::move(m_framebuffers);
+	std::vector<VkSemaphore> retired_semaphores = std::move(m_render_finished);
+	m_framebuffers.clear();
+	m_render_finished.clear();
+
+	// the render pass only depends on the format, keep it (and every pipeline built against it) when unchanged
+	VkRenderPass retired_render_pass = VK_NULL_HANDLE;
+	if (previous_format != m_swapchain.get_image_format())
+	{
+		jwarn("swapchain: surface no longer offers the image format, pipelines are rebuilt against the new one");
+		m_format_generation++;
+		if (m_render_pass != VK_NULL_HANDLE)
+		{
+			retired_render_pass = m_render_pass;
+			create_render_pass();
+		}
+	}
+
+	create_framebuffers();
+
+	// transients sized after the swapchain follow the new extent
+	compile_render_graph();
+
+	VkDevice device = m_device.get_handle();
+	defer_destroy([device, retired = std::move(retired), retired_framebuffers = std::move(retired_framebuffers),
+		retired_semaphores = std::move(retired_semaphores), retired_render_pass]() {
+		for (auto framebuffer : retired_framebuffers)
+			vkDestroyFramebuffer(device, framebuffer, nullptr);
+		for (auto semaphore : retired_semaphores)
+			vkDestroySemaphore(device, semaphore, nullptr);
+		for (auto image_view : retired.image_views)
+			vkDestroyImageView(device, image_view, nullptr);
+		// headless devices have no swapchain entry points, the offscreen images go with the lambda
+		if (retired.swapchain != VK_NULL_HANDLE)
+			vkDestroySwapchainKHR(device, retired.swapchain, nullptr);
+		vkDestroyRenderPass(device, retired_render_pass, nullptr);
+	});
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - m_resize_start;
+	jinfo("swapchain: recreated {}x{} in {:.2f} ms", m_swapchain.get_extent().width, m_swapchain.get_extent().height, elapsed.count());
+	m_measure_resize = true;
+}
+
+void Renderer::set_present_policy(PresentPolicy policy)
+{
+	if (policy == m_swapchain.get_present_policy())
+	{
+		return;
+	}
+
+	m_swapchain.set_present_policy(policy);
+	m_swapchain_dirty = true;
+}
+
+void Renderer::record_present_latency()
+{
+	auto now = std::chrono::steady_clock::now();
+	std::chrono::duration<double, std::milli> latency = now - m_acquire_start;
+
+	m_frame_stats.acquire_to_present_ms = latency.count();
+	m_frame_stats.present_policy = m_swapchain.get_present_policy();
+
+	m_latency_sum_ms += latency.count();
+	m_latency_max_ms = std::max(m_latency_max_ms, latency.count());
+	m_latency_samples++;
+
+	// summarize once per second rather than flooding the log every frame
+	if (now - m_latency_report_start >= std::chrono::seconds(1))
+	{
+		jdebug("present latency: avg {:.2f} ms, max {:.2f} ms over {} frames",
+			m_latency_sum_ms / m_latency_samples, m_latency_max_ms, m_latency_samples);
+		m_latency_report_start = now;
+		m_latency_sum_ms = 0.0;
+		m_latency_max_ms = 0.0;
+		m_latency_samples = 0;
+
+		if (m_record_samples > 0)
+		{
+			jdebug("recording: avg {:.3f} ms for {} draws in {} slices on {} workers",
+				m_record_sum_ms / m_record_samples, m_frame_stats.recorded_draws, m_frame_stats.recorded_slices, m_job_system.get_worker_count());
+			m_record_sum_ms = 0.0;
+			m_record_samples = 0;
+		}
+	}
+}
+
+void Renderer::read_back_frame(ReadbackFunction&& callback)
+{
+	if (!m_device.is_headless())
+	{
+		throw std::runtime_error("frames can only be read back when rendering headless");
+	}
+	m_readback_request = std::move(callback);
+}
+
+void Renderer::record_readback(FrameData& frame)
+{
+	VkCommandBuffer cmd = frame.command_buffer;
+	VkExtent2D extent = m_swapchain.get_extent();
+	VkDeviceSize size = VkDeviceSize{ extent.width } * extent.height * 4;
+
+	// kept per slot and only grown, a resize to a smaller extent reuses it
+	if (!frame.readback_buffer || frame.readback_buffer->get_size() < size)
+	{
+		frame.readback_buffer.reset();
+		frame.readback_buffer.emplace(m_device, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, MemoryUsage::Readback);
+	}
+
+	// the render graph left the backbuffer in transfer source layout
+	VkBufferImageCopy region = {
+		.bufferOffset = 0,
+		.bufferRowLength = 0,
+		.bufferImageHeight = 0,
+		.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
+		.imageOffset = { 0, 0, 0 },
+		.imageExtent = { extent.width, extent.height, 1 }
+	};
+	vkCmdCopyImageToBuffer(cmd, m_swapchain.get_images()[m_image_index], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		frame.readback_buffer->get_handle(), 1, &region);
+
+	// makes the copy available to host reads once the frame fence signaled
+	VkMemoryBarrier2 barrier = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+		.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+		.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT,
+		.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT
+	};
+	VkDependencyInfo dependency_info = {
+		.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		.memoryBarrierCount = 1,
+		.pMemoryBarriers = &barrier
+	};
+	vkCmdPipelineBarrier2(cmd, &dependency_info);
+
+	frame.readback_image = {
+		.frame = m_frame_count,
+		.extent = extent,
+		.format = m_swapchain.get_image_format()
+	};
+}
+
+void Renderer::collect_readback(FrameData& frame)
+{
+	if (!frame.readback)
+	{
+		return;
+	}
+
+	ReadbackFunction callback = std::move(frame.readback);
+	frame.readback = nullptr;
+
+	ReadbackImage image = std::move(frame.readback_image);
+	VkDeviceSize size = VkDeviceSize{ image.extent.width } * image.extent.height * 4;
+	image.pixels.resize(size);
+	frame.readback_buffer->read(image.pixels.data(), size);
+
+	callback(std::move(image));
+}
+
+void Renderer::flush_readbacks()
+{
+	wait_idle();
+
+	// a lost device left nothing meaningful in the buffers
+	for (size_t i = 0; i < m_frames.size(); i++)
+	{
+		FrameData& frame = m_frames[(m_frame_index + i) % m_frames.size()];
+		if (m_device.is_lost())
+		{
+			frame.readback = nullptr;
+			continue;
+		}
+		collect_readback(frame);
+	}
+}
+
+void Renderer::wait_for_upload(UploadTicket ticket, VkPipelineStageFlags stages)
+{
+	// tickets complete in order, waiting for the newest covers every older one
+	m_upload_wait_ticket = std::max(m_upload_wait_ticket, ticket);
+	m_upload_wait_stages |= stages;
 }
@@ -2,14 +2,81 @@
 
 #include "device.h"
 #include "swapchain.h"
+#include "pipeline_compiler.h"
+#include "uploader.h"
+#include "render_graph.h"
+#include "pipeline_builder.h"
+#include "descriptor_heap.h"
+#include "gpu_profiler.h"
+
+// std
+#include <vector>
+#include <deque>
+#include <functional>
+#include <chrono>
+#include <optional>
 
 class Config;
 class Window;
+class JobSystem;
+
+// Secondary command buffers of one job worker for one frame slot. Only the owning
+// worker touches them, so recording needs no locking.
+struct WorkerCommands {
+	VkCommandPool command_pool = VK_NULL_HANDLE;
+	std::vector<VkCommandBuffer> secondaries;
+	uint32_t used = 0;
+};
+
+// Backbuffer contents of a finished frame, rows are tightly packed
+struct ReadbackImage {
+	uint64_t frame = 0;
+	VkExtent2D extent = {};
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	std::vector<uint8_t> pixels;
+};
+
+// Receives a read back frame on the main thread, may move the pixels elsewhere
+using ReadbackFunction = std::function<void(ReadbackImage&& image)>;
+
+// Per frame in flight resources, reused every time the frame slot comes around
+struct FrameData {
+	VkCommandPool command_pool = VK_NULL_HANDLE;
+	VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+	std::vector<WorkerCommands> worker_commands;
+	VkSemaphore image_available = VK_NULL_HANDLE;
+	VkFence in_flight = VK_NULL_HANDLE;
+
+	// copy of the backbuffer the slot last rendered, delivered once in_flight signaled
+	std::optional<Buffer> readback_buffer;
+	ReadbackImage readback_image;
+	ReadbackFunction readback;
+};
+
+// Destruction deferred until every frame that could reference the resources has retired
+struct RetiredResources {
+	uint64_t retire_frame;
+	std::function<void()> destroy;
+};
+
+struct FrameStats {
+	// CPU time from the acquire call until vkQueuePresentKHR returned
+	double acquire_to_present_ms = 0.0;
+	PresentPolicy present_policy = PresentPolicy::Throughput;
+
+	// CPU time spent in record_parallel, including the wait for the slowest slice
+	double record_ms = 0.0;
+	uint32_t recorded_draws = 0;
+	uint32_t recorded_slices = 0;
+};
+
+// Records draws [begin, end) into a secondary command buffer, called from job workers
+using RecordDrawsFunction = std::function<void(VkCommandBuffer cmd, uint32_t begin, uint32_t end)>;
 
 class Renderer {
 public:
 
-	Renderer(Config& config, Window& window);
+	Renderer(const Config& config, Window& window, JobSystem& job_system);
 
 	~Renderer();
 
@@ -18,22 +85,150 @@ public:
 	Renderer(Renderer&&) = delete;
 	Renderer& operator=(Renderer&&) = delete;
 
+	// Waits for the frame slot, acquires a swapchain image and begins recording.
+	// Returns VK_NULL_HANDLE when the frame has to be skipped.
+	VkCommandBuffer begin_frame();
+
+	// Submits the recorded frame and presents it, headless frames are only submitted
+	void end_frame();
+
+	// Headless only: copies the backbuffer of the frame being recorded to host memory. The copy
+	// is recorded at the end of the frame and handed to callback from a later begin_frame, once
+	// the frame slot's fence shows the GPU is done, so the CPU never waits for it.
+	void read_back_frame(ReadbackFunction&& callback);
+
+	// Waits for the device and delivers every pending readback, oldest frame first
+	void flush_readbacks();
+
+	// Records the render graph for the acquired swapchain image
+	void execute_render_graph(VkCommandBuffer cmd);
+
+	// Call after adding or changing passes, transients of the previous compile are destroyed once retired
+	void compile_render_graph();
+
+	// Pass VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS to record the pass with record_parallel
+	void begin_main_pass(VkCommandBuffer cmd, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+	void end_main_pass(VkCommandBuffer cmd);
+
+	// Splits draw_count draws into slices of slice_size, records each slice into a secondary
+	// command buffer on the job system and executes them in slice order, so the result does
+	// not depend on which worker recorded what. Must be called inside a main pass begun with
+	// secondary command buffer contents.
+	void record_parallel(VkCommandBuffer cmd, uint32_t draw_count, uint32_t slice_size, const RecordDrawsFunction& record);
+
+	// Pipeline of builder's state from the device state cache. A state seen for the first time
+	// compiles on the pipeline compiler threads and fallback is returned until it is ready, so
+	// switching materials at runtime never stalls the frame.
+	std::shared_ptr<Pipeline> request_pipeline(const PipelineBuilder& builder, const std::shared_ptr<Pipeline>& fallback);
+
+	// Per draw data for the shared pipeline layout, at most BINDLESS_PUSH_CONSTANT_SIZE bytes
+	void push_constants(VkCommandBuffer cmd, const void* data, uint32_t size, uint32_t offset = 0);
+
+	// Returns without throwing when the device is lost, so it is safe during teardown
+	void wait_idle();
+
+	// Makes the next submitted frame wait for an upload batch before the given stages
+	void wait_for_upload(UploadTicket ticket, VkPipelineStageFlags stages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+	// Switches the present policy, the swapchain is recreated before the next acquire
+	void set_present_policy(PresentPolicy policy);
+
+	// Recreates the per frame resources for a new number of frames in flight, waits for the device
+	void set_frames_in_flight(uint32_t frames_in_flight);
+
+	// Stats of the last presented frame
+	const FrameStats& get_frame_stats() const { return m_frame_stats; }
+
+	// Defers destroy until the frames currently in flight have completed
+	void defer_destroy(std::function<void()>&& destroy);
+
 	Device& get_device() { return m_device; }
+	PipelineCompiler& get_pipeline_compiler() { return m_pipeline_compiler; }
+	Uploader& get_uploader() { return m_uploader; }
+	RenderGraph& get_render_graph() { return m_render_graph; }
+	DescriptorHeap& get_descriptor_heap() { return m_descriptor_heap; }
+	GpuProfiler& get_gpu_profiler() { return m_gpu_profiler; }
+
+	// Swapchain image of the current frame as seen by the render graph
+	RenderResource get_backbuffer() const { return m_backbuffer; }
+	// Builder for pipelines drawn in the main pass, against the render pass or the swapchain format
+	PipelineBuilder create_pipeline_builder() const;
+
 	VkRenderPass get_render_pass() const { return m_render_pass; }
+	// Bumped when a swapchain recreate had to change the color format, pipelines from
+	// create_pipeline_builder before that are incompatible with the main pass
+	uint32_t get_format_generation() const { return m_format_generation; }
 	VkPipelineLayout get_pipeline_layout() const { return m_pipeline_layout; }
+	uint32_t get_frame_index() const { return m_frame_index; }
+	uint32_t get_frames_in_flight() const { return static_cast<uint32_t>(m_frames.size()); }
 private:
 
 	void create_render_pass();
 	void create_pipeline_layout();
+	void create_framebuffers();
+	void create_frames(uint32_t frames_in_flight);
+	void create_render_graph();
+	VkCommandBuffer acquire_secondary(FrameData& frame);
+	void destroy_framebuffers();
+	void destroy_frames();
+	void recreate_swapchain();
+	void collect_retired(bool force);
+	void record_present_latency();
+	void record_readback(FrameData& frame);
+	void collect_readback(FrameData& frame);
 
-	Config& m_config;
+	const Config& m_config;
 	Window& m_window;
+	JobSystem& m_job_system;
 
 	Device m_device{ m_config, m_window };
-	Swapchain m_swapchain{ m_window, m_device };
+	Swapchain m_swapchain{ m_window, m_device, parse_present_policy(m_config.get_present_policy()), m_config.get_frames_in_flight() };
+	PipelineCompiler m_pipeline_compiler{ m_device, m_config.get_pipeline_threads() };
+	Uploader m_uploader{ m_device, static_cast<VkDeviceSize>(m_config.get_staging_size_mb()) * 1024 * 1024 };
+	RenderGraph m_render_graph{ m_device };
+	DescriptorHeap m_descriptor_heap{ m_device, DescriptorHeapCapacity{
+		.sampled_images = m_config.get_bindless_sampled_images(),
+		.samplers = m_config.get_bindless_samplers(),
+		.storage_buffers = m_config.get_bindless_storage_buffers()
+	} };
+	GpuProfiler m_gpu_profiler{ m_device, m_config.get_frames_in_flight() };
+	RenderResource m_backbuffer;
 
-	// temporary
-	VkRenderPass m_render_pass;
+	// null when rendering dynamically
+	VkRenderPass m_render_pass = VK_NULL_HANDLE;
 	VkPipelineLayout m_pipeline_layout;
+	// what m_pipeline_layout was created from, pipelines are cached by it instead of the handle
+	std::vector<uint64_t> m_pipeline_layout_description;
+
+	std::vector<VkFramebuffer> m_framebuffers;
+
+	// signaled per swapchain image, presentation may hold on to it past the frame fence
+	std::vector<VkSemaphore> m_render_finished;
+
+	std::vector<FrameData> m_frames;
+	uint32_t m_frame_index = 0;
+	uint32_t m_image_index = 0;
+	uint64_t m_frame_count = 0;
+
+	std::deque<RetiredResources> m_retired;
+
+	// requested for the frame being recorded, moved to its slot by end_frame
+	ReadbackFunction m_readback_request;
+
+	UploadTicket m_upload_wait_ticket = 0;
+	VkPipelineStageFlags m_upload_wait_stages = 0;
+
+	bool m_swapchain_dirty = false;
+	uint32_t m_format_generation = 0;
+	bool m_measure_resize = false;
+	std::chrono::steady_clock::time_point m_resize_start;
 
-};
\ No newline at end of file
+	FrameStats m_frame_stats;
+	std::chrono::steady_clock::time_point m_acquire_start;
+	std::chrono::steady_clock::time_point m_latency_report_start;
+	double m_latency_sum_ms = 0.0;
+	double m_latency_max_ms = 0.0;
+	uint32_t m_latency_samples = 0;
+	double m_record_sum_ms = 0.0;
+	uint32_t m_record_samples = 0;
+};
@@ -1,29 +1,39 @@
 #pragma once
 
+#include "shader_cache.h"
+
 // lib
 #include <vulkan/vulkan.h>
 
 // std
 #include <string>
+#include <span>
+#include <memory>
+#include <cstdint>
 
 class Device;
 
+// Reference to a module shared through the device ShaderCache
 class Shader {
 public:
 
+	// Maps the spv file, identical content loaded elsewhere shares the same module
 	Shader(Device& device, const std::string& filename);
-	~Shader();
+
+	// Creates the module from SPIR-V owned by the caller, e.g. a ShaderArchive entry
+	Shader(Device& device, std::span<const uint32_t> code);
 
 	Shader(const Shader&) = delete;
 	Shader& operator=(const Shader&) = delete;
 	Shader(Shader&&) = delete;
 	Shader& operator=(Shader&&) = delete;
 
-	VkShaderModule get_module() const { return m_shader_module; }
+	// VK_NULL_HANDLE for inline modules, add the Shader to the PipelineBuilder instead
+	VkShaderModule get_module() const { return m_module->module; }
+
+	const std::shared_ptr<const ShaderModule>& get_shader_module() const { return m_module; }
 
 private:
 
-	Device& m_device;
-	
-	VkShaderModule m_shader_module = VK_NULL_HANDLE;
-};
\ No newline at end of file
+	std::shared_ptr<const ShaderModule> m_module;
+};
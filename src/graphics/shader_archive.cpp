@@ -0,0 +1,128 @@
+#include "shader_archive.h"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+ShaderArchive::ShaderArchive(const std::string& filename)
+	: m_file{filename}
+{
+	if (m_file.size() < sizeof(ShaderArchiveHeader))
+	{
+		throw std::runtime_error("shader archive is truncated: " + filename);
+	}
+
+	auto header = reinterpret_cast<const ShaderArchiveHeader*>(m_file.data());
+	if (header->magic != SHADER_ARCHIVE_MAGIC || header->version != SHADER_ARCHIVE_VERSION)
+	{
+		throw std::runtime_error("invalid shader archive: " + filename);
+	}
+
+	size_t index_end = sizeof(ShaderArchiveHeader) + static_cast<size_t>(header->entry_count) * sizeof(ShaderArchiveEntry);
+	if (index_end > m_file.size())
+	{
+		throw std::runtime_error("shader archive index is truncated: " + filename);
+	}
+
+	m_entries = { reinterpret_cast<const ShaderArchiveEntry*>(m_file.data() + sizeof(ShaderArchiveHeader)), header->entry_count };
+
+	for (const auto& entry : m_entries)
+	{
+		if (static_cast<size_t>(entry.offset) + entry.size > m_file.size() || entry.offset % sizeof(uint32_t) != 0)
+		{
+			throw std::runtime_error("shader archive entry out of range: " + filename);
+		}
+	}
+}
+
+std::span<const uint32_t> ShaderArchive::find(const std::string& name) const
+{
+	auto it = std::lower_bound(m_entries.begin(), m_entries.end(), name, [](const ShaderArchiveEntry& entry, const std::string& key) {
+		return strncmp(entry.name, key.c_str(), SHADER_ARCHIVE_NAME_SIZE) < 0;
+	});
+
+	if (it == m_entries.end() || strncmp(it->name, name.c_str(), SHADER_ARCHIVE_NAME_SIZE) != 0)
+	{
+		return {};
+	}
+
+	return { reinterpret_cast<const uint32_t*>(m_file.data() + it->offset), it->size / sizeof(uint32_t) };
+}
+
+void ShaderArchive::write(const std::string& filename, const std::vector<std::string>& spv_files)
+{
+	struct Source {
+		std::string name;
+		MappedFile file;
+	};
+
+	// entries are binary searched, so sort by name before mapping the files
+	std::vector<std::pair<std::string, std::string>> named_files;
+	for (const auto& path : spv_files)
+	{
+		std::string name = std::filesystem::path(path).stem().string();
+		if (name.size() >= SHADER_ARCHIVE_NAME_SIZE)
+		{
+			throw std::runtime_error("shader name too long for archive: " + name);
+		}
+		named_files.emplace_back(name, path);
+	}
+	std::sort(named_files.begin(), named_files.end());
+
+	std::vector<Source> sources;
+	sources.reserve(named_files.size());
+	for (const auto& [name, path] : named_files)
+	{
+		sources.push_back({ name, MappedFile{path} });
+	}
+
+	ShaderArchiveHeader header = {
+		.magic = SHADER_ARCHIVE_MAGIC,
+		.version = SHADER_ARCHIVE_VERSION,
+		.entry_count = static_cast<uint32_t>(sources.size()),
+		.reserved = 0
+	};
+
+	std::vector<ShaderArchiveEntry> entries(sources.size());
+	size_t offset = sizeof(ShaderArchiveHeader) + entries.size() * sizeof(ShaderArchiveEntry);
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		if (i > 0 && sources[i].name == sources[i - 1].name)
+		{
+			throw std::runtime_error("duplicate shader name in archive: " + sources[i].name);
+		}
+
+		offset = (offset + SHADER_ARCHIVE_ALIGNMENT - 1) & ~static_cast<size_t>(SHADER_ARCHIVE_ALIGNMENT - 1);
+
+		memset(entries[i].name, 0, SHADER_ARCHIVE_NAME_SIZE);
+		memcpy(entries[i].name, sources[i].name.c_str(), sources[i].name.size());
+		entries[i].offset = static_cast<uint32_t>(offset);
+		entries[i].size = static_cast<uint32_t>(sources[i].file.size());
+		offset += sources[i].file.size();
+	}
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("failed to open shader archive for writing: " + filename);
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(ShaderArchiveEntry));
+
+	const char padding[SHADER_ARCHIVE_ALIGNMENT]{};
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		size_t position = static_cast<size_t>(file.tellp());
+		file.write(padding, entries[i].offset - position);
+		file.write(reinterpret_cast<const char*>(sources[i].file.data()), sources[i].file.size());
+	}
+
+	if (!file)
+	{
+		throw std::runtime_error("failed to write shader archive: " + filename);
+	}
+}
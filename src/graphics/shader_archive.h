@@ -0,0 +1,60 @@
+#pragma once
+
+#include "utils.h"
+
+// std
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// Packed SPIR-V archive, every blob of a shader set lives in one file behind an offset index:
+//
+//   ShaderArchiveHeader
+//   ShaderArchiveEntry[entry_count]   sorted by name
+//   blobs                             each aligned to SHADER_ARCHIVE_ALIGNMENT
+//
+// The archive is mapped once and the SPIR-V words are handed to Vulkan straight from the mapping.
+
+static constexpr uint32_t SHADER_ARCHIVE_MAGIC = 0x5241534C; // "LSAR"
+static constexpr uint32_t SHADER_ARCHIVE_VERSION = 1;
+static constexpr uint32_t SHADER_ARCHIVE_ALIGNMENT = 8;
+static constexpr size_t SHADER_ARCHIVE_NAME_SIZE = 56;
+
+struct ShaderArchiveHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entry_count;
+	uint32_t reserved;
+};
+
+struct ShaderArchiveEntry {
+	char name[SHADER_ARCHIVE_NAME_SIZE];
+	uint32_t offset;
+	uint32_t size;
+};
+
+class ShaderArchive {
+public:
+
+	ShaderArchive(const std::string& filename);
+
+	ShaderArchive(const ShaderArchive&) = delete;
+	ShaderArchive& operator=(const ShaderArchive&) = delete;
+	ShaderArchive(ShaderArchive&&) = default;
+	ShaderArchive& operator=(ShaderArchive&&) = delete;
+
+	// Returns the SPIR-V words of name, empty when the archive doesn't contain it.
+	// The span stays valid as long as the archive.
+	std::span<const uint32_t> find(const std::string& name) const;
+
+	std::span<const ShaderArchiveEntry> get_entries() const { return m_entries; }
+
+	// Packs spv files into an archive, entries are named after the file name without the .spv extension
+	static void write(const std::string& filename, const std::vector<std::string>& spv_files);
+
+private:
+
+	MappedFile m_file;
+	std::span<const ShaderArchiveEntry> m_entries;
+};
@@ -0,0 +1,100 @@
+#include "shader_cache.h"
+
+// core
+#include "core/log.h"
+
+#include "device.h"
+#include "utils.h"
+
+// std
+#include <chrono>
+#include <stdexcept>
+
+ShaderCache::ShaderCache(Device& device)
+	: m_device{device}
+{
+}
+
+std::shared_ptr<const ShaderModule> ShaderCache::get(std::span<const uint32_t> code)
+{
+	if (code.empty())
+	{
+		throw std::runtime_error("empty SPIR-V code");
+	}
+
+	ContentDigest digest = digest_bytes(code.data(), code.size_bytes());
+	uint64_t hash = digest.low;
+
+	std::lock_guard lock{ m_mutex };
+
+	auto [first, last] = m_modules.equal_range(hash);
+	for (auto it = first; it != last;)
+	{
+		std::shared_ptr<ShaderModule> module = it->second.lock();
+		if (!module)
+		{
+			it = m_modules.erase(it);
+			continue;
+		}
+
+		if (module->digest == digest)
+		{
+			m_hits++;
+			return module;
+		}
+		++it;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	VkDevice device = m_device.get_handle();
+	std::shared_ptr<ShaderModule> module{ new ShaderModule{}, [device](ShaderModule* module) {
+		vkDestroyShaderModule(device, module->module, nullptr);
+		delete module;
+	} };
+	module->hash = hash;
+	module->digest = digest;
+
+	VkShaderModuleCreateInfo shader_module_create_info = {
+		.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+		.codeSize = code.size_bytes(),
+		.pCode = code.data(),
+	};
+
+	if (m_inline_modules)
+	{
+		// the pipeline reads the code at creation, the caller's copy may be gone by then
+		module->code.assign(code.begin(), code.end());
+		module->create_info = shader_module_create_info;
+		module->create_info.pCode = module->code.data();
+	}
+	else
+	{
+		VK_CHECK(vkCreateShaderModule(device, &shader_module_create_info, nullptr, &module->module));
+	}
+
+	auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+	m_create_ns += static_cast<uint64_t>(elapsed.count());
+	m_misses++;
+
+	m_modules.emplace(hash, module);
+	return module;
+}
+
+std::shared_ptr<const ShaderModule> ShaderCache::load(const std::string& filename)
+{
+	// the mapping is page aligned, so the words can be hashed and used in place
+	MappedFile file{ filename };
+	if (file.size() == 0 || file.size() % sizeof(uint32_t) != 0)
+	{
+		throw std::runtime_error("invalid SPIR-V file: " + filename);
+	}
+
+	return get({ reinterpret_cast<const uint32_t*>(file.data()), file.size() / sizeof(uint32_t) });
+}
+
+void ShaderCache::log_stats() const
+{
+	jinfo("shader cache: {} modules created in {:.2f} ms, {} duplicates shared{}",
+		m_misses.load(), m_create_ns.load() / 1e6, m_hits.load(), m_inline_modules ? " (inline SPIR-V)" : "");
+}
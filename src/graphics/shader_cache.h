@@ -0,0 +1,71 @@
+#pragma once
+
+#include "utils.h"
+
+// lib
+#include <vulkan/vulkan.h>
+
+// std
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Device;
+
+struct ShaderModule {
+	// bucket of the cache, the first half of digest
+	uint64_t hash = 0;
+	// compared on a hash hit, the code itself is not kept once the module is created
+	ContentDigest digest;
+
+	// VK_NULL_HANDLE when the code is passed inline at pipeline creation (VK_KHR_maintenance5)
+	VkShaderModule module = VK_NULL_HANDLE;
+
+	// inline modules only, create_info points at it and is chained into the shader stage
+	std::vector<uint32_t> code;
+	VkShaderModuleCreateInfo create_info{};
+};
+
+// Deduplicates shader modules by SPIR-V content, the hash only picks the bucket and the 128 bit
+// content digest decides. Modules are shared and destroyed once the last reference goes
+// away. Thread safe.
+class ShaderCache {
+public:
+
+	ShaderCache(Device& device);
+
+	ShaderCache(const ShaderCache&) = delete;
+	ShaderCache& operator=(const ShaderCache&) = delete;
+	ShaderCache(ShaderCache&&) = delete;
+	ShaderCache& operator=(ShaderCache&&) = delete;
+
+	std::shared_ptr<const ShaderModule> get(std::span<const uint32_t> code);
+
+	// Maps the spv file, hashes it in place and only creates a module for unseen content
+	std::shared_ptr<const ShaderModule> load(const std::string& filename);
+
+	// Skip VkShaderModule creation and pass SPIR-V to pipelines directly
+	void set_inline_modules(bool enabled) { m_inline_modules = enabled; }
+	bool uses_inline_modules() const { return m_inline_modules; }
+
+	void log_stats() const;
+
+private:
+
+	Device& m_device;
+
+	bool m_inline_modules = false;
+
+	std::mutex m_mutex;
+	// several live modules share a hash only on a collision
+	std::unordered_multimap<uint64_t, std::weak_ptr<ShaderModule>> m_modules;
+
+	std::atomic<uint32_t> m_hits{};
+	std::atomic<uint32_t> m_misses{};
+	std::atomic<uint64_t> m_create_ns{};
+};
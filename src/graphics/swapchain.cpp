@@ -8,19 +8,43 @@
 
 // std
 #include <algorithm>
+#include <stdexcept>
 
-Swapchain::Swapchain(Window& window, Device& device)
+PresentPolicy parse_present_policy(const std::string& name)
+{
+	if (name == "low_latency")
+		return PresentPolicy::LowLatency;
+	if (name == "throughput")
+		return PresentPolicy::Throughput;
+	if (name == "power_saving")
+		return PresentPolicy::PowerSaving;
+
+	throw std::runtime_error("unknown present policy: " + name);
+}
+
+Swapchain::Swapchain(Window& window, Device& device, PresentPolicy policy, uint32_t offscreen_image_count)
 	: m_window{window}
 	, m_device{ device }
+	, m_present_policy{ policy }
+	, m_offscreen_image_count{ offscreen_image_count }
 {
 	jinfo("swapchain constructor");
-	create_swapchain();
+	if (m_device.is_headless())
+	{
+		create_offscreen_images();
+		return;
+	}
+	create_swapchain(VK_NULL_HANDLE);
 	create_swapchain_image_views();
 }
 
 Swapchain::~Swapchain()
 {
 	jinfo("swapchain destructor");
+	if (m_device.is_headless())
+	{
+		return;
+	}
 	for (auto img : m_image_views)
 	{
 		vkDestroyImageView(m_device.get_handle(), img, nullptr);
@@ -28,7 +52,48 @@ Swapchain::~Swapchain()
 	vkDestroySwapchainKHR(m_device.get_handle(), m_swapchain, nullptr);
 }
 
-void Swapchain::create_swapchain()
+RetiredSwapchain Swapchain::recreate()
+{
+	if (m_device.is_headless())
+	{
+		RetiredSwapchain retired = { .offscreen_images = std::move(m_offscreen_images) };
+		create_offscreen_images();
+		return retired;
+	}
+
+	RetiredSwapchain retired = {
+		.swapchain = m_swapchain,
+		.image_views = std::move(m_image_views)
+	};
+	m_image_views.clear();
+
+	// the old swapchain stays valid for in-flight presents, the driver can recycle its resources
+	create_swapchain(retired.swapchain);
+	create_swapchain_image_views();
+
+	return retired;
+}
+
+VkResult Swapchain::acquire_next_image(VkSemaphore image_available, uint32_t& image_index)
+{
+	return vkAcquireNextImageKHR(m_device.get_handle(), m_swapchain, UINT64_MAX, image_available, VK_NULL_HANDLE, &image_index);
+}
+
+VkResult Swapchain::present(VkQueue queue, VkSemaphore render_finished, uint32_t image_index)
+{
+	VkPresentInfoKHR present_info = {
+		.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+		.waitSemaphoreCount = 1,
+		.pWaitSemaphores = &render_finished,
+		.swapchainCount = 1,
+		.pSwapchains = &m_swapchain,
+		.pImageIndices = &image_index
+	};
+
+	return vkQueuePresentKHR(queue, &present_info);
+}
+
+void Swapchain::create_swapchain(VkSwapchainKHR old_swapchain)
 {
 	SwapchainSupportDetails swapchain_support = m_device.query_swapchain_support_details();
 
@@ -36,12 +101,7 @@ void Swapchain::create_swapchain()
 	VkPresentModeKHR present_mode = choose_swapchain_present_mode(swapchain_support.present_modes);
 	VkExtent2D extent = choose_swapchain_extent(swapchain_support.capabilities);
 
-	uint32_t count_image = swapchain_support.capabilities.minImageCount + 1;
-
-	if (swapchain_support.capabilities.maxImageCount > 0 && count_image > swapchain_support.capabilities.maxImageCount)
-	{
-		count_image = swapchain_support.capabilities.maxImageCount;
-	}
+	uint32_t count_image = choose_swapchain_image_count(swapchain_support.capabilities);
 
 	VkSwapchainCreateInfoKHR swapchain_create_info = {
 		.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
@@ -55,7 +115,7 @@ void Swapchain::create_swapchain()
 		.preTransform = swapchain_support.capabilities.currentTransform,
 		.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
 		.presentMode = present_mode,
-		.oldSwapchain = VK_NULL_HANDLE
+		.oldSwapchain = old_swapchain
 	};
 
 	QueueFamilyIndices indices = m_device.find_queue_families();
@@ -75,11 +135,14 @@ void Swapchain::create_swapchain()
 
 	vkGetSwapchainImagesKHR(m_device.get_handle(), m_swapchain, &count_image, nullptr);
 	m_images.resize(count_image);
-	vkGetSwapchainImagesKHR(m_device.get_handle(), m_swapchain, &count_image, nullptr);
 	vkGetSwapchainImagesKHR(m_device.get_handle(), m_swapchain, &count_image, m_images.data());
 
 	m_image_format = surface_format.format;
+	m_color_space = surface_format.colorSpace;
 	m_extent = extent;
+	m_present_mode = present_mode;
+
+	jdebug("swapchain: {} images, {}", count_image, string_VkPresentModeKHR(present_mode));
 }
 
 void Swapchain::create_swapchain_image_views()
@@ -112,8 +175,39 @@ void Swapchain::create_swapchain_image_views()
 }
 
 
+void Swapchain::create_offscreen_images()
+{
+	int width, height;
+	m_window.get_drawable_size(width, height);
+	m_extent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+	m_image_format = OFFSCREEN_FORMAT;
+
+	// rendered as color attachment, copied out for readback
+	m_offscreen_images = std::make_shared<std::vector<Image>>();
+	m_offscreen_images->reserve(m_offscreen_image_count);
+	m_images.clear();
+	m_image_views.clear();
+	for (uint32_t i = 0; i < m_offscreen_image_count; i++)
+	{
+		Image& image = m_offscreen_images->emplace_back(m_device, m_extent, m_image_format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+		m_images.push_back(image.get_handle());
+		m_image_views.push_back(image.get_view());
+	}
+
+	jdebug("swapchain: {} offscreen images {}x{}", m_offscreen_image_count, m_extent.width, m_extent.height);
+}
+
 VkSurfaceFormatKHR Swapchain::choose_swapchain_surface_format(const std::vector<VkSurfaceFormatKHR>& available_formats)
 {
+	// a recreate keeps the current format while the surface still offers it, pipelines are built against it
+	for (const auto& availableFormat : available_formats)
+	{
+		if (availableFormat.format == m_image_format && availableFormat.colorSpace == m_color_space)
+		{
+			return availableFormat;
+		}
+	}
+
 	for (const auto& availableFormat : available_formats)
 	{
 		if (availableFormat.format == VK_FORMAT_B8G8R8A8_SRGB && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR)
@@ -126,14 +220,37 @@ VkSurfaceFormatKHR Swapchain::choose_swapchain_surface_format(const std::vector<
 
 VkPresentModeKHR Swapchain::choose_swapchain_present_mode(const std::vector<VkPresentModeKHR>& available_present_modes)
 {
-	for (const auto& present_mode : available_present_modes) {
-		if (present_mode == VK_PRESENT_MODE_MAILBOX_KHR) {
-			return present_mode;
+	// FIFO is the only mode every implementation must support
+	if (m_present_policy != PresentPolicy::LowLatency)
+	{
+		return VK_PRESENT_MODE_FIFO_KHR;
+	}
+
+	for (VkPresentModeKHR preferred : { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR })
+	{
+		if (std::find(available_present_modes.begin(), available_present_modes.end(), preferred) != available_present_modes.end())
+		{
+			return preferred;
 		}
 	}
 	return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+uint32_t Swapchain::choose_swapchain_image_count(const VkSurfaceCapabilitiesKHR& capabilities)
+{
+	uint32_t count_image = capabilities.minImageCount;
+	if (m_present_policy == PresentPolicy::Throughput)
+	{
+		count_image += 2;
+	}
+
+	if (capabilities.maxImageCount > 0 && count_image > capabilities.maxImageCount)
+	{
+		count_image = capabilities.maxImageCount;
+	}
+	return count_image;
+}
+
 VkExtent2D Swapchain::choose_swapchain_extent(const VkSurfaceCapabilitiesKHR& capabilites)
 {
 	if (capabilites.currentExtent.width != std::numeric_limits<uint32_t>::max())
@@ -141,7 +258,7 @@ VkExtent2D Swapchain::choose_swapchain_extent(const VkSurfaceCapabilitiesKHR& ca
 		return capabilites.currentExtent;
 	}
 	int width, height;
-	SDL_Vulkan_GetDrawableSize(m_window.w_sdl(), &width, &height);
+	m_window.get_drawable_size(width, height);
 
 	VkExtent2D actual_extent = {
 		static_cast<uint32_t>(width),
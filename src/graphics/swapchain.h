@@ -1,18 +1,44 @@
 #pragma once
 
+#include "image.h"
+
 // lib
 #include <vulkan/vulkan.h>
 
 // std
 #include <vector>
+#include <string>
+#include <memory>
 
 class Device;
 class Window;
 
+enum class PresentPolicy {
+	LowLatency,  // mailbox or immediate with as few images as the surface allows
+	Throughput,  // fifo with extra images so the CPU rarely blocks on acquire
+	PowerSaving  // fifo with as few images as possible, frame rate is capped by vblank
+};
+
+// Parses the renderer.present.policy config value
+PresentPolicy parse_present_policy(const std::string& name);
+
+// Handles of a swapchain that was handed off as oldSwapchain, destroyed once the GPU is done with them
+struct RetiredSwapchain {
+	VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+	std::vector<VkImageView> image_views;
+	// headless only, released with the last copy of the retired handles
+	std::shared_ptr<std::vector<Image>> offscreen_images;
+};
+
+// Presentable images of the window. On a headless device it owns offscreen color images
+// instead, which are rendered like swapchain images but never acquired or presented.
 class Swapchain {
 public:
 
-	Swapchain(Window& window, Device& device);
+	static constexpr VkFormat OFFSCREEN_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+
+	// offscreen_image_count is only used headless, one image per frame in flight
+	Swapchain(Window& window, Device& device, PresentPolicy policy, uint32_t offscreen_image_count);
 
 	~Swapchain();
 
@@ -21,24 +47,51 @@ public:
 	Swapchain(Swapchain&&) = delete;
 	Swapchain& operator=(Swapchain&&) = delete;
 
-	VkFormat get_image_format() { return m_image_format; }
+	// Creates a new swapchain from the current one, the previous handles are returned instead of destroyed
+	RetiredSwapchain recreate();
+
+	// Takes effect on the next recreate
+	void set_present_policy(PresentPolicy policy) { m_present_policy = policy; }
+	PresentPolicy get_present_policy() const { return m_present_policy; }
+
+	// Takes effect on the next recreate
+	void set_offscreen_image_count(uint32_t count) { m_offscreen_image_count = count; }
+
+	// Returns the raw result so callers can react to out of date/suboptimal swapchains
+	VkResult acquire_next_image(VkSemaphore image_available, uint32_t& image_index);
+	VkResult present(VkQueue queue, VkSemaphore render_finished, uint32_t image_index);
+
+	VkFormat get_image_format() const { return m_image_format; }
+	VkExtent2D get_extent() const { return m_extent; }
+	uint32_t get_image_count() const { return static_cast<uint32_t>(m_images.size()); }
+	const std::vector<VkImage>& get_images() const { return m_images; }
+	const std::vector<VkImageView>& get_image_views() const { return m_image_views; }
 
 private:
 	
-	void create_swapchain();
+	void create_swapchain(VkSwapchainKHR old_swapchain);
 	void create_swapchain_image_views();
+	void create_offscreen_images();
 	
 	VkSurfaceFormatKHR choose_swapchain_surface_format(const std::vector<VkSurfaceFormatKHR>& available_formats);
 	VkPresentModeKHR choose_swapchain_present_mode(const std::vector<VkPresentModeKHR>& available_present_modes);
 	VkExtent2D choose_swapchain_extent(const VkSurfaceCapabilitiesKHR& capabilites);
+	uint32_t choose_swapchain_image_count(const VkSurfaceCapabilitiesKHR& capabilities);
 
 	Window& m_window;
 	Device& m_device;
 
-	VkSwapchainKHR m_swapchain;
+	PresentPolicy m_present_policy;
+	VkPresentModeKHR m_present_mode;
+
+	VkSwapchainKHR m_swapchain = VK_NULL_HANDLE;
+	// views are owned by the offscreen images when headless
 	std::vector<VkImage> m_images;
 	std::vector<VkImageView> m_image_views;
-	VkFormat m_image_format;
+	std::shared_ptr<std::vector<Image>> m_offscreen_images;
+	uint32_t m_offscreen_image_count;
+	VkFormat m_image_format = VK_FORMAT_UNDEFINED;
+	VkColorSpaceKHR m_color_space = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
 	VkExtent2D m_extent;
 
 };
\ No newline at end of file
@@ -0,0 +1,299 @@
+#include "uploader.h"
+
+// core
+#include "core/log.h"
+#include "core/profile/profiler.h"
+
+#include "device.h"
+#include "image.h"
+
+// std
+#include <stdexcept>
+
+Uploader::Uploader(Device& device, VkDeviceSize staging_size)
+	: m_device{device}
+	, m_staging{ device, staging_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, MemoryUsage::Streaming }
+	, m_capacity{staging_size}
+{
+	jinfo("uploader constructor");
+
+	VkCommandPoolCreateInfo command_pool_create_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+		.queueFamilyIndex = m_device.find_queue_families().transfer_family.value()
+	};
+	VK_CHECK(vkCreateCommandPool(m_device.get_handle(), &command_pool_create_info, nullptr, &m_command_pool));
+
+	VkSemaphoreTypeCreateInfo semaphore_type_create_info = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+		.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+		.initialValue = 0
+	};
+	VkSemaphoreCreateInfo semaphore_create_info = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		.pNext = &semaphore_type_create_info
+	};
+	VK_CHECK(vkCreateSemaphore(m_device.get_handle(), &semaphore_create_info, nullptr, &m_timeline));
+}
+
+Uploader::~Uploader()
+{
+	jinfo("uploader destructor");
+
+	// work on a lost device counts as complete, its staging space can simply go
+	if (!m_device.is_lost())
+	{
+		if (m_next_ticket > 1)
+		{
+			wait(m_next_ticket - 1);
+		}
+		collect();
+	}
+
+	if (m_total_ms > 0.0)
+	{
+		jinfo("uploader: {:.2f} MB in {:.2f} ms of transfer time, {:.1f} MB/s",
+			m_total_bytes / 1e6, m_total_ms, (m_total_bytes / 1e6) / (m_total_ms / 1e3));
+	}
+
+	vkDestroySemaphore(m_device.get_handle(), m_timeline, nullptr);
+	vkDestroyCommandPool(m_device.get_handle(), m_command_pool, nullptr);
+}
+
+void Uploader::upload_buffer(Buffer& dst, const void* data, VkDeviceSize size, VkDeviceSize dst_offset)
+{
+	VkDeviceSize offset = allocate(size, 4);
+	m_staging.write(data, size, offset);
+
+	m_buffer_copies.push_back({
+		.dst = dst.get_handle(),
+		.region = { .srcOffset = offset, .dstOffset = dst_offset, .size = size }
+	});
+	m_pending_bytes += size;
+}
+
+void* Uploader::stage_buffer(Buffer& dst, VkDeviceSize size, VkDeviceSize dst_offset)
+{
+	VkDeviceSize offset = allocate(size, 4);
+
+	VkBufferCopy region = { .srcOffset = offset, .dstOffset = dst_offset, .size = size };
+	m_buffer_copies.push_back({
+		.dst = dst.get_handle(),
+		.region = region
+	});
+	m_staged_regions.push_back(region);
+	m_pending_bytes += size;
+
+	return static_cast<char*>(m_staging.get_mapped()) + offset;
+}
+
+void Uploader::upload_image(Image& dst, const void* data, VkDeviceSize size, VkImageLayout final_layout)
+{
+	// texel block alignment, 16 covers every uncompressed and block compressed format
+	VkDeviceSize offset = allocate(size, 16);
+	m_staging.write(data, size, offset);
+
+	m_image_copies.push_back({
+		.dst = dst.get_handle(),
+		.aspect = dst.get_aspect(),
+		.final_layout = final_layout,
+		.region = {
+			.bufferOffset = offset,
+			.bufferRowLength = 0,
+			.bufferImageHeight = 0,
+			.imageSubresource = { dst.get_aspect(), 0, 0, 1 },
+			.imageOffset = { 0, 0, 0 },
+			.imageExtent = { dst.get_extent().width, dst.get_extent().height, 1 }
+		}
+	});
+	m_pending_bytes += size;
+}
+
+UploadTicket Uploader::flush()
+{
+	jprofile("upload flush");
+	if (m_buffer_copies.empty() && m_image_copies.empty())
+	{
+		return m_next_ticket - 1;
+	}
+
+	for (const auto& region : m_staged_regions)
+	{
+		m_staging.flush(region.size, region.srcOffset);
+	}
+	m_staged_regions.clear();
+
+	VkCommandBuffer cmd = acquire_command_buffer();
+
+	VkCommandBufferBeginInfo command_buffer_begin_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+	};
+	VK_CHECK(vkBeginCommandBuffer(cmd, &command_buffer_begin_info));
+
+	for (const auto& copy : m_buffer_copies)
+	{
+		vkCmdCopyBuffer(cmd, m_staging.get_handle(), copy.dst, 1, &copy.region);
+	}
+
+	for (const auto& copy : m_image_copies)
+	{
+		VkImageMemoryBarrier to_transfer = {
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.srcAccessMask = 0,
+			.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+			.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = copy.dst,
+			.subresourceRange = { copy.aspect, 0, 1, 0, 1 }
+		};
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &to_transfer);
+
+		vkCmdCopyBufferToImage(cmd, m_staging.get_handle(), copy.dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy.region);
+
+		// visibility for the consumer comes from the timeline semaphore wait on the graphics queue
+		VkImageMemoryBarrier to_final = to_transfer;
+		to_final.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		to_final.dstAccessMask = 0;
+		to_final.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		to_final.newLayout = copy.final_layout;
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &to_final);
+	}
+
+	VK_CHECK(vkEndCommandBuffer(cmd));
+
+	UploadTicket ticket = m_next_ticket++;
+	VkTimelineSemaphoreSubmitInfo timeline_submit_info = {
+		.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+		.signalSemaphoreValueCount = 1,
+		.pSignalSemaphoreValues = &ticket
+	};
+	VkSubmitInfo submit_info = {
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.pNext = &timeline_submit_info,
+		.commandBufferCount = 1,
+		.pCommandBuffers = &cmd,
+		.signalSemaphoreCount = 1,
+		.pSignalSemaphores = &m_timeline
+	};
+	VK_CHECK(vkQueueSubmit(m_device.get_transfer_queue(), 1, &submit_info, VK_NULL_HANDLE));
+
+	m_in_flight.push_back({
+		.ticket = ticket,
+		.command_buffer = cmd,
+		.ring_end = m_head,
+		.bytes = m_pending_bytes,
+		.submit_time = std::chrono::steady_clock::now()
+	});
+
+	m_buffer_copies.clear();
+	m_image_copies.clear();
+	m_pending_bytes = 0;
+
+	return ticket;
+}
+
+void Uploader::collect()
+{
+	uint64_t completed;
+	VK_CHECK(vkGetSemaphoreCounterValue(m_device.get_handle(), m_timeline, &completed));
+
+	while (!m_in_flight.empty() && m_in_flight.front().ticket <= completed)
+	{
+		retire(m_in_flight.front());
+		m_in_flight.pop_front();
+	}
+}
+
+bool Uploader::is_complete(UploadTicket ticket) const
+{
+	uint64_t completed;
+	VK_CHECK(vkGetSemaphoreCounterValue(m_device.get_handle(), m_timeline, &completed));
+	return completed >= ticket;
+}
+
+void Uploader::wait(UploadTicket ticket)
+{
+	VkSemaphoreWaitInfo semaphore_wait_info = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+		.semaphoreCount = 1,
+		.pSemaphores = &m_timeline,
+		.pValues = &ticket
+	};
+	VK_CHECK(vkWaitSemaphores(m_device.get_handle(), &semaphore_wait_info, UINT64_MAX));
+}
+
+VkDeviceSize Uploader::allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+	if (size > m_capacity)
+	{
+		throw std::runtime_error("upload is larger than the staging ring");
+	}
+
+	uint64_t position = (m_head + alignment - 1) & ~(alignment - 1);
+
+	// nothing staged or in flight, restart at the beginning of the ring
+	if (m_head == m_tail)
+	{
+		position = (m_head + m_capacity - 1) / m_capacity * m_capacity;
+		m_tail = position;
+	}
+
+	// never split an allocation across the end of the ring
+	if (position % m_capacity + size > m_capacity)
+	{
+		position += m_capacity - position % m_capacity;
+	}
+
+	while (position + size - m_tail > m_capacity)
+	{
+		// the ring is full of copies that were never submitted, get them going first
+		if (m_in_flight.empty())
+		{
+			flush();
+		}
+
+		const Batch& oldest = m_in_flight.front();
+		wait(oldest.ticket);
+		retire(oldest);
+		m_in_flight.pop_front();
+	}
+
+	m_head = position + size;
+	return position % m_capacity;
+}
+
+VkCommandBuffer Uploader::acquire_command_buffer()
+{
+	if (!m_free_command_buffers.empty())
+	{
+		VkCommandBuffer cmd = m_free_command_buffers.back();
+		m_free_command_buffers.pop_back();
+		VK_CHECK(vkResetCommandBuffer(cmd, 0));
+		return cmd;
+	}
+
+	VkCommandBufferAllocateInfo command_buffer_allocate_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.commandPool = m_command_pool,
+		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandBufferCount = 1
+	};
+
+	VkCommandBuffer cmd;
+	VK_CHECK(vkAllocateCommandBuffers(m_device.get_handle(), &command_buffer_allocate_info, &cmd));
+	return cmd;
+}
+
+void Uploader::retire(const Batch& batch)
+{
+	m_tail = batch.ring_end;
+	m_free_command_buffers.push_back(batch.command_buffer);
+
+	// measured until the CPU noticed completion, an upper bound on the transfer time
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - batch.submit_time;
+	m_total_bytes += batch.bytes;
+	m_total_ms += elapsed.count();
+}
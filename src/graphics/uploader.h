@@ -0,0 +1,112 @@
+#pragma once
+
+#include "buffer.h"
+
+// lib
+#include <vulkan/vulkan.h>
+
+// std
+#include <vector>
+#include <deque>
+#include <chrono>
+
+class Device;
+class Image;
+
+// Timeline value signaled once an upload batch has completed on the transfer queue
+using UploadTicket = uint64_t;
+
+// Streams data to device local resources through a persistently mapped staging ring.
+// Copies are batched and submitted to the transfer queue as one submission per flush,
+// which signals a timeline semaphore the graphics queue can wait on. Not thread safe.
+class Uploader {
+public:
+
+	Uploader(Device& device, VkDeviceSize staging_size);
+
+	~Uploader();
+
+	Uploader(const Uploader&) = delete;
+	Uploader& operator=(const Uploader&) = delete;
+	Uploader(Uploader&&) = delete;
+	Uploader& operator=(Uploader&&) = delete;
+
+	// Stages data and queues a copy into dst, executed by the next flush
+	void upload_buffer(Buffer& dst, const void* data, VkDeviceSize size, VkDeviceSize dst_offset = 0);
+
+	// Reserves staging space for a copy into dst and returns its mapping, so data can be
+	// decoded straight into the ring. Fill it before staging anything else, a full ring
+	// submits the pending copies.
+	void* stage_buffer(Buffer& dst, VkDeviceSize size, VkDeviceSize dst_offset = 0);
+
+	// Largest single upload the staging ring can hold
+	VkDeviceSize get_capacity() const { return m_capacity; }
+
+	// Stages tightly packed texels for the whole image and queues the copy, the image ends in final_layout
+	void upload_image(Image& dst, const void* data, VkDeviceSize size, VkImageLayout final_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	// Submits every queued copy as a single batch, returns the ticket of the last submitted batch
+	UploadTicket flush();
+
+	// Releases staging space of completed batches without blocking
+	void collect();
+
+	bool is_complete(UploadTicket ticket) const;
+	void wait(UploadTicket ticket);
+
+	VkSemaphore get_timeline() const { return m_timeline; }
+
+private:
+
+	struct BufferCopy {
+		VkBuffer dst;
+		VkBufferCopy region;
+	};
+
+	struct ImageCopy {
+		VkImage dst;
+		VkImageAspectFlags aspect;
+		VkImageLayout final_layout;
+		VkBufferImageCopy region;
+	};
+
+	struct Batch {
+		UploadTicket ticket;
+		VkCommandBuffer command_buffer;
+		uint64_t ring_end;
+		VkDeviceSize bytes;
+		std::chrono::steady_clock::time_point submit_time;
+	};
+
+	// Returns the ring offset of a free staging region, blocks on old batches only when the ring is full
+	VkDeviceSize allocate(VkDeviceSize size, VkDeviceSize alignment);
+	VkCommandBuffer acquire_command_buffer();
+	void retire(const Batch& batch);
+
+	Device& m_device;
+
+	Buffer m_staging;
+	VkDeviceSize m_capacity;
+
+	// monotonic positions, the ring offset is position % capacity
+	uint64_t m_head = 0;
+	uint64_t m_tail = 0;
+
+	VkCommandPool m_command_pool = VK_NULL_HANDLE;
+	std::vector<VkCommandBuffer> m_free_command_buffers;
+
+	VkSemaphore m_timeline = VK_NULL_HANDLE;
+	UploadTicket m_next_ticket = 1;
+
+	std::vector<BufferCopy> m_buffer_copies;
+	std::vector<ImageCopy> m_image_copies;
+	// regions handed out by stage_buffer, flushed to the device on submit
+	std::vector<VkBufferCopy> m_staged_regions;
+	VkDeviceSize m_pending_bytes = 0;
+
+	std::deque<Batch> m_in_flight;
+
+	// throughput
+	VkDeviceSize m_total_bytes = 0;
+	double m_total_ms = 0.0;
+};
@@ -1,28 +1,70 @@
 #include "vertex.h"
 
-std::vector<VkVertexInputBindingDescription> Vertex::get_binding_descriptions()
+// lib
+#include <glm/gtc/packing.hpp>
+
+namespace {
+
+glm::i16vec2 to_snorm16(const glm::vec2& value)
+{
+	glm::vec2 scaled = glm::round(glm::clamp(value, -1.0f, 1.0f) * 32767.0f);
+	return glm::i16vec2(scaled);
+}
+
+glm::vec2 sign_not_zero(const glm::vec2& value)
+{
+	return { value.x >= 0.0f ? 1.0f : -1.0f, value.y >= 0.0f ? 1.0f : -1.0f };
+}
+
+}
+
+glm::u16vec4 encode_half_position(const glm::vec3& position)
 {
-	std::vector<VkVertexInputBindingDescription> bindings(1);
+	return {
+		glm::packHalf1x16(position.x),
+		glm::packHalf1x16(position.y),
+		glm::packHalf1x16(position.z),
+		glm::packHalf1x16(1.0f)
+	};
+}
 
-	bindings[0].binding = 0;
-	bindings[0].stride = sizeof(Vertex);
-	bindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-	return bindings;
+glm::i16vec2 encode_octahedral_normal(const glm::vec3& normal)
+{
+	glm::vec3 n = normal / (glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z));
+	glm::vec2 folded = glm::vec2(n);
+	if (n.z < 0.0f)
+	{
+		folded = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * sign_not_zero(folded);
+	}
+	return to_snorm16(folded);
 }
 
-std::vector<VkVertexInputAttributeDescription> Vertex::get_attribute_descriptions()
+glm::vec3 decode_octahedral_normal(const glm::i16vec2& encoded)
 {
-	std::vector<VkVertexInputAttributeDescription> attributes(2);
+	glm::vec2 e = glm::max(glm::vec2(encoded) / 32767.0f, -1.0f);
+	glm::vec3 n = { e.x, e.y, 1.0f - glm::abs(e.x) - glm::abs(e.y) };
+	float t = glm::max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return glm::normalize(n);
+}
 
-	attributes[0].binding = 0;
-	attributes[0].location = 0;
-	attributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-	attributes[0].offset = offsetof(Vertex, position);
+glm::u8vec4 encode_unorm8_color(const glm::vec4& color)
+{
+	return glm::u8vec4(glm::round(glm::clamp(color, 0.0f, 1.0f) * 255.0f));
+}
 
-	attributes[1].binding = 0;
-	attributes[1].location = 1;
-	attributes[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-	attributes[1].offset = offsetof(Vertex, color);
+glm::i16vec2 encode_snorm16_uv(const glm::vec2& uv)
+{
+	return to_snorm16(uv);
+}
 
-	return attributes;
+CompactVertex make_compact_vertex(const glm::vec3& position, const glm::vec3& normal, const glm::vec4& color, const glm::vec2& uv)
+{
+	return {
+		encode_half_position(position),
+		encode_octahedral_normal(normal),
+		encode_unorm8_color(color),
+		encode_snorm16_uv(uv)
+	};
 }
@@ -3,15 +3,96 @@
 // lib
 #include <vulkan/vulkan.h>
 #include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
 
 // std
-#include <vector>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// One vertex attribute, Type is what the vertex struct stores and Format how the input
+// assembler expands it for the shader
+template<typename T, VkFormat Format>
+struct VertexAttribute {
+	using Type = T;
+	static constexpr VkFormat FORMAT = Format;
+};
+
+using Float2Attribute = VertexAttribute<glm::vec2, VK_FORMAT_R32G32_SFLOAT>;
+using Float3Attribute = VertexAttribute<glm::vec3, VK_FORMAT_R32G32B32_SFLOAT>;
+using Float4Attribute = VertexAttribute<glm::vec4, VK_FORMAT_R32G32B32A32_SFLOAT>;
+
+// Quantized attributes, filled with the encode_ helpers below
+using HalfPositionAttribute = VertexAttribute<glm::u16vec4, VK_FORMAT_R16G16B16A16_SFLOAT>;
+using OctahedralNormalAttribute = VertexAttribute<glm::i16vec2, VK_FORMAT_R16G16_SNORM>;
+using Unorm8ColorAttribute = VertexAttribute<glm::u8vec4, VK_FORMAT_R8G8B8A8_UNORM>;
+using Snorm16UVAttribute = VertexAttribute<glm::i16vec2, VK_FORMAT_R16G16_SNORM>;
+
+namespace detail {
+
+template<typename... Attributes>
+constexpr std::array<VkVertexInputAttributeDescription, sizeof...(Attributes)> make_attribute_descriptions()
+{
+	std::array<VkVertexInputAttributeDescription, sizeof...(Attributes)> descriptions{};
+	uint32_t location = 0;
+	uint32_t offset = 0;
+	((descriptions[location] = { location, 0, Attributes::FORMAT, offset },
+		offset += static_cast<uint32_t>(sizeof(typename Attributes::Type)),
+		location++), ...);
+	return descriptions;
+}
+
+}
+
+// Tightly packed single binding layout, attribute i is read from location i. The vertex
+// struct declares one member of each attribute's Type in the same order; check it with
+// static_assert(sizeof(V) == V::Layout::STRIDE).
+template<typename... Attributes>
+struct VertexLayout {
+	static constexpr uint32_t STRIDE = static_cast<uint32_t>((sizeof(typename Attributes::Type) + ... + 0));
+
+	static constexpr std::array<VkVertexInputBindingDescription, 1> BINDINGS = {{
+		{ 0, STRIDE, VK_VERTEX_INPUT_RATE_VERTEX }
+	}};
+
+	static constexpr std::array<VkVertexInputAttributeDescription, sizeof...(Attributes)> ATTRIBUTES =
+		detail::make_attribute_descriptions<Attributes...>();
+};
 
 struct Vertex {
 
 	glm::vec3 position;
 	glm::vec3 color;
 
-	static std::vector<VkVertexInputBindingDescription> get_binding_descriptions();
-	static std::vector<VkVertexInputAttributeDescription> get_attribute_descriptions();
-};
\ No newline at end of file
+	using Layout = VertexLayout<Float3Attribute, Float3Attribute>;
+};
+
+static_assert(sizeof(Vertex) == Vertex::Layout::STRIDE);
+
+// 20 bytes against 48 for the same data in floats. Positions keep half precision, so
+// meshes should be authored or cooked around the origin; uvs are limited to [-1, 1].
+struct CompactVertex {
+
+	glm::u16vec4 position;
+	glm::i16vec2 normal;
+	glm::u8vec4 color;
+	glm::i16vec2 uv;
+
+	using Layout = VertexLayout<HalfPositionAttribute, OctahedralNormalAttribute, Unorm8ColorAttribute, Snorm16UVAttribute>;
+};
+
+static_assert(sizeof(CompactVertex) == CompactVertex::Layout::STRIDE);
+static_assert(offsetof(CompactVertex, uv) == CompactVertex::Layout::ATTRIBUTES[3].offset);
+
+// w is 1 so the shader can read a vec4 position as is
+glm::u16vec4 encode_half_position(const glm::vec3& position);
+
+// Normal folded onto the octahedron, decode with decode_octahedral in src/shaders/octahedral.glsl
+glm::i16vec2 encode_octahedral_normal(const glm::vec3& normal);
+glm::vec3 decode_octahedral_normal(const glm::i16vec2& encoded);
+
+glm::u8vec4 encode_unorm8_color(const glm::vec4& color);
+
+glm::i16vec2 encode_snorm16_uv(const glm::vec2& uv);
+
+CompactVertex make_compact_vertex(const glm::vec3& position, const glm::vec3& normal, const glm::vec4& color, const glm::vec2& uv);
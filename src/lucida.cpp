@@ -1,19 +1,32 @@
 ﻿// core
 #include "core/log.h"
+#include "core/profile/profiler.h"
 
 #include "engine/engine.h"
 
+// Usage: Lucida [config], the config defaults to lucida.json
 int main(int argc, char** argv)
 {
-	Config config{ "lucida.json" };
-	Engine my_engine{ config };
-
 	try {
-		my_engine.run();
+		Config config{ argc > 1 ? argv[1] : "lucida.json" };
+
+		// enabled before the engine exists so startup is part of the trace
+		Profiler::get().set_max_events(config.get_profiler_max_events());
+		Profiler::get().set_enabled(config.is_profiler_enabled());
+		{
+			Engine my_engine{ config };
+			my_engine.run();
+		}
+
+		if (Profiler::get().get_event_count() > 0)
+		{
+			Profiler::get().write_trace(config.get_profiler_output());
+		}
 	}
 	catch (std::exception& e)
 	{
 		jerr("exception: {}", e.what());
+		return 1;
 	}
 
 	return 0;
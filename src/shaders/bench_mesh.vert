@@ -0,0 +1,9 @@
+#version 460
+
+// Position only, LucidaBench mesh draws raw and cooked meshes with it to count vertex shader invocations
+layout(location = 0) in vec4 in_position;
+
+void main()
+{
+	gl_Position = vec4(in_position.xy, 0.5, 1.0);
+}
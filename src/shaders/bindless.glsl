@@ -0,0 +1,12 @@
+// Global bindless descriptor heap, see graphics/descriptor_heap.h
+
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 0, binding = 0) uniform texture2D bindless_textures[];
+layout(set = 0, binding = 1) uniform sampler bindless_samplers[];
+
+// Storage buffers share binding 2, the block layout differs per use, e.g.
+// layout(set = 0, binding = 2, std430) readonly buffer Vertices { Vertex vertices[]; } bindless_vertices[];
+
+#define bindless_sample(texture_handle, sampler_handle, uv) \
+	texture(sampler2D(bindless_textures[nonuniformEXT(texture_handle)], bindless_samplers[nonuniformEXT(sampler_handle)]), uv)
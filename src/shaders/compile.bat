@@ -1,3 +1,7 @@
 C:/VulkanSDK/1.4.313.0/Bin/glslc.exe test.vert -o spv/test.vert.spv
 C:/VulkanSDK/1.4.313.0/Bin/glslc.exe test.frag -o spv/test.frag.spv
+C:/VulkanSDK/1.4.313.0/Bin/glslc.exe --target-env=vulkan1.3 cull.comp -o spv/cull.comp.spv
+C:/VulkanSDK/1.4.313.0/Bin/glslc.exe --target-env=vulkan1.3 gpu_scene.vert -o spv/gpu_scene.vert.spv
+C:/VulkanSDK/1.4.313.0/Bin/glslc.exe --target-env=vulkan1.3 gpu_scene.frag -o spv/gpu_scene.frag.spv
+C:/VulkanSDK/1.4.313.0/Bin/glslc.exe bench_mesh.vert -o spv/bench_mesh.vert.spv
 pause
\ No newline at end of file
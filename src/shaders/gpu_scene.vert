@@ -0,0 +1,28 @@
+#version 460
+
+#include "bindless.glsl"
+
+layout(location = 0) in vec3 in_position;
+layout(location = 1) in vec3 in_color;
+
+layout(location = 0) out vec3 out_color;
+
+struct Instance {
+	mat4 transform;
+	uint mesh;
+};
+
+layout(set = 0, binding = 2, std430) readonly buffer Instances { Instance instances[]; } instance_buffers[];
+
+layout(push_constant) uniform Constants {
+	mat4 view_projection;
+	uint instances;
+} pc;
+
+void main()
+{
+	// firstInstance of every draw is the instance id, direct and indirect draws alike
+	mat4 transform = instance_buffers[pc.instances].instances[gl_InstanceIndex].transform;
+	gl_Position = pc.view_projection * transform * vec4(in_position, 1.0);
+	out_color = in_color;
+}
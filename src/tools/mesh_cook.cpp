@@ -0,0 +1,245 @@
+// Cooks a Wavefront OBJ into a mesh file the runtime maps and streams as is
+//
+//   LucidaMeshCook <input.obj> <output.lmesh> [cache_size]
+//
+// Triangles are reordered for the post transform cache (Tipsify) and then for overdraw,
+// vertices are renumbered in fetch order, quantized to CompactVertex and split into
+// meshlets. The vertex cache stats of the input and the cooked order are reported.
+
+#include "graphics/mesh_file.h"
+#include "tools/mesh_optimizer.h"
+#include "utils.h"
+
+// lib
+#include <fmt/core.h>
+
+// std
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct ObjMesh {
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec4> colors;
+	std::vector<glm::vec2> uvs;
+	std::vector<uint32_t> indices;
+};
+
+// OBJ indices are 1 based, negative ones count back from the last element
+uint32_t resolve_obj_index(long index, size_t count)
+{
+	long resolved = index < 0 ? static_cast<long>(count) + index : index - 1;
+	if (resolved < 0 || static_cast<size_t>(resolved) >= count)
+	{
+		throw std::runtime_error("obj index out of range");
+	}
+	return static_cast<uint32_t>(resolved);
+}
+
+ObjMesh load_obj(const std::string& filename)
+{
+	std::ifstream file(filename);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("failed to open obj: " + filename);
+	}
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec4> colors;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> uvs;
+	bool has_normals = false;
+
+	ObjMesh mesh;
+
+	// one output vertex per unique position/uv/normal triple
+	struct Corner {
+		uint32_t position;
+		uint32_t uv;
+		uint32_t normal;
+	};
+	struct CornerHash {
+		size_t operator()(const Corner& corner) const
+		{
+			return static_cast<size_t>(hash_combine(hash_combine(corner.position, corner.uv), corner.normal));
+		}
+	};
+	struct CornerEqual {
+		bool operator()(const Corner& a, const Corner& b) const
+		{
+			return a.position == b.position && a.uv == b.uv && a.normal == b.normal;
+		}
+	};
+	std::unordered_map<Corner, uint32_t, CornerHash, CornerEqual> vertex_lookup;
+
+	std::string line;
+	std::vector<uint32_t> face;
+	while (std::getline(file, line))
+	{
+		std::istringstream stream(line);
+		std::string type;
+		stream >> type;
+
+		if (type == "v")
+		{
+			glm::vec3 position;
+			glm::vec3 color{ 1.0f };
+			stream >> position.x >> position.y >> position.z;
+			// vertex colors are a common extension, "v x y z r g b"
+			if (!(stream >> color.r >> color.g >> color.b))
+			{
+				color = glm::vec3{ 1.0f };
+			}
+			positions.push_back(position);
+			colors.push_back(glm::vec4(color, 1.0f));
+		}
+		else if (type == "vn")
+		{
+			glm::vec3 normal;
+			stream >> normal.x >> normal.y >> normal.z;
+			normals.push_back(normal);
+		}
+		else if (type == "vt")
+		{
+			glm::vec2 uv;
+			stream >> uv.x >> uv.y;
+			uvs.push_back(uv);
+		}
+		else if (type == "f")
+		{
+			face.clear();
+
+			std::string token;
+			while (stream >> token)
+			{
+				// v, v/vt, v//vn or v/vt/vn
+				Corner corner = { 0, UINT32_MAX, UINT32_MAX };
+				const char* cursor = token.c_str();
+				char* end;
+				corner.position = resolve_obj_index(std::strtol(cursor, &end, 10), positions.size());
+				if (*end == '/')
+				{
+					cursor = end + 1;
+					if (*cursor != '/')
+					{
+						corner.uv = resolve_obj_index(std::strtol(cursor, &end, 10), uvs.size());
+						cursor = end;
+					}
+					if (*cursor == '/')
+					{
+						corner.normal = resolve_obj_index(std::strtol(cursor + 1, &end, 10), normals.size());
+						has_normals = true;
+					}
+				}
+
+				auto [it, inserted] = vertex_lookup.try_emplace(corner, static_cast<uint32_t>(mesh.positions.size()));
+				if (inserted)
+				{
+					mesh.positions.push_back(positions[corner.position]);
+					mesh.colors.push_back(colors[corner.position]);
+					mesh.normals.push_back(corner.normal != UINT32_MAX ? normals[corner.normal] : glm::vec3{ 0.0f });
+					mesh.uvs.push_back(corner.uv != UINT32_MAX ? uvs[corner.uv] : glm::vec2{ 0.0f });
+				}
+				face.push_back(it->second);
+			}
+
+			// fan triangulation, fine for the convex polygons exporters write
+			for (size_t i = 2; i < face.size(); i++)
+			{
+				mesh.indices.insert(mesh.indices.end(), { face[0], face[i - 1], face[i] });
+			}
+		}
+	}
+
+	// area weighted vertex normals when the file has none
+	if (!has_normals)
+	{
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		{
+			const glm::vec3& a = mesh.positions[mesh.indices[i + 0]];
+			const glm::vec3& b = mesh.positions[mesh.indices[i + 1]];
+			const glm::vec3& c = mesh.positions[mesh.indices[i + 2]];
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			for (size_t corner = 0; corner < 3; corner++)
+			{
+				mesh.normals[mesh.indices[i + corner]] += normal;
+			}
+		}
+	}
+	for (auto& normal : mesh.normals)
+	{
+		normal = glm::dot(normal, normal) > 0.0f ? glm::normalize(normal) : glm::vec3{ 0.0f, 0.0f, 1.0f };
+	}
+
+	return mesh;
+}
+
+void print_cache_stats(const char* label, std::span<const uint32_t> indices, uint32_t vertex_count)
+{
+	VertexCacheStats cache16 = analyze_vertex_cache(indices, vertex_count, 16);
+	VertexCacheStats cache32 = analyze_vertex_cache(indices, vertex_count, 32);
+	fmt::print("  {:<8} ACMR {:.3f} / {:.3f}, ATVR {:.3f} / {:.3f} (cache 16 / 32)\n",
+		label, cache16.acmr, cache32.acmr, cache16.atvr, cache32.atvr);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		fmt::print("usage: {} <input.obj> <output.lmesh> [cache_size]\n", argv[0]);
+		return 1;
+	}
+
+	uint32_t cache_size = argc > 3 ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 16;
+
+	try {
+		auto start = std::chrono::steady_clock::now();
+
+		ObjMesh obj = load_obj(argv[1]);
+		uint32_t vertex_count = static_cast<uint32_t>(obj.positions.size());
+
+		auto parsed = std::chrono::steady_clock::now();
+
+		CookedMesh cooked = cook_mesh(obj.positions, obj.normals, obj.colors, obj.uvs, obj.indices, cache_size);
+		uint32_t kept_count = static_cast<uint32_t>(cooked.vertices.size());
+
+		MeshFile::write(argv[2], cooked);
+
+		auto cooked_time = std::chrono::steady_clock::now();
+		std::chrono::duration<double, std::milli> parse_ms = parsed - start;
+		std::chrono::duration<double, std::milli> cook_ms = cooked_time - parsed;
+
+		// raw is what the same mesh costs as float vertices with 32 bit indices
+		size_t raw_size = static_cast<size_t>(vertex_count) * (sizeof(glm::vec3) * 2 + sizeof(glm::vec4) + sizeof(glm::vec2)) + obj.indices.size() * sizeof(uint32_t);
+		size_t cooked_size = std::filesystem::file_size(argv[2]);
+		size_t compressed_indices = encode_indices(cooked.indices).size();
+
+		fmt::print("{}: {} vertices ({} kept), {} triangles, {} meshlets\n",
+			argv[1], vertex_count, kept_count, obj.indices.size() / 3, cooked.meshlets.size());
+		print_cache_stats("input", obj.indices, vertex_count);
+		print_cache_stats("cooked", cooked.indices, kept_count);
+		fmt::print("  size     {:.2f} MB raw, {:.2f} MB cooked, indices {:.2f} bytes per index\n",
+			raw_size / 1e6, cooked_size / 1e6, cooked.indices.empty() ? 0.0 : static_cast<double>(compressed_indices) / cooked.indices.size());
+		fmt::print("  time     {:.2f} ms parse, {:.2f} ms cook\n", parse_ms.count(), cook_ms.count());
+	}
+	catch (std::exception& e)
+	{
+		fmt::print("error: {}\n", e.what());
+		return 1;
+	}
+
+	return 0;
+}
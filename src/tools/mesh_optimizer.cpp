@@ -0,0 +1,412 @@
+#include "mesh_optimizer.h"
+
+// std
+#include <algorithm>
+#include <cfloat>
+#include <numeric>
+#include <utility>
+
+VertexCacheStats analyze_vertex_cache(std::span<const uint32_t> indices, uint32_t vertex_count, uint32_t cache_size)
+{
+	// a vertex is cached while fewer than cache_size misses happened since it was loaded
+	std::vector<uint32_t> loaded_at(vertex_count, 0);
+	uint32_t misses = 0;
+
+	for (uint32_t index : indices)
+	{
+		if (loaded_at[index] == 0 || misses + 1 - loaded_at[index] > cache_size)
+		{
+			misses++;
+			loaded_at[index] = misses;
+		}
+	}
+
+	VertexCacheStats stats;
+	stats.transformed = misses;
+	stats.acmr = indices.empty() ? 0.0f : static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+	stats.atvr = vertex_count == 0 ? 0.0f : static_cast<float>(misses) / static_cast<float>(vertex_count);
+	return stats;
+}
+
+std::vector<uint32_t> optimize_vertex_cache(std::span<const uint32_t> indices, uint32_t vertex_count, uint32_t cache_size)
+{
+	const uint32_t triangle_count = static_cast<uint32_t>(indices.size() / 3);
+
+	// vertex to triangle adjacency
+	std::vector<uint32_t> live(vertex_count, 0);
+	for (uint32_t index : indices)
+	{
+		live[index]++;
+	}
+
+	std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+	std::partial_sum(live.begin(), live.end(), adjacency_offsets.begin() + 1);
+
+	std::vector<uint32_t> adjacency(indices.size());
+	std::vector<uint32_t> fill = adjacency_offsets;
+	for (uint32_t triangle = 0; triangle < triangle_count; triangle++)
+	{
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			adjacency[fill[indices[triangle * 3 + corner]]++] = triangle;
+		}
+	}
+
+	std::vector<uint32_t> cache_time(vertex_count, 0);
+	std::vector<bool> emitted(triangle_count, false);
+	std::vector<uint32_t> dead_end;
+	std::vector<uint32_t> candidates;
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+
+	uint32_t time = cache_size + 1;
+	uint32_t cursor = 0;
+	int64_t fanning = vertex_count > 0 ? 0 : -1;
+
+	while (fanning >= 0)
+	{
+		uint32_t vertex = static_cast<uint32_t>(fanning);
+		candidates.clear();
+
+		for (uint32_t i = adjacency_offsets[vertex]; i < adjacency_offsets[vertex + 1]; i++)
+		{
+			uint32_t triangle = adjacency[i];
+			if (emitted[triangle])
+			{
+				continue;
+			}
+
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				uint32_t v = indices[triangle * 3 + corner];
+				result.push_back(v);
+				dead_end.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+
+				if (time - cache_time[v] > cache_size)
+				{
+					cache_time[v] = time;
+					time++;
+				}
+			}
+			emitted[triangle] = true;
+		}
+
+		// prefer the candidate that is still cached and has the most triangles left
+		fanning = -1;
+		int64_t best_priority = -1;
+		for (uint32_t v : candidates)
+		{
+			if (live[v] == 0)
+			{
+				continue;
+			}
+
+			int64_t priority = 0;
+			if (time - cache_time[v] + 2 * live[v] <= cache_size)
+			{
+				priority = time - cache_time[v];
+			}
+			if (priority > best_priority)
+			{
+				best_priority = priority;
+				fanning = v;
+			}
+		}
+
+		if (fanning >= 0)
+		{
+			continue;
+		}
+
+		// dead end, fall back to recently used vertices and then to the input order
+		while (!dead_end.empty())
+		{
+			uint32_t v = dead_end.back();
+			dead_end.pop_back();
+			if (live[v] > 0)
+			{
+				fanning = v;
+				break;
+			}
+		}
+
+		while (fanning < 0 && cursor < vertex_count)
+		{
+			if (live[cursor] > 0)
+			{
+				fanning = cursor;
+			}
+			cursor++;
+		}
+	}
+
+	return result;
+}
+
+std::vector<uint32_t> optimize_overdraw(std::span<const uint32_t> indices, std::span<const glm::vec3> positions, uint32_t cache_size, float threshold)
+{
+	const uint32_t triangle_count = static_cast<uint32_t>(indices.size() / 3);
+	if (triangle_count == 0)
+	{
+		return {};
+	}
+
+	// FIFO simulation that can be restarted cold, a vertex only hits when it was loaded
+	// after the last restart
+	std::vector<uint32_t> loaded_at(positions.size(), 0);
+	uint32_t misses = 0;
+	uint32_t restart = 0;
+	auto triangle_misses = [&](uint32_t triangle) {
+		uint32_t triangle_misses = 0;
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			uint32_t index = indices[triangle * 3 + corner];
+			if (loaded_at[index] <= restart || misses + 1 - loaded_at[index] > cache_size)
+			{
+				misses++;
+				loaded_at[index] = misses;
+				triangle_misses++;
+			}
+		}
+		return triangle_misses;
+	};
+
+	// hard boundaries are triangles that miss every corner, the cache optimizer restarted there
+	std::vector<uint32_t> hard_clusters;
+	for (uint32_t triangle = 0; triangle < triangle_count; triangle++)
+	{
+		uint32_t missed = triangle_misses(triangle);
+		if (triangle == 0 || missed == 3)
+		{
+			hard_clusters.push_back(triangle);
+		}
+	}
+	hard_clusters.push_back(triangle_count);
+
+	// soft boundaries inside a hard cluster wherever the prefix, drawn from a cold cache, already
+	// reaches the ACMR of the whole cluster within threshold
+	std::vector<uint32_t> clusters;
+	for (size_t c = 0; c + 1 < hard_clusters.size(); c++)
+	{
+		uint32_t begin = hard_clusters[c];
+		uint32_t end = hard_clusters[c + 1];
+
+		restart = misses;
+		uint32_t cluster_misses = 0;
+		for (uint32_t triangle = begin; triangle < end; triangle++)
+		{
+			cluster_misses += triangle_misses(triangle);
+		}
+		float cluster_acmr = static_cast<float>(cluster_misses) / static_cast<float>(end - begin);
+
+		clusters.push_back(begin);
+		restart = misses;
+		uint32_t prefix_misses = 0;
+		uint32_t prefix_begin = begin;
+		for (uint32_t triangle = begin; triangle < end; triangle++)
+		{
+			prefix_misses += triangle_misses(triangle);
+			float prefix_acmr = static_cast<float>(prefix_misses) / static_cast<float>(triangle + 1 - prefix_begin);
+			if (triangle + 1 < end && prefix_acmr <= cluster_acmr * threshold)
+			{
+				clusters.push_back(triangle + 1);
+				restart = misses;
+				prefix_misses = 0;
+				prefix_begin = triangle + 1;
+			}
+		}
+	}
+	clusters.push_back(triangle_count);
+
+	glm::vec3 mesh_center{ 0.0f };
+	float mesh_area = 0.0f;
+	std::vector<float> sort_keys(clusters.size() - 1);
+	std::vector<glm::vec3> cluster_centers(clusters.size() - 1);
+	std::vector<glm::vec3> cluster_normals(clusters.size() - 1);
+
+	for (size_t c = 0; c + 1 < clusters.size(); c++)
+	{
+		glm::vec3 center{ 0.0f };
+		glm::vec3 normal{ 0.0f };
+		float area = 0.0f;
+		for (uint32_t triangle = clusters[c]; triangle < clusters[c + 1]; triangle++)
+		{
+			const glm::vec3& a = positions[indices[triangle * 3 + 0]];
+			const glm::vec3& b = positions[indices[triangle * 3 + 1]];
+			const glm::vec3& p = positions[indices[triangle * 3 + 2]];
+			glm::vec3 cross = glm::cross(b - a, p - a);
+			float triangle_area = glm::length(cross);
+
+			center += (a + b + p) / 3.0f * triangle_area;
+			normal += cross;
+			area += triangle_area;
+		}
+
+		mesh_center += center;
+		mesh_area += area;
+		cluster_centers[c] = area > 0.0f ? center / area : center;
+		cluster_normals[c] = glm::dot(normal, normal) > 0.0f ? glm::normalize(normal) : normal;
+	}
+	mesh_center = mesh_area > 0.0f ? mesh_center / mesh_area : mesh_center;
+
+	for (size_t c = 0; c < sort_keys.size(); c++)
+	{
+		sort_keys[c] = glm::dot(cluster_centers[c] - mesh_center, cluster_normals[c]);
+	}
+
+	std::vector<uint32_t> order(sort_keys.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		return sort_keys[a] > sort_keys[b];
+	});
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (uint32_t c : order)
+	{
+		result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+	}
+
+	return result;
+}
+
+std::vector<uint32_t> optimize_vertex_fetch(std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t& kept_count)
+{
+	std::vector<uint32_t> remap(vertex_count, UINT32_MAX);
+	kept_count = 0;
+
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == UINT32_MAX)
+		{
+			remap[index] = kept_count++;
+		}
+		index = remap[index];
+	}
+
+	return remap;
+}
+
+void build_meshlets(std::span<const uint32_t> indices, std::span<const glm::vec3> positions, CookedMesh& mesh)
+{
+	// local index of every mesh vertex in the current meshlet, valid while stamp matches
+	std::vector<uint8_t> local(positions.size(), 0);
+	std::vector<uint32_t> stamp(positions.size(), UINT32_MAX);
+
+	Meshlet meshlet = {};
+
+	auto finish = [&]() {
+		if (meshlet.triangle_count == 0)
+		{
+			return;
+		}
+
+		std::vector<glm::vec3> points;
+		points.reserve(meshlet.vertex_count);
+		for (uint32_t i = 0; i < meshlet.vertex_count; i++)
+		{
+			points.push_back(positions[mesh.meshlet_vertices[meshlet.vertex_offset + i]]);
+		}
+		glm::vec4 bounds = compute_bounds(points);
+		meshlet.bounds[0] = bounds.x;
+		meshlet.bounds[1] = bounds.y;
+		meshlet.bounds[2] = bounds.z;
+		meshlet.bounds[3] = bounds.w;
+
+		mesh.meshlets.push_back(meshlet);
+		meshlet = {
+			.vertex_offset = static_cast<uint32_t>(mesh.meshlet_vertices.size()),
+			.triangle_offset = static_cast<uint32_t>(mesh.meshlet_triangles.size() / 3)
+		};
+	};
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		uint32_t meshlet_index = static_cast<uint32_t>(mesh.meshlets.size());
+
+		uint32_t new_vertices = 0;
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			new_vertices += stamp[indices[i + corner]] != meshlet_index;
+		}
+
+		if (meshlet.vertex_count + new_vertices > MESHLET_MAX_VERTICES || meshlet.triangle_count == MESHLET_MAX_TRIANGLES)
+		{
+			finish();
+			meshlet_index = static_cast<uint32_t>(mesh.meshlets.size());
+		}
+
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			uint32_t index = indices[i + corner];
+			if (stamp[index] != meshlet_index)
+			{
+				stamp[index] = meshlet_index;
+				local[index] = static_cast<uint8_t>(meshlet.vertex_count++);
+				mesh.meshlet_vertices.push_back(index);
+			}
+			mesh.meshlet_triangles.push_back(local[index]);
+		}
+		meshlet.triangle_count++;
+	}
+
+	finish();
+}
+
+glm::vec4 compute_bounds(std::span<const glm::vec3> positions)
+{
+	if (positions.empty())
+	{
+		return glm::vec4{ 0.0f };
+	}
+
+	glm::vec3 min{ FLT_MAX };
+	glm::vec3 max{ -FLT_MAX };
+	for (const auto& position : positions)
+	{
+		min = glm::min(min, position);
+		max = glm::max(max, position);
+	}
+
+	glm::vec3 center = (min + max) * 0.5f;
+	float radius = 0.0f;
+	for (const auto& position : positions)
+	{
+		radius = std::max(radius, glm::length(position - center));
+	}
+
+	return glm::vec4(center, radius);
+}
+
+CookedMesh cook_mesh(std::span<const glm::vec3> positions, std::span<const glm::vec3> normals, std::span<const glm::vec4> colors,
+	std::span<const glm::vec2> uvs, std::span<const uint32_t> indices, uint32_t cache_size)
+{
+	uint32_t vertex_count = static_cast<uint32_t>(positions.size());
+
+	std::vector<uint32_t> cooked_indices = optimize_vertex_cache(indices, vertex_count, cache_size);
+	cooked_indices = optimize_overdraw(cooked_indices, positions, cache_size, 1.05f);
+
+	uint32_t kept_count;
+	std::vector<uint32_t> remap = optimize_vertex_fetch(cooked_indices, vertex_count, kept_count);
+
+	CookedMesh cooked;
+	std::vector<glm::vec3> kept_positions(kept_count);
+	cooked.vertices.resize(kept_count);
+	for (uint32_t i = 0; i < vertex_count; i++)
+	{
+		if (remap[i] == UINT32_MAX)
+		{
+			continue;
+		}
+		kept_positions[remap[i]] = positions[i];
+		cooked.vertices[remap[i]] = make_compact_vertex(positions[i], normals[i], colors[i], uvs[i]);
+	}
+
+	cooked.indices = std::move(cooked_indices);
+	cooked.bounds = compute_bounds(kept_positions);
+	build_meshlets(cooked.indices, kept_positions, cooked);
+	return cooked;
+}
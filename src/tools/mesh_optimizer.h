@@ -0,0 +1,46 @@
+#pragma once
+
+#include "graphics/mesh_file.h"
+
+// lib
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Offline index and vertex optimizations used by LucidaMeshCook
+
+// Post transform cache behaviour of a FIFO cache of cache_size entries
+struct VertexCacheStats {
+	uint32_t transformed = 0;
+	float acmr = 0.0f; // transformed vertices per triangle, 0.5 is the floor for a regular grid
+	float atvr = 0.0f; // transformed vertices per unique vertex, 1.0 is optimal
+};
+
+VertexCacheStats analyze_vertex_cache(std::span<const uint32_t> indices, uint32_t vertex_count, uint32_t cache_size);
+
+// Tipsify (Sander et al. 2007), reorders triangles for a cache of cache_size entries in linear time
+std::vector<uint32_t> optimize_vertex_cache(std::span<const uint32_t> indices, uint32_t vertex_count, uint32_t cache_size);
+
+// Splits the cache optimized order into clusters wherever the ACMR stays within threshold of
+// the input, then sorts the clusters so the ones facing away from the mesh center come first
+// and occlude the rest
+std::vector<uint32_t> optimize_overdraw(std::span<const uint32_t> indices, std::span<const glm::vec3> positions, uint32_t cache_size, float threshold);
+
+// Renumbers vertices in the order the index buffer first uses them, which turns vertex fetch
+// into a mostly linear walk and keeps index deltas small. Returns the old to new remap,
+// UINT32_MAX for unreferenced vertices, and the number of vertices kept in kept_count.
+std::vector<uint32_t> optimize_vertex_fetch(std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t& kept_count);
+
+// Greedy meshlets along the index order, at most MESHLET_MAX_VERTICES and MESHLET_MAX_TRIANGLES each
+void build_meshlets(std::span<const uint32_t> indices, std::span<const glm::vec3> positions, CookedMesh& mesh);
+
+// Sphere around the box center of the positions
+glm::vec4 compute_bounds(std::span<const glm::vec3> positions);
+
+// The whole LucidaMeshCook pipeline: cache and overdraw order, fetch order renumbering,
+// CompactVertex quantization, meshlets and bounds. Attributes are per vertex.
+CookedMesh cook_mesh(std::span<const glm::vec3> positions, std::span<const glm::vec3> normals, std::span<const glm::vec4> colors,
+	std::span<const glm::vec2> uvs, std::span<const uint32_t> indices, uint32_t cache_size);
@@ -0,0 +1,34 @@
+// Packs compiled SPIR-V into a single shader archive
+//
+//   LucidaShaderPack <archive> <file.spv>...
+
+#include "graphics/shader_archive.h"
+
+// lib
+#include <fmt/core.h>
+
+// std
+#include <exception>
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		fmt::print("usage: {} <archive> <file.spv>...\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<std::string> spv_files(argv + 2, argv + argc);
+
+	try {
+		ShaderArchive::write(argv[1], spv_files);
+	}
+	catch (std::exception& e)
+	{
+		fmt::print("error: {}\n", e.what());
+		return 1;
+	}
+
+	fmt::print("packed {} shaders into {}\n", spv_files.size(), argv[1]);
+	return 0;
+}
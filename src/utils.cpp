@@ -1,6 +1,19 @@
 #include "utils.h"
 
+#include <cstring>
 #include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 std::vector<char> read_file(const std::string& filename)
 {
@@ -20,3 +33,213 @@ std::vector<char> read_file(const std::string& filename)
 
 	return buffer;
 }
+
+uint64_t hash_bytes(const void* data, size_t size, uint64_t seed)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	uint64_t hash = seed;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+namespace {
+
+uint64_t rotl64(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+uint64_t fmix64(uint64_t k)
+{
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdull;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ull;
+	k ^= k >> 33;
+	return k;
+}
+
+}
+
+ContentDigest digest_bytes(const void* data, size_t size)
+{
+	// MurmurHash3_x64_128 with seed 0
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	const uint64_t c1 = 0x87c37b91114253d5ull;
+	const uint64_t c2 = 0x4cf5ad432745937full;
+	uint64_t h1 = 0;
+	uint64_t h2 = 0;
+
+	size_t block_count = size / 16;
+	for (size_t i = 0; i < block_count; i++)
+	{
+		uint64_t k1, k2;
+		memcpy(&k1, bytes + i * 16, sizeof(k1));
+		memcpy(&k2, bytes + i * 16 + 8, sizeof(k2));
+
+		k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+		h1 = rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+
+		k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+		h2 = rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+	}
+
+	const unsigned char* tail = bytes + block_count * 16;
+	uint64_t k1 = 0;
+	uint64_t k2 = 0;
+	switch (size & 15)
+	{
+	case 15: k2 ^= uint64_t{ tail[14] } << 48; [[fallthrough]];
+	case 14: k2 ^= uint64_t{ tail[13] } << 40; [[fallthrough]];
+	case 13: k2 ^= uint64_t{ tail[12] } << 32; [[fallthrough]];
+	case 12: k2 ^= uint64_t{ tail[11] } << 24; [[fallthrough]];
+	case 11: k2 ^= uint64_t{ tail[10] } << 16; [[fallthrough]];
+	case 10: k2 ^= uint64_t{ tail[9] } << 8; [[fallthrough]];
+	case 9: k2 ^= uint64_t{ tail[8] };
+		k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+		[[fallthrough]];
+	case 8: k1 ^= uint64_t{ tail[7] } << 56; [[fallthrough]];
+	case 7: k1 ^= uint64_t{ tail[6] } << 48; [[fallthrough]];
+	case 6: k1 ^= uint64_t{ tail[5] } << 40; [[fallthrough]];
+	case 5: k1 ^= uint64_t{ tail[4] } << 32; [[fallthrough]];
+	case 4: k1 ^= uint64_t{ tail[3] } << 24; [[fallthrough]];
+	case 3: k1 ^= uint64_t{ tail[2] } << 16; [[fallthrough]];
+	case 2: k1 ^= uint64_t{ tail[1] } << 8; [[fallthrough]];
+	case 1: k1 ^= uint64_t{ tail[0] };
+		k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+	}
+
+	h1 ^= size;
+	h2 ^= size;
+	h1 += h2;
+	h2 += h1;
+	h1 = fmix64(h1);
+	h2 = fmix64(h2);
+	h1 += h2;
+	h2 += h1;
+
+	return { h1, h2 };
+}
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& filename)
+{
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error("failed to open file: " + filename);
+	}
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size))
+	{
+		CloseHandle(file);
+		throw std::runtime_error("failed to query file size: " + filename);
+	}
+	m_file = file;
+	m_size = static_cast<size_t>(file_size.QuadPart);
+
+	// empty files can't be mapped, they simply have no data
+	if (m_size == 0)
+	{
+		return;
+	}
+
+	m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_mapping)
+	{
+		CloseHandle(file);
+		throw std::runtime_error("failed to map file: " + filename);
+	}
+
+	m_data = static_cast<const std::byte*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!m_data)
+	{
+		CloseHandle(m_mapping);
+		CloseHandle(file);
+		throw std::runtime_error("failed to map file: " + filename);
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_mapping)
+		CloseHandle(m_mapping);
+	if (m_file)
+		CloseHandle(m_file);
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: m_data{other.m_data}
+	, m_size{other.m_size}
+	, m_file{other.m_file}
+	, m_mapping{other.m_mapping}
+{
+	other.m_data = nullptr;
+	other.m_size = 0;
+	other.m_file = nullptr;
+	other.m_mapping = nullptr;
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& filename)
+{
+	int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		throw std::runtime_error("failed to open file: " + filename);
+	}
+
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0)
+	{
+		close(fd);
+		throw std::runtime_error("failed to query file size: " + filename);
+	}
+	m_size = static_cast<size_t>(file_stat.st_size);
+
+	// empty files can't be mapped, they simply have no data
+	if (m_size == 0)
+	{
+		close(fd);
+		return;
+	}
+
+	void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// the mapping keeps its own reference to the file
+	close(fd);
+
+	if (data == MAP_FAILED)
+	{
+		throw std::runtime_error("failed to map file: " + filename);
+	}
+
+	madvise(data, m_size, MADV_SEQUENTIAL);
+	m_data = static_cast<const std::byte*>(data);
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data)
+	{
+		munmap(const_cast<std::byte*>(m_data), m_size);
+	}
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: m_data{other.m_data}
+	, m_size{other.m_size}
+{
+	other.m_data = nullptr;
+	other.m_size = 0;
+}
+
+#endif
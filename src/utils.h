@@ -3,5 +3,54 @@
 // std
 #include <vector>
 #include <string>
+#include <cstddef>
+#include <cstdint>
 
 std::vector<char> read_file(const std::string& filename);
+
+// 64 bit FNV-1a, used for content hashing of shaders and pipeline state
+uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ull);
+
+// 128 bit MurmurHash3, identifies content where two blobs with colliding 64 bit hashes must not
+// be taken for each other, e.g. shader modules that no longer keep their code
+struct ContentDigest {
+	uint64_t low = 0;
+	uint64_t high = 0;
+
+	bool operator==(const ContentDigest&) const = default;
+};
+
+ContentDigest digest_bytes(const void* data, size_t size);
+
+inline uint64_t hash_combine(uint64_t seed, uint64_t value)
+{
+	return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+// Read-only memory mapping of a whole file, unmapped on destruction
+class MappedFile {
+public:
+
+	MappedFile(const std::string& filename);
+
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&&) = delete;
+
+	// Page aligned, so any alignment up to the page size holds for the start of the file
+	const std::byte* data() const { return m_data; }
+	size_t size() const { return m_size; }
+
+private:
+
+	const std::byte* m_data = nullptr;
+	size_t m_size = 0;
+
+#ifdef _WIN32
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#endif
+};
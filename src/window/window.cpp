@@ -8,9 +8,19 @@
 #include <stdexcept>
 
 
-Window::Window(Config& lc)
+Window::Window(const Config& lc)
 {
     jinfo("window constructor");
+    m_headless = lc.is_headless_enabled();
+    m_width = lc.get_window_width();
+    m_height = lc.get_window_height();
+
+    // offscreen rendering must run where no display or video driver exists
+    if (m_headless)
+    {
+        return;
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) < 0)
     {
         throw std::runtime_error("Could not initialize SDL");
@@ -30,20 +40,94 @@ Window::Window(Config& lc)
 Window::~Window()
 {
     jinfo("window destructor");
+    if (m_headless)
+    {
+        return;
+    }
     SDL_DestroyWindow(m_window);
     SDL_Quit();
 }
 
 void Window::process_events()
 {
+    if (m_headless)
+    {
+        return;
+    }
+
     SDL_Event event;
     while (SDL_PollEvent(&event))
     {
-        switch (event.type)
+        handle_event(event);
+    }
+
+    // minimized, nothing can be presented, sleep until a restore or resize instead of spinning a core
+    while (!m_closed && is_minimized())
+    {
+        // the timeout rechecks the size in case the restore arrives without a window event
+        if (SDL_WaitEventTimeout(&event, 100))
+        {
+            handle_event(event);
+        }
+    }
+}
+
+void Window::handle_event(const SDL_Event& event)
+{
+    switch (event.type)
+    {
+    case SDL_QUIT:
+        m_closed = true;
+        break;
+    case SDL_WINDOWEVENT:
+        if (event.window.event == SDL_WINDOWEVENT_RESIZED || event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED ||
+            event.window.event == SDL_WINDOWEVENT_RESTORED)
         {
-        case SDL_QUIT:
-            m_closed = true;
-            break;
+            m_resized = true;
         }
+        break;
+    }
+}
+
+bool Window::is_minimized() const
+{
+    if (SDL_GetWindowFlags(m_window) & SDL_WINDOW_MINIMIZED)
+    {
+        return true;
+    }
+    int width, height;
+    SDL_Vulkan_GetDrawableSize(m_window, &width, &height);
+    return width == 0 || height == 0;
+}
+
+void Window::apply(const WindowSettings& settings)
+{
+    m_width = settings.width;
+    m_height = settings.height;
+
+    // the swapchain follows on the next frame
+    m_resized = true;
+    if (m_headless)
+    {
+        return;
+    }
+
+    SDL_SetWindowTitle(m_window, settings.title.c_str());
+    SDL_SetWindowResizable(m_window, settings.resizable ? SDL_TRUE : SDL_FALSE);
+    SDL_SetWindowFullscreen(m_window, settings.fullscreen ? SDL_WINDOW_FULLSCREEN : 0);
+    if (!settings.fullscreen)
+    {
+        SDL_SetWindowSize(m_window, settings.width, settings.height);
+    }
+}
+
+void Window::get_drawable_size(int& width, int& height) const
+{
+    if (m_headless)
+    {
+        width = m_width;
+        height = m_height;
+        return;
     }
+    SDL_Vulkan_GetDrawableSize(m_window, &width, &height);
 }
@@ -5,11 +5,12 @@
 #include <SDL2/SDL_vulkan.h>
 
 class Config;
+struct WindowSettings;
 
 class Window {
 public:
 
-	Window(Config& lc);
+	Window(const Config& lc);
 
 	~Window();
 
@@ -18,12 +19,26 @@ public:
 	Window(Window&&) = delete;
 	Window& operator=(Window&&) = delete; 
 
-	// Process window events
+	// Process window events, blocks while the window is minimized
 	void process_events();
 
+	// Applies changed title, size and mode to the open window
+	void apply(const WindowSettings& settings);
+
+	// Size of the Vulkan drawable in pixels, the configured size when headless
+	void get_drawable_size(int& width, int& height) const;
+
+	// No SDL window exists, nothing can close it
+	bool is_headless() const { return m_headless; }
+
 	// Returns false if window was closed
 	bool closed() const { return m_closed; }
 
+	// Returns true if the window was resized since the last clear_resized
+	bool resized() const { return m_resized; }
+	void clear_resized() { m_resized = false; }
+
+	// null when headless
 	SDL_Window* w_sdl() const // accessor
 	{
 		return m_window;
@@ -31,7 +46,16 @@ public:
 
 private:
 
+	void handle_event(const SDL_Event& event);
+
+	// Minimized or a 0x0 drawable, no swapchain can be created
+	bool is_minimized() const;
+
 	SDL_Window* m_window = nullptr;
+	bool m_headless = false;
+	int m_width = 0;
+	int m_height = 0;
 	bool m_closed = false;
+	bool m_resized = false;
 };
 
@@ -0,0 +1,40 @@
+# Renders the frames of headless_smoke.json and checks what Lucida logged: no errors, a
+# checksum for every frame, all equal since the scene and camera never move, and equal to
+# EXPECTED_CHECKSUM when a pinned driver such as lavapipe on CI passes one.
+#
+#   cmake -DLUCIDA=<path to Lucida> -DCONFIG=headless_smoke.json -DFRAMES=8 [-DEXPECTED_CHECKSUM=<hex>] -P headless_smoke.cmake
+
+file(REMOVE lucida.log)
+
+execute_process(COMMAND ${LUCIDA} ${CONFIG} RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+	message(FATAL_ERROR "headless smoke: Lucida exited with ${result}, see lucida.log")
+endif()
+
+file(STRINGS lucida.log errors REGEX "\\[ERR")
+if (errors)
+	list(JOIN errors "\n" errors)
+	message(FATAL_ERROR "headless smoke: errors logged\n${errors}")
+endif()
+
+file(STRINGS lucida.log checksums REGEX "headless: frame [0-9]+ [0-9]+x[0-9]+ checksum [0-9a-f]+")
+list(LENGTH checksums count)
+if (NOT count EQUAL FRAMES)
+	message(FATAL_ERROR "headless smoke: ${count} checksums logged for ${FRAMES} frames")
+endif()
+
+set(first "")
+foreach (line IN LISTS checksums)
+	string(REGEX MATCH "checksum ([0-9a-f]+)" match "${line}")
+	if (first STREQUAL "")
+		set(first ${CMAKE_MATCH_1})
+	elseif (NOT CMAKE_MATCH_1 STREQUAL first)
+		message(FATAL_ERROR "headless smoke: frames of a static scene differ\n${line}\nfirst checksum ${first}")
+	endif()
+endforeach()
+
+if (DEFINED EXPECTED_CHECKSUM AND NOT first STREQUAL EXPECTED_CHECKSUM)
+	message(FATAL_ERROR "headless smoke: checksum ${first}, expected ${EXPECTED_CHECKSUM}")
+endif()
+
+message(STATUS "headless smoke: ${count} frames, checksum ${first}")